@@ -0,0 +1,337 @@
+#include "InputReader.h"
+
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/// size of the decompression buffer, grows only for lines longer than this
+static const size_t INPUT_CHUNK_SIZE = 1 << 20;
+
+/// zlib counts its input in unsigned ints, feed it at most this much at once
+static const size_t MAX_INFLATE_INPUT = 1 << 30;
+
+CInputReader::CInputReader()
+    : theFormat(IF_PLAIN), theStream(NULL), iInputOfs(0),
+      iFilled(0), iWindowEnd(0), reachedEOF(false), iDecompressed(0)
+{
+}
+
+CInputReader::~CInputReader()
+{
+    close();
+}
+
+const char *CInputReader::formatName(InputFormat fmt)
+{
+    switch (fmt)
+    {
+    case IF_GZIP:
+        return "gzip";
+    case IF_XZ:
+        return "xz";
+    case IF_ZSTD:
+        return "zstd";
+    default:
+        return "plain";
+    }
+}
+
+bool CInputReader::open(const char *lpstrFileName)
+{
+    close();
+
+    if (!theFile.open(lpstrFileName))
+    {
+        theError = string("Error opening file ") + lpstrFileName;
+        return false;
+    }
+
+    const unsigned char *magic = (const unsigned char *) theFile.begin();
+    size_t sz = theFile.size();
+
+    if (sz >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        theFormat = IF_GZIP;
+    else if (sz >= 6 && memcmp(magic, "\xfd" "7zXZ\0", 6) == 0)
+        theFormat = IF_XZ;
+    else if (sz >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+        theFormat = IF_ZSTD;
+    else
+        theFormat = IF_PLAIN;
+
+    switch (theFormat)
+    {
+    case IF_PLAIN:
+        return true;
+
+    case IF_GZIP:
+#ifdef HAVE_ZLIB
+    {
+        z_stream *zs = new z_stream;
+        memset(zs, 0, sizeof(z_stream));
+        // 15 + 32: maximal window, detect the gzip/zlib header automatically
+        if (inflateInit2(zs, 15 + 32) != Z_OK)
+        {
+            delete zs;
+            theError = "failed to initialize zlib";
+            return false;
+        }
+        theStream = zs;
+        break;
+    }
+#else
+        theError = string(lpstrFileName) + " is gzip compressed, but dsharp was built without zlib support (-DHAVE_ZLIB)";
+        return false;
+#endif
+
+    case IF_XZ:
+#ifdef HAVE_LZMA
+    {
+        lzma_stream *ls = new lzma_stream;
+        lzma_stream init = LZMA_STREAM_INIT;
+        *ls = init;
+        if (lzma_stream_decoder(ls, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+        {
+            delete ls;
+            theError = "failed to initialize liblzma";
+            return false;
+        }
+        theStream = ls;
+        break;
+    }
+#else
+        theError = string(lpstrFileName) + " is xz compressed, but dsharp was built without liblzma support (-DHAVE_LZMA)";
+        return false;
+#endif
+
+    case IF_ZSTD:
+#ifdef HAVE_ZSTD
+    {
+        ZSTD_DStream *ds = ZSTD_createDStream();
+        if (ds == NULL || ZSTD_isError(ZSTD_initDStream(ds)))
+        {
+            if (ds != NULL)
+                ZSTD_freeDStream(ds);
+            theError = "failed to initialize libzstd";
+            return false;
+        }
+        theStream = ds;
+        break;
+    }
+#else
+        theError = string(lpstrFileName) + " is zstd compressed, but dsharp was built without libzstd support (-DHAVE_ZSTD)";
+        return false;
+#endif
+    }
+
+    theBuffer.resize(INPUT_CHUNK_SIZE);
+    return true;
+}
+
+void CInputReader::releaseStream()
+{
+    if (theStream == NULL)
+        return;
+
+    switch (theFormat)
+    {
+#ifdef HAVE_ZLIB
+    case IF_GZIP:
+        inflateEnd((z_stream *) theStream);
+        delete (z_stream *) theStream;
+        break;
+#endif
+#ifdef HAVE_LZMA
+    case IF_XZ:
+        lzma_end((lzma_stream *) theStream);
+        delete (lzma_stream *) theStream;
+        break;
+#endif
+#ifdef HAVE_ZSTD
+    case IF_ZSTD:
+        ZSTD_freeDStream((ZSTD_DStream *) theStream);
+        break;
+#endif
+    default:
+        break;
+    }
+    theStream = NULL;
+}
+
+void CInputReader::close()
+{
+    releaseStream();
+    theFile.close();
+
+    theFormat = IF_PLAIN;
+    iInputOfs = 0;
+    theBuffer.clear();
+    iFilled = iWindowEnd = 0;
+    reachedEOF = false;
+    iDecompressed = 0;
+    theError.clear();
+}
+
+size_t CInputReader::decompress(char *dest, size_t maxBytes)
+{
+#if !defined(HAVE_ZLIB) && !defined(HAVE_LZMA) && !defined(HAVE_ZSTD)
+    (void) dest;
+    (void) maxBytes;
+#endif
+    size_t produced = 0;
+
+    switch (theFormat)
+    {
+#ifdef HAVE_ZLIB
+    case IF_GZIP:
+    {
+        const char *src = theFile.begin() + iInputOfs;
+        size_t srcLeft = theFile.size() - iInputOfs;
+        z_stream *zs = (z_stream *) theStream;
+        zs->next_in = (Bytef *) src;
+        zs->avail_in = (uInt) (srcLeft < MAX_INFLATE_INPUT ? srcLeft : MAX_INFLATE_INPUT);
+        zs->next_out = (Bytef *) dest;
+        zs->avail_out = (uInt) maxBytes;
+
+        int ret = inflate(zs, Z_NO_FLUSH);
+
+        iInputOfs += (const char *) zs->next_in - src;
+        produced = maxBytes - zs->avail_out;
+
+        if (ret == Z_STREAM_END)
+        {
+            // gzip files may consist of several members
+            if (iInputOfs < theFile.size())
+                inflateReset(zs);
+            else
+                reachedEOF = true;
+        }
+        else if (ret != Z_OK && ret != Z_BUF_ERROR)
+            theError = string("gzip decompression failed: ") + (zs->msg ? zs->msg : "corrupt input");
+        else if (produced == 0 && iInputOfs == theFile.size())
+            theError = "gzip input is truncated";
+        break;
+    }
+#endif
+#ifdef HAVE_LZMA
+    case IF_XZ:
+    {
+        const char *src = theFile.begin() + iInputOfs;
+        size_t srcLeft = theFile.size() - iInputOfs;
+        lzma_stream *ls = (lzma_stream *) theStream;
+        ls->next_in = (const uint8_t *) src;
+        ls->avail_in = srcLeft;
+        ls->next_out = (uint8_t *) dest;
+        ls->avail_out = maxBytes;
+
+        lzma_ret ret = lzma_code(ls, srcLeft == 0 ? LZMA_FINISH : LZMA_RUN);
+
+        iInputOfs += (const char *) ls->next_in - src;
+        produced = maxBytes - ls->avail_out;
+
+        if (ret == LZMA_STREAM_END)
+            reachedEOF = true;
+        else if (ret != LZMA_OK)
+            theError = "xz decompression failed: corrupt or truncated input";
+        break;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case IF_ZSTD:
+    {
+        const char *src = theFile.begin() + iInputOfs;
+        size_t srcLeft = theFile.size() - iInputOfs;
+        ZSTD_inBuffer in = { src, srcLeft, 0 };
+        ZSTD_outBuffer out = { dest, maxBytes, 0 };
+
+        size_t ret = ZSTD_decompressStream((ZSTD_DStream *) theStream, &out, &in);
+
+        iInputOfs += in.pos;
+        produced = out.pos;
+
+        if (ZSTD_isError(ret))
+            theError = string("zstd decompression failed: ") + ZSTD_getErrorName(ret);
+        else if (iInputOfs == theFile.size() && produced < maxBytes)
+        {
+            // all input consumed and the output was not limited by our buffer
+            if (ret == 0)
+                reachedEOF = true;
+            else if (produced == 0)
+                theError = "zstd input is truncated";
+        }
+        break;
+    }
+#endif
+    default:
+        reachedEOF = true;
+        break;
+    }
+
+    if (failed())
+        reachedEOF = true;
+
+    return produced;
+}
+
+bool CInputReader::nextWindow(const char *&begin, const char *&end)
+{
+    if (theFormat == IF_PLAIN)
+    {
+        if (reachedEOF)
+            return false;
+        reachedEOF = true;
+        iFilled = iWindowEnd = iDecompressed = theFile.size();
+        begin = theFile.begin();
+        end = theFile.end();
+        return true;
+    }
+
+    // move the incomplete last line of the previous window to the front
+    size_t carry = iFilled - iWindowEnd;
+    if (carry > 0)
+        memmove(&theBuffer[0], &theBuffer[iWindowEnd], carry);
+    iFilled = carry;
+    iWindowEnd = 0;
+
+    for (;;)
+    {
+        while (iFilled < theBuffer.size() && !reachedEOF)
+            iFilled += decompress(&theBuffer[iFilled], theBuffer.size() - iFilled);
+
+        if (reachedEOF)
+        {
+            iWindowEnd = iFilled;
+            break;
+        }
+
+        // cut the window after the last complete line
+        size_t i = iFilled;
+        while (i > 0 && theBuffer[i - 1] != '\n')
+            i--;
+
+        if (i > 0)
+        {
+            iWindowEnd = i;
+            break;
+        }
+        // a single line does not fit into the buffer
+        theBuffer.resize(2 * theBuffer.size());
+    }
+
+    if (iWindowEnd == 0)
+        return false;
+
+    iDecompressed += iWindowEnd;
+    begin = &theBuffer[0];
+    end = begin + iWindowEnd;
+    return true;
+}
@@ -0,0 +1,107 @@
+#ifndef INPUTREADER_H
+#define INPUTREADER_H
+
+#include <stddef.h>
+#include <vector>
+#include <string>
+
+#include "MappedFile.h"
+
+using std::vector;
+using std::string;
+
+/** sequential reader for (possibly compressed) text input
+ *  the file is memory-mapped; plain text is handed out as a single window,
+ *  gzip, xz and zstd input (detected by its magic bytes) is decompressed
+ *  chunk by chunk into a fixed buffer, so the text never exists as a whole.
+ *  Every window ends at a line break, except for the last one.
+ *
+ *  Support for the compressed formats is compiled in with
+ *  -DHAVE_ZLIB, -DHAVE_LZMA and -DHAVE_ZSTD.
+ */
+class CInputReader
+{
+public:
+
+    enum InputFormat
+    {
+        IF_PLAIN = 0,
+        IF_GZIP,
+        IF_XZ,
+        IF_ZSTD
+    };
+
+private:
+
+    CMappedFile theFile;
+    InputFormat theFormat;
+
+    /// decompression state, only used for compressed input
+    void *theStream;
+    size_t iInputOfs;
+
+    vector<char> theBuffer;
+    size_t iFilled;
+    size_t iWindowEnd;
+
+    bool reachedEOF;
+    size_t iDecompressed;
+
+    string theError;
+
+    /// decompresses up to maxBytes into dest, returns the number of bytes written
+    size_t decompress(char *dest, size_t maxBytes);
+
+    void releaseStream();
+
+public:
+
+    CInputReader();
+    ~CInputReader();
+
+    /// opens the file and detects its format;
+    /// returns false if it could not be opened or its format is not supported
+    bool open(const char *lpstrFileName);
+
+    void close();
+
+    /// the next window [begin, end) of text; false once the input is exhausted
+    bool nextWindow(const char *&begin, const char *&end);
+
+    /// true if the window handed out last is the final one
+    bool atEnd() const
+    {
+        return reachedEOF && iWindowEnd == iFilled;
+    }
+
+    bool failed() const
+    {
+        return !theError.empty();
+    }
+
+    const string &getError() const
+    {
+        return theError;
+    }
+
+    InputFormat getFormat() const
+    {
+        return theFormat;
+    }
+
+    static const char *formatName(InputFormat fmt);
+
+    /// size of the file on disk
+    size_t getFileSize() const
+    {
+        return theFile.size();
+    }
+
+    /// number of text bytes handed out so far
+    size_t getTextSize() const
+    {
+        return iDecompressed;
+    }
+};
+
+#endif
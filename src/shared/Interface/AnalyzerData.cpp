@@ -10,6 +10,9 @@ AnalyzerData::AnalyzerData()
 
 void AnalyzerData::init()
 {
+    elapsedTime = 0.0;
+    theExitState = ABORTED;
+
     nVars = 0;
     nUsedVars = 0;
 
@@ -26,12 +29,16 @@ void AnalyzerData::init()
 
     rnProbOfSat = 0.0;
 
+    weighted = false;
+    rnWeightedCount = 0.0;
+
     nConflicts = 0;
     nImplications = 0;
     nImplicitImplications = 0;
     nProcessedComponents = 0;
 
     maxDecLevel = 0;
+    maxSolutionLevel = 0;
     nDecisions = 0;
 }
 
@@ -88,6 +95,11 @@ void AnalyzerData::loadFromFile(const char *lpcstrFileName)
             {
                 in >> rnProbOfSat;
             }
+            else if (!strcmp(desc,"weightedCount"))
+            {
+                in.getline(buf,sz);
+                weighted = from_stringT(rnWeightedCount,buf);
+            }
         }
     }
 }
@@ -127,6 +139,12 @@ void AnalyzerData::writeToFile(const char *lpcstrFileName) const
     out<<"rnProbOfSAT"<<endl;
     out<<rnProbOfSat<<endl;
 #endif
+
+    if (weighted)
+    {
+        out<<"weightedCount"<<endl;
+        out<<to_stringT(rnWeightedCount)<<endl;
+    }
 }
 
 
@@ -242,7 +260,7 @@ AnalyzerData::~AnalyzerData()
 
 CRunAnalyzer::CRunAnalyzer()
 {
-    // insert your code here
+    first = true;
 }
 
 
@@ -321,6 +339,34 @@ void CRunAnalyzer::addClause()
     theData.nAddedClauses++;
 }
 
+void CRunAnalyzer::addSearchData(const CRunAnalyzer &other)
+{
+    const AnalyzerData &rOther = other.theData;
+
+    theData.nAddedClauses += rOther.nAddedClauses;
+    theData.nReceivedSatAssignments += rOther.nReceivedSatAssignments;
+    theData.nDecisions += rOther.nDecisions;
+    theData.nImplications += rOther.nImplications;
+    theData.nImplicitImplications += rOther.nImplicitImplications;
+    theData.nConflicts += rOther.nConflicts;
+    theData.nProcessedComponents += rOther.nProcessedComponents;
+
+    if (rOther.maxDecLevel > theData.maxDecLevel)
+        theData.maxDecLevel = rOther.maxDecLevel;
+
+    // the averages are still sums
+    theData.evalData[AVG_DEC_LEV] += rOther.evalData[AVG_DEC_LEV];
+    theData.evalData[AVG_CONFLICT_LEV] += rOther.evalData[AVG_CONFLICT_LEV];
+    theData.evalData[AVG_SOLUTION_LEV] += rOther.evalData[AVG_SOLUTION_LEV];
+    theData.evalData[AVG_CCL_lastUIP] += rOther.evalData[AVG_CCL_lastUIP];
+    theData.evalData[AVG_CCL_1stUIP] += rOther.evalData[AVG_CCL_1stUIP];
+
+    if (rOther.evalData[LONGEST_CCL_lastUIP] > theData.evalData[LONGEST_CCL_lastUIP])
+        theData.evalData[LONGEST_CCL_lastUIP] = rOther.evalData[LONGEST_CCL_lastUIP];
+    if (rOther.evalData[LONGEST_CCL_1stUIP] > theData.evalData[LONGEST_CCL_1stUIP])
+        theData.evalData[LONGEST_CCL_1stUIP] = rOther.evalData[LONGEST_CCL_1stUIP];
+}
+
 
 void CRunAnalyzer::setUsedVars(unsigned int nUsedVars)
 {
@@ -35,10 +35,38 @@ enum DATA_IDX
 
     FCACHE_MAXMEM,  // Formula Cache Memoery Bound
     FCACHE_MEMUSE,  // Formula Cache memory usage
-    FCACHE_USEDBUCKETS, // number of hashbuckets used
+    FCACHE_USEDBUCKETS, // number of occupied hash table slots
     FCACHE_CACHEDCOMPS,
     FCACHE_RETRIEVALS, // number of retrieved components
     FCACHE_INCLUDETRIES, // number of times it was tried to put a component into the cache
+    FCACHE_TABLESLOTS, // size of the hash table
+    FCACHE_AVGPROBELEN, // avg number of slots inspected by a lookup
+    FCACHE_MAXPROBELEN, // longest probe sequence of a lookup
+    FCACHE_HASHCOLLISIONS, // lookups that compared a different component with the same hash key
+    FCACHE_EVICTED, // number of entries evicted
+    FCACHE_PAUSES_100US, // eviction steps that took less than 0.1ms
+    FCACHE_PAUSES_1MS, // ... less than 1ms
+    FCACHE_PAUSES_10MS, // ... less than 10ms
+    FCACHE_PAUSES_100MS, // ... less than 100ms
+    FCACHE_PAUSES_SLOW, // ... 100ms or more
+    FCACHE_MAXPAUSE, // longest eviction step in ms
+    FCACHE_SHAREDLOOKUPS, // lookups of the solvers of component tasks
+    FCACHE_SHAREDHITS, // ... that found the component
+    FCACHE_CONTENDED, // ... that missed because the shard was being changed
+    FCACHE_LOCKWAITS, // changes of a shard that waited for a reader
+
+    DT_NODES, // d-DNNF nodes allocated
+    DT_MEMUSE, // memory used by the d-DNNF nodes in bytes
+    DT_BYTESPERNODE, // DT_MEMUSE / DT_NODES
+    DT_MERGEDNODES, // nodes of the d-DNNF replaced by an identical node
+    DT_MERGETIME, // time spent merging identical nodes
+    DT_COMPRESSTIME, // time spent compressing the d-DNNF after the search
+
+    PARSE_MBYTES, // size of the cnf text in MB
+    PARSE_TIME, // time spent reading the cnf file
+    PARSE_MBPERSEC, // parse throughput
+    PARSE_COMPRESSED_MBYTES, // size of the cnf file on disk if it was compressed
+    PARSE_COMPRESSED_MBPERSEC, // parse throughput in compressed MB
     XX_MAX_IDX
 };
 
@@ -46,9 +74,17 @@ enum DATA_IDX
 static const char * doubleDataDesc[] =
 {
     "avg dec dl","avg conflict dl","avg solution dl","longest ccl lastUIP","avg ccl lastUIP","longest ccl firstUIP","avg ccl firstUIP",
-    "cacher memory bound", "cache mem-usage","cache used buckets","cache cached components","cache retrievals", "cache include tries","NOTHING"
+    "cacher memory bound", "cache mem-usage","cache used buckets","cache cached components","cache retrievals", "cache include tries",
+    "cache table slots","cache avg probe length","cache max probe length","cache hash collisions",
+    "cache evicted","cache pauses <0.1ms","cache pauses <1ms","cache pauses <10ms","cache pauses <100ms","cache pauses >=100ms","cache max pause ms",
+    "cache shared lookups","cache shared hits","cache contended","cache lock waits",
+    "ddnnf nodes","ddnnf mem-usage","ddnnf bytes per node","ddnnf merged nodes","ddnnf merge time","ddnnf compress time",
+    "parse MB","parse time","parse MB per sec","parse compressed MB","parse compressed MB per sec","NOTHING"
 };
 
+static_assert(sizeof(doubleDataDesc)/sizeof(*doubleDataDesc) == XX_MAX_IDX + 1,
+              "doubleDataDesc needs one string per DATA_IDX");
+
 
 enum INT_DATA_ID
 {
@@ -139,6 +175,10 @@ public:
     /// Wahrscheinlichkeit der Erfuellbarkeit der Instanz
     CRealNum rnProbOfSat;
 
+    /// the weighted model count, if the instance has literal weights
+    bool weighted;
+    CRealNum rnWeightedCount;
+
     // class constructor
     AnalyzerData();
     // class destructor
@@ -247,6 +287,10 @@ public:
 
     void addClause();
 
+    /// adds the search counters of another run, e.g. of another thread
+    /// of the same search, before finishcountSATAnalysis()
+    void addSearchData(const CRunAnalyzer &other);
+
     void setSatCount(const CRealNum  &rnCodedSols);
 
     void setSatProb(const CRealNum  &rnProb)
@@ -254,6 +298,12 @@ public:
         theData.rnProbOfSat = rnProb;
     }
 
+    void setWeightedCount(const CRealNum &rnCount)
+    {
+        theData.weighted = true;
+        theData.rnWeightedCount = rnCount;
+    }
+
 
 
     void setExitState(SOLVER_StateT st)
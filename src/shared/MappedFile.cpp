@@ -0,0 +1,97 @@
+#include "MappedFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+// no mmap available, the file is read into a heap block instead
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool CMappedFile::open(const char *lpstrFileName)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(lpstrFileName, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    theSize = st.st_size;
+
+    if (theSize > 0)
+    {
+        void *p = mmap(NULL, theSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            // the parser reads the file front to back exactly once
+            madvise(p, theSize, MADV_SEQUENTIAL);
+            theData = (const char *) p;
+            isMapped = true;
+        }
+    }
+    ::close(fd);
+
+    if (isMapped || theSize == 0)
+        return true;
+    // mapping failed (e.g. a pipe), fall back to reading the file
+#endif
+
+    FILE *filedesc = fopen(lpstrFileName, "rb");
+    if (filedesc == NULL)
+        return false;
+
+    size_t cap = 1 << 20;
+    char *buf = (char *) malloc(cap);
+    size_t n;
+
+    theSize = 0;
+    while (buf != NULL && (n = fread(buf + theSize, 1, cap - theSize, filedesc)) > 0)
+    {
+        theSize += n;
+        if (theSize == cap)
+        {
+            char *grown = (char *) realloc(buf, cap *= 2);
+            if (grown == NULL)
+                free(buf);
+            buf = grown;
+        }
+    }
+    fclose(filedesc);
+
+    if (buf == NULL)
+    {
+        theSize = 0;
+        return false;
+    }
+
+    theData = buf;
+    return true;
+}
+
+void CMappedFile::close()
+{
+    if (theData != NULL)
+    {
+#ifndef _WIN32
+        if (isMapped)
+            munmap((void *) theData, theSize);
+        else
+#endif
+            free((void *) theData);
+    }
+    theData = NULL;
+    theSize = 0;
+    isMapped = false;
+}
@@ -0,0 +1,49 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <stddef.h>
+
+/** read-only view of a whole file
+ *  on POSIX systems the file is memory-mapped, so the bytes are read
+ *  straight from the page cache without being copied into a stream buffer;
+ *  elsewhere the file is read into one heap block.
+ */
+class CMappedFile
+{
+    const char *theData;
+    size_t theSize;
+
+    bool isMapped;
+
+public:
+
+    CMappedFile()
+        : theData(NULL), theSize(0), isMapped(false)
+    {}
+
+    ~CMappedFile()
+    {
+        close();
+    }
+
+    bool open(const char *lpstrFileName);
+
+    void close();
+
+    const char *begin() const
+    {
+        return theData;
+    }
+
+    const char *end() const
+    {
+        return theData + theSize;
+    }
+
+    size_t size() const
+    {
+        return theSize;
+    }
+};
+
+#endif
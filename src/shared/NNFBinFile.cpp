@@ -0,0 +1,180 @@
+#include "NNFBinFile.h"
+
+#include <string.h>
+
+bool CNNFBinWriter::open(const char *lpstrFileName, uint64_t nNodes,
+                         uint64_t nEdges, uint64_t nVars)
+{
+    if (!theFile.open(lpstrFileName))
+        return false;
+
+    NNFBinHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, NNF_BIN_MAGIC, 8);
+    hdr.version = NNF_BIN_VERSION;
+    hdr.byteOrderMark = NNF_BIN_BYTEORDER;
+    hdr.nNodes = nNodes;
+    hdr.nEdges = nEdges;
+    hdr.nVars = nVars;
+
+    theFile.write(&hdr, sizeof(hdr));
+
+    nExpectedNodes = nNodes;
+    iNodes = 0;
+    return true;
+}
+
+void CNNFBinWriter::putVarUInt(uint64_t n)
+{
+    while (n >= 0x80)
+    {
+        theFile.put((char) (n | 0x80));
+        n >>= 7;
+    }
+    theFile.put((char) n);
+}
+
+void CNNFBinWriter::addLit(int64_t lit)
+{
+    theFile.put('L');
+    putVarUInt((lit < 0) ? 2 * (uint64_t) (-(lit + 1)) + 1 : 2 * (uint64_t) lit);
+    iNodes++;
+}
+
+void CNNFBinWriter::beginAnd(uint64_t nChildren)
+{
+    theFile.put('A');
+    putVarUInt(nChildren);
+    iNodes++;
+}
+
+void CNNFBinWriter::beginOr(uint64_t choiceVar, uint64_t nChildren)
+{
+    theFile.put('O');
+    putVarUInt(choiceVar);
+    putVarUInt(nChildren);
+    iNodes++;
+}
+
+void CNNFBinWriter::addChild(uint64_t child)
+{
+    putVarUInt(iNodes - 1 - child);
+}
+
+bool CNNFBinWriter::close()
+{
+    bool ok = theFile.close();
+    return ok && (iNodes == nExpectedNodes);
+}
+
+bool CNNFBinReader::open(const char *lpstrFileName, string &err)
+{
+    if (!theFile.open(lpstrFileName))
+    {
+        err = "can not be read";
+        return false;
+    }
+
+    if (theFile.size() < sizeof(NNFBinHeader)
+            || memcmp(theFile.begin(), NNF_BIN_MAGIC, 8) != 0)
+    {
+        err = "is not a binary nnf file";
+        return false;
+    }
+    memcpy(&theHeader, theFile.begin(), sizeof(theHeader));
+
+    if (theHeader.byteOrderMark != NNF_BIN_BYTEORDER)
+    {
+        err = "was written on a machine with a different byte order";
+        return false;
+    }
+    if (theHeader.version != NNF_BIN_VERSION)
+    {
+        err = "has an unsupported version";
+        return false;
+    }
+
+    rewind();
+    return true;
+}
+
+void CNNFBinReader::rewind()
+{
+    thePos = (const unsigned char *) theFile.begin() + sizeof(NNFBinHeader);
+    iNode = 0;
+}
+
+bool CNNFBinReader::readVarUInt(uint64_t &n)
+{
+    const unsigned char *end = (const unsigned char *) theFile.end();
+
+    n = 0;
+    for (int shift = 0; shift < 64 && thePos < end; shift += 7)
+    {
+        unsigned char b = *thePos++;
+        n |= (uint64_t) (b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool CNNFBinReader::next(NNFBinNode &rNode, string &err)
+{
+    const unsigned char *end = (const unsigned char *) theFile.end();
+
+    if (iNode == theHeader.nNodes)
+    {
+        if (thePos != end)
+            err = "has trailing data";
+        return false;
+    }
+    if (thePos == end)
+    {
+        err = "is truncated";
+        return false;
+    }
+
+    rNode.type = (char) *thePos++;
+    rNode.lit = 0;
+    rNode.choiceVar = 0;
+    rNode.children.clear();
+
+    uint64_t n = 0;
+    bool ok = true;
+
+    switch (rNode.type)
+    {
+    case 'L':
+        ok = readVarUInt(n);
+        rNode.lit = (n & 1) ? -(int64_t) (n >> 1) - 1 : (int64_t) (n >> 1);
+        break;
+    case 'O':
+        ok = readVarUInt(rNode.choiceVar);
+        // fall through
+    case 'A':
+        ok = ok && readVarUInt(n);
+        // every child takes at least one byte
+        ok = ok && n <= (uint64_t) (end - thePos);
+        if (ok)
+            rNode.children.resize(n);
+        for (uint64_t i = 0; ok && i < n; i++)
+        {
+            uint64_t dist;
+            ok = readVarUInt(dist) && dist >= 1 && dist <= iNode;
+            rNode.children[i] = iNode - dist;
+        }
+        break;
+    default:
+        ok = false;
+    }
+
+    if (!ok)
+    {
+        err = "has a malformed node";
+        return false;
+    }
+
+    iNode++;
+    return true;
+}
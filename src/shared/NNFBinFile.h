@@ -0,0 +1,143 @@
+#ifndef NNFBINFILE_H
+#define NNFBINFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include <MappedFile.h>
+#include <OutputFile.h>
+
+using std::vector;
+using std::string;
+
+/** Binary nnf format, the d-DNNF of the text nnf format in a compact form
+ *
+ *  header      NNFBinHeader
+ *  nodes       nNodes nodes, numbered from 0 in the order they are stored,
+ *              every node after all of its children:
+ *                'L' lit
+ *                'A' nChildren child_1 .. child_n
+ *                'O' choiceVar nChildren child_1 .. child_n
+ *
+ *  The node type is one byte, all numbers after it are unsigned LEB128
+ *  varints. A literal is zigzag encoded first (2v for v >= 0, -2v - 1
+ *  otherwise), a child is stored as the distance from the node number
+ *  down to the child number. True is an 'A' and False an 'O' 0 node
+ *  without children, as in the text format.
+ *
+ *  Children always come before their parents, so one front to back pass
+ *  over the mapped file evaluates the whole d-DNNF and nothing has to be
+ *  parsed when a file is opened. The header fields are stored in the byte
+ *  order of the writing machine.
+ */
+
+#define NNF_BIN_MAGIC "dsharpNB"
+#define NNF_BIN_VERSION 1
+#define NNF_BIN_BYTEORDER 0x01020304
+
+struct NNFBinHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+
+    /// as in the nnf line of the text format
+    uint64_t nNodes;
+    uint64_t nEdges;
+    uint64_t nVars;
+};
+
+/// one decoded node
+struct NNFBinNode
+{
+    char type;                  // 'L', 'A' or 'O'
+    int64_t lit;                // of an 'L' node
+    uint64_t choiceVar;         // of an 'O' node
+    vector<uint64_t> children;  // node numbers
+};
+
+/// writes the nodes in the order of their numbers
+class CNNFBinWriter
+{
+    COutputFile theFile;
+
+    uint64_t nExpectedNodes;
+    uint64_t iNodes;
+
+    void putVarUInt(uint64_t n);
+
+public:
+
+    CNNFBinWriter()
+        : nExpectedNodes(0), iNodes(0)
+    {}
+
+    /// creates the file and writes the header
+    bool open(const char *lpstrFileName, uint64_t nNodes, uint64_t nEdges,
+              uint64_t nVars);
+
+    void addLit(int64_t lit);
+    void beginAnd(uint64_t nChildren);
+    void beginOr(uint64_t choiceVar, uint64_t nChildren);
+
+    /// a child of the node begun last, by its node number
+    void addChild(uint64_t child);
+
+    /// returns false if a write failed or the number of nodes written
+    /// differs from the header
+    bool close();
+};
+
+/// read-only view of a memory-mapped binary nnf file
+class CNNFBinReader
+{
+    CMappedFile theFile;
+    NNFBinHeader theHeader;
+
+    const unsigned char *thePos;
+    uint64_t iNode;
+
+    bool readVarUInt(uint64_t &n);
+
+public:
+
+    CNNFBinReader()
+        : thePos(NULL), iNode(0)
+    {}
+
+    /// maps the file and checks the header, returns false and sets err
+    /// if it is no binary nnf file
+    bool open(const char *lpstrFileName, string &err);
+
+    void close()
+    {
+        theFile.close();
+        thePos = NULL;
+    }
+
+    uint64_t countNodes() const
+    {
+        return theHeader.nNodes;
+    }
+
+    uint64_t countEdges() const
+    {
+        return theHeader.nEdges;
+    }
+
+    uint64_t countVars() const
+    {
+        return theHeader.nVars;
+    }
+
+    /// the next call of next() returns node 0
+    void rewind();
+
+    /// decodes the next node, returns false after the last node (err is
+    /// left empty then) and on a malformed file (err is set)
+    bool next(NNFBinNode &rNode, string &err);
+};
+
+#endif
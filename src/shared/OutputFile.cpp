@@ -0,0 +1,112 @@
+#include "OutputFile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool COutputFile::open(const char *lpstrFileName)
+{
+    close();
+
+    theBuffer = (char *) malloc(BUFFER_SIZE);
+    if (theBuffer == NULL)
+        return false;
+
+    theFile = fopen(lpstrFileName, "wb");
+    if (theFile == NULL)
+    {
+        free(theBuffer);
+        theBuffer = NULL;
+        return false;
+    }
+
+    // the buffer here is large enough, stdio does not need one of its own
+    setvbuf(theFile, NULL, _IONBF, 0);
+
+    theFill = 0;
+    isOk = true;
+    return true;
+}
+
+bool COutputFile::openMemory(std::string &rTarget)
+{
+    close();
+
+    theBuffer = (char *) malloc(BUFFER_SIZE);
+    if (theBuffer == NULL)
+        return false;
+
+    pMemory = &rTarget;
+    theFill = 0;
+    isOk = true;
+    return true;
+}
+
+bool COutputFile::close()
+{
+    if (theFile == NULL && pMemory == NULL)
+        return isOk;
+
+    flush();
+    if (theFile != NULL)
+        isOk = (fclose(theFile) == 0) && isOk;
+
+    free(theBuffer);
+    theFile = NULL;
+    pMemory = NULL;
+    theBuffer = NULL;
+
+    return isOk;
+}
+
+void COutputFile::flush()
+{
+    if (theFill > 0 && pMemory != NULL)
+        pMemory->append(theBuffer, theFill);
+    else if (theFill > 0 && fwrite(theBuffer, 1, theFill, theFile) != theFill)
+        isOk = false;
+    theFill = 0;
+}
+
+void COutputFile::put(const char *str)
+{
+    write(str, strlen(str));
+}
+
+void COutputFile::putUInt(uint64_t n)
+{
+    // 20 digits hold any 64 bit number
+    if (BUFFER_SIZE - theFill < 20)
+        flush();
+
+    char digits[20];
+    int len = 0;
+    do
+    {
+        digits[len++] = '0' + (char) (n % 10);
+        n /= 10;
+    }
+    while (n != 0);
+
+    while (len > 0)
+        theBuffer[theFill++] = digits[--len];
+}
+
+void COutputFile::write(const void *data, size_t len)
+{
+    const char *p = (const char *) data;
+
+    while (len > 0)
+    {
+        if (theFill == BUFFER_SIZE)
+            flush();
+
+        size_t n = BUFFER_SIZE - theFill;
+        if (n > len)
+            n = len;
+
+        memcpy(theBuffer + theFill, p, n);
+        theFill += n;
+        p += n;
+        len -= n;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef OUTPUTFILE_H
+#define OUTPUTFILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+/** buffered output to a file
+ *  the bytes are collected in one large buffer and handed to the file in
+ *  whole blocks, nothing is flushed per line. Numbers are formatted
+ *  straight into the buffer. The blocks can also go to a string instead
+ *  of a file.
+ */
+class COutputFile
+{
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    FILE *theFile;
+    std::string *pMemory;
+    char *theBuffer;
+    size_t theFill;
+
+    bool isOk;
+
+    void flush();
+
+    COutputFile(const COutputFile &);
+    COutputFile &operator=(const COutputFile &);
+
+public:
+
+    COutputFile()
+        : theFile(NULL), pMemory(NULL), theBuffer(NULL), theFill(0), isOk(false)
+    {}
+
+    ~COutputFile()
+    {
+        close();
+    }
+
+    bool open(const char *lpstrFileName);
+
+    /// appends the output to rTarget, which has to live until close()
+    bool openMemory(std::string &rTarget);
+
+    /// writes what is left in the buffer and closes the file (or lets go
+    /// of the string), returns false if any write failed
+    bool close();
+
+    void put(char c)
+    {
+        if (theFill == BUFFER_SIZE)
+            flush();
+        theBuffer[theFill++] = c;
+    }
+
+    void put(const char *str);
+
+    void putUInt(uint64_t n);
+
+    void putInt(int64_t n)
+    {
+        if (n < 0)
+        {
+            put('-');
+            putUInt(-(uint64_t) n);
+        }
+        else
+            putUInt(n);
+    }
+
+    void write(const void *data, size_t len);
+};
+
+#endif
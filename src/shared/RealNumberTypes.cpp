@@ -1,6 +1,8 @@
 #include "RealNumberTypes.h"
 
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #ifdef GMP_BIGNUM
 
@@ -31,6 +33,40 @@ double to_doubleT(const mpf_class &num)
     return mpf_get_d(num.get_mpf_t());
 }
 
+// all significant digits, so that from_stringT restores num exactly
+std::string to_stringT(const mpf_class &num)
+{
+    mp_exp_t exp;
+    std::string digits = num.get_str(exp, 10, 0);
+    if (digits.empty())
+        return "0";
+
+    std::string sign;
+    if (digits[0] == '-')
+    {
+        sign = "-";
+        digits.erase(0, 1);
+    }
+    char buf[32];
+    sprintf(buf, "e%ld", (long) exp);
+    return sign + "0." + digits + buf;
+}
+
+// the nearest integer in plain decimal digits, for counts of models
+//  that went through probabilities
+std::string to_intStringT(const mpf_class &num)
+{
+    mpf_class rounded(num, num.get_prec());
+    rounded += 0.5;
+    mpz_class res(rounded);
+    return res.get_str(10);
+}
+
+bool from_stringT(mpf_class &res, const char *str)
+{
+    return res.set_str(str, 10) == 0;
+}
+
 #else
 
 bool pow(CRealNum &res, double &base, unsigned long int iExp)
@@ -39,16 +75,17 @@ bool pow(CRealNum &res, double &base, unsigned long int iExp)
     return true;
 }
 
+// ldexpl keeps the long double range, pow(2.00, iExp) is inf above 2^1023
 bool pow2(CRealNum &res, unsigned long int iExp)
 {
-    res = pow(2.00, iExp);
+    res = ldexpl(1.0L, (int) iExp);
     return true;
 }
 
 
 bool to_div_2exp(CRealNum &res, const CRealNum &op1, unsigned long int iExp)
 {
-    res  = op1 / pow(2.00,iExp);
+    res = ldexpl(op1, -(int) iExp);
     return true;
 }
 
@@ -57,4 +94,28 @@ long double to_doubleT(const CRealNum &num)
 {
     return (long double) num;
 }
+
+// 21 significant digits restore a 64 bit mantissa exactly
+std::string to_stringT(const CRealNum &num)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.21Lg", num);
+    return buf;
+}
+
+// the nearest integer in plain decimal digits, for counts of models
+//  that went through probabilities
+std::string to_intStringT(const CRealNum &num)
+{
+    char buf[5000];
+    snprintf(buf, sizeof(buf), "%.0Lf", roundl(num));
+    return buf;
+}
+
+bool from_stringT(CRealNum &res, const char *str)
+{
+    char *end;
+    res = strtold(str, &end);
+    return end != str && *end == 0;
+}
 #endif
@@ -1,7 +1,7 @@
 #ifndef REALNUMBERTYPES_H
 #define REALNUMBERTYPES_H
 
-
+#include <string>
 
 
 #ifdef GMP_BIGNUM
@@ -11,6 +11,9 @@ extern bool pow(mpf_class &res, const mpf_class &base, unsigned long int iExp);
 extern bool pow2(mpf_class &res, unsigned long int iExp);
 extern bool to_div_2exp(mpf_class &res, const mpf_class &op1, unsigned long int iExp);
 extern double to_doubleT(const mpf_class &num);
+extern std::string to_stringT(const mpf_class &num);
+extern std::string to_intStringT(const mpf_class &num);
+extern bool from_stringT(mpf_class &res, const char *str);
 
 
 
@@ -21,6 +24,9 @@ extern bool pow(CRealNum &res, CRealNum base, unsigned long int iExp);
 extern bool pow2(CRealNum &res, unsigned long int iExp);
 extern bool to_div_2exp(CRealNum &res, const CRealNum &op1, unsigned long int iExp);
 extern long double to_doubleT(const CRealNum &num);
+extern std::string to_stringT(const CRealNum &num);
+extern std::string to_intStringT(const CRealNum &num);
+extern bool from_stringT(CRealNum &res, const char *str);
 #endif
 
 #endif
@@ -1,6 +1,5 @@
 #include "SomeTime.h"
 
-int CStepTime::timeVal = 0;
 
 
 
@@ -7,23 +7,28 @@
 
 extern bool diffTimes(timeval& ret, const timeval &tLater, const timeval &tEarlier);
 
+// the steps of the search of a solver
 class CStepTime
 {
-    static int timeVal;
+    int timeVal;
 
 public:
 
-    static void makeStart()
+    CStepTime() : timeVal(0)
+    {
+    }
+
+    void makeStart()
     {
         timeVal = 0;
     }
 
-    static int getTime()
+    int getTime() const
     {
         return timeVal;
     }
 
-    static void stepTime()
+    void stepTime()
     {
         timeVal++;
     }
@@ -1,27 +1,15 @@
 #include "Basics.h"
 
 
-bool CSolverConf::analyzeConflicts = true;
-bool CSolverConf::doNonChronBackTracking = true;
-
-bool CSolverConf::allowComponentCaching = true;
-bool CSolverConf::allowImplicitBCP = true;
-
-bool CSolverConf::allowPreProcessing = true;
-
-bool CSolverConf::quietMode = false;
-
-bool CSolverConf::smoothNNF = false;
-
-bool CSolverConf::ensureAllLits = true;
-
-bool CSolverConf::disableDynamicDecomp = false;
-
-unsigned int CSolverConf::secsTimeBound = 100000;
-
-size_t CSolverConf::maxCacheSize = 0;
+CSolverConf::CSolverConf()
+    : analyzeConflicts(true), doNonChronBackTracking(true), quietMode(false),
+      allowComponentCaching(true), allowImplicitBCP(true), allowPreProcessing(true),
+      secsTimeBound(100000), maxCacheSize(0), smoothNNF(false), ensureAllLits(true),
+      disableDynamicDecomp(false), countOnly(false), mergeNodes(true), nThreads(1)
+{
+}
 
-int CSolverConf::nodeCount = 0;
+thread_local CSolverConf *CSolverConf::pBound = NULL;
 
 
 char TriValuetoChar(TriValue v)
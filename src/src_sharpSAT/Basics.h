@@ -10,51 +10,72 @@
 
 #define FULL_DDNNF
 
+/** The options of a solver
+ *
+ *  Every solver context (see SolverContext.h) has options of its own,
+ *  theConf() are the ones of the context bound to the calling thread.
+ */
 class CSolverConf
 {
 public:
-    static bool analyzeConflicts;
-    static bool doNonChronBackTracking;
+    bool analyzeConflicts;
+    bool doNonChronBackTracking;
 
-    static bool quietMode;
+    // the worker threads of the parallel search print nothing
+    bool quietMode;
 
-    static bool allowComponentCaching;
-    static bool allowImplicitBCP;
+    bool allowComponentCaching;
+    bool allowImplicitBCP;
 
-    static bool allowPreProcessing;
+    bool allowPreProcessing;
 
-    static unsigned int secsTimeBound;
+    unsigned int secsTimeBound;
 
-    static size_t maxCacheSize;   // maximum Cache Size in bytes
-    
-    static int nodeCount; // Nodes currently in use
-    
-    static bool smoothNNF;
-    static bool ensureAllLits;
-    
-    static bool disableDynamicDecomp;
+    size_t maxCacheSize;   // maximum Cache Size in bytes, 0 for half the free memory
+
+    bool smoothNNF;
+    bool ensureAllLits;
+
+    bool disableDynamicDecomp;
+
+    bool countOnly; // only count the models, no d-DNNF is built
+
+    bool mergeNodes; // merge structurally identical d-DNNF nodes
+
+    unsigned int nThreads; // threads of the search, see ComponentTasks.h
 
     CSolverConf();
 
-    ~CSolverConf();
+    // the options of the context bound to this thread, NULL until the
+    // thread binds one or asks for theConf()
+    static thread_local CSolverConf *pBound;
 
+    // binds the default context of this thread
+    static void bindDefault();
 };
 
+inline CSolverConf &theConf()
+{
+    if (CSolverConf::pBound == NULL)
+        CSolverConf::bindDefault();
+    return *CSolverConf::pBound;
+}
+
 #ifdef COMPILE_FOR_GUI
 #define toSTDOUT(X)
 #else
-#define toSTDOUT(X)	if(!CSolverConf::quietMode) std::cout << X;
+#define toSTDOUT(X)	if(!theConf().quietMode) std::cout << X;
 #endif
 
 
 #ifdef COMPILE_FOR_GUI
 #define toERROUT(X)
 #else
-#define toERROUT(X)	if(!CSolverConf::quietMode) std::cout << X;
+#define toERROUT(X)	if(!theConf().quietMode) std::cout << X;
 #endif
 
 #ifdef DEBUG
-#define toDEBUGOUT(X) if(!CSolverConf::quietMode) std::cout << X;
+#define toDEBUGOUT(X) if(!theConf().quietMode) std::cout << X;
 #else
 #define toDEBUGOUT(X)
 #endif
@@ -0,0 +1,182 @@
+#include "DSharp.h"
+
+#include "MainSolver/MainSolver.h"
+
+CDSharp::CDSharp() : bLoaded(false), bCompiled(false)
+{
+    // the solver takes the options of the bound context on construction
+    CSolverContext::CBinding binding(theContext);
+    theSolver = new CMainSolver();
+}
+
+CDSharp::~CDSharp()
+{
+    CSolverContext::CBinding binding(theContext);
+    delete theSolver;
+}
+
+void CDSharp::setPriorityVars(const vector<int> &vars)
+{
+    theSolver->priorityVars.clear();
+    theSolver->priorityVars.insert(vars.begin(), vars.end());
+}
+
+void CDSharp::setCacheFile(const char *fileName)
+{
+    theSolver->setCacheFile(fileName);
+}
+
+bool CDSharp::load(const char *cnfFile)
+{
+    CSolverContext::CBinding binding(theContext);
+
+    theError.clear();
+    bCompiled = false;
+
+    // reading the formula already counts for the statistics
+    theContext.runAn = CRunAnalyzer();
+
+    bLoaded = theSolver->createfromFile(cnfFile, theError);
+    return bLoaded;
+}
+
+bool CDSharp::loadClauses(unsigned int nVars, const vector<int> &clauses)
+{
+    CSolverContext::CBinding binding(theContext);
+
+    theError.clear();
+    bCompiled = false;
+    bLoaded = false;
+
+    // createfromClauses trusts its input, the checks of readCNF are here
+    unsigned int nCls = 0;
+    for (unsigned int i = 0; i < clauses.size(); i++)
+    {
+        if (clauses[i] == 0)
+            nCls++;
+        else if ((unsigned int) abs(clauses[i]) > nVars)
+        {
+            theError = "literal " + std::to_string(clauses[i]) + " is no variable of 1.."
+                    + std::to_string(nVars);
+            return false;
+        }
+    }
+    if (!clauses.empty() && clauses.back() != 0)
+    {
+        theError = "the last clause does not end with 0";
+        return false;
+    }
+
+    theContext.runAn = CRunAnalyzer();
+
+    vector<int> litVec(clauses);
+    bLoaded = theSolver->createfromClauses(nVars, nCls, litVec);
+    if (!bLoaded)
+        theError = "can not create the formula";
+    return bLoaded;
+}
+
+bool CDSharp::setWeight(int lit, const CRealNum &weight)
+{
+    theError.clear();
+    if (!bLoaded || !theSolver->setLitWeight(lit, weight))
+    {
+        theError = "no literal " + std::to_string(lit) + " in a loaded formula";
+        return false;
+    }
+    return true;
+}
+
+SOLVER_StateT CDSharp::compile()
+{
+    CSolverContext::CBinding binding(theContext);
+
+    theError.clear();
+    if (!bLoaded)
+    {
+        theError = "no formula loaded";
+        return ABORTED;
+    }
+
+    theSolver->setTimeBound(theContext.conf.secsTimeBound);
+    theSolver->compile();
+    theContext.runAn.finishcountSATAnalysis();
+
+    // the search works on the formula, it has to be read again
+    bLoaded = false;
+    bCompiled = true;
+    return statistics().theExitState;
+}
+
+CRealNum CDSharp::count() const
+{
+    return statistics().getNumSatAssignments();
+}
+
+bool CDSharp::isWeighted() const
+{
+    return theSolver->isWeighted();
+}
+
+CRealNum CDSharp::weightedCount() const
+{
+    return statistics().rnWeightedCount;
+}
+
+CDAGEvaluator *CDSharp::dag()
+{
+    CSolverContext::CBinding binding(theContext);
+
+    if (!hasResult() || theContext.conf.countOnly)
+        return NULL;
+    return &theSolver->dagEvaluator();
+}
+
+bool CDSharp::writeNNF(const char *fileName)
+{
+    CSolverContext::CBinding binding(theContext);
+
+    theError.clear();
+    if (!hasResult() || theContext.conf.countOnly)
+    {
+        theError = "no d-DNNF compiled";
+        return false;
+    }
+    if (!theSolver->writeNNF(fileName, count() == 0))
+    {
+        theError = string("can not write ") + fileName;
+        return false;
+    }
+    return true;
+}
+
+bool CDSharp::writeNNFBin(const char *fileName)
+{
+    CSolverContext::CBinding binding(theContext);
+
+    theError.clear();
+    if (!hasResult() || theContext.conf.countOnly)
+    {
+        theError = "no d-DNNF compiled";
+        return false;
+    }
+    if (!theSolver->writeNNFBin(fileName, count() == 0))
+    {
+        theError = string("can not write ") + fileName;
+        return false;
+    }
+    return true;
+}
+
+bool CDSharp::writeNNF(string &rBuffer)
+{
+    CSolverContext::CBinding binding(theContext);
+
+    theError.clear();
+    if (!hasResult() || theContext.conf.countOnly)
+    {
+        theError = "no d-DNNF compiled";
+        return false;
+    }
+    return theSolver->writeNNF(rBuffer, count() == 0);
+}
@@ -0,0 +1,117 @@
+#ifndef DSHARP_H
+#define DSHARP_H
+
+#include <vector>
+#include <string>
+
+#include <RealNumberTypes.h>
+#include <Interface/AnalyzerData.h>
+
+#include "Basics.h"
+#include "SolverContext.h"
+
+using std::vector;
+using std::string;
+
+class CMainSolver;
+class CDAGEvaluator;
+
+/** The d-DNNF compiler of dsharp as a library
+ *
+ *  A compiler owns a solver and the solver context it runs in, its
+ *  options and statistics. Any number of compilers may work in one
+ *  process, each on one thread at a time: every member binds the context
+ *  of the compiler to the calling thread while it runs. A compilation
+ *  with options().nThreads > 1 starts threads of its own.
+ *
+ *  The options default to the ones of the dsharp binary. maxCacheSize
+ *  0 gives every compiler half of the free memory, so several compilers
+ *  at a time should get a bound each.
+ */
+class CDSharp
+{
+    CSolverContext theContext;
+    CMainSolver *theSolver;
+
+    bool bLoaded;
+    bool bCompiled;
+
+    string theError;
+
+    CDSharp(const CDSharp &);
+    CDSharp &operator=(const CDSharp &);
+
+public:
+
+    CDSharp();
+
+    ~CDSharp();
+
+    /// the options of the next compile(), see the flags of the binary
+    CSolverConf &options()
+    {
+        return theContext.conf;
+    }
+
+    /// the variables to decide on first, as with -priority
+    void setPriorityVars(const vector<int> &vars);
+
+    /// the persistent cache, as with -Fcache
+    void setCacheFile(const char *fileName);
+
+    /// reads a cnf file (text, compressed or binary, with weight lines).
+    /// Returns false with error() set if it can not be read.
+    bool load(const char *cnfFile);
+
+    /// takes the formula from memory: the literals of every clause
+    /// followed by a 0, over the variables 1..nVars
+    bool loadClauses(unsigned int nVars, const vector<int> &clauses);
+
+    /// the weight of a literal of the formula loaded last, as a weight
+    /// line would give it; the other literals weigh 1
+    bool setWeight(int lit, const CRealNum &weight);
+
+    /// compiles the formula loaded last: SUCCESS, TIMEOUT or ABORTED.
+    /// The search changes the formula, the next compile() needs a load().
+    SOLVER_StateT compile();
+
+    /// true after a compile() that did not time out or abort
+    bool hasResult() const
+    {
+        return bCompiled && statistics().theExitState == SUCCESS;
+    }
+
+    /// the model count of the last compile()
+    CRealNum count() const;
+
+    /// true if the cnf has weight lines
+    bool isWeighted() const;
+
+    CRealNum weightedCount() const;
+
+    /// the statistics of the last compile()
+    const AnalyzerData &statistics() const
+    {
+        return theContext.runAn.getData();
+    }
+
+    /// the d-DNNF of the last compile() flattened for queries, NULL if
+    /// there is none (-count or no successful compile)
+    CDAGEvaluator *dag();
+
+    /// write the d-DNNF of the last compile() in the nnf and the binary
+    /// nnf format; false with error() set if there is none or the file
+    /// can not be written
+    bool writeNNF(const char *fileName);
+    bool writeNNFBin(const char *fileName);
+
+    /// the nnf text of writeNNF appended to rBuffer
+    bool writeNNF(string &rBuffer);
+
+    const string &error() const
+    {
+        return theError;
+    }
+};
+
+#endif
@@ -0,0 +1,326 @@
+#include "DSharpC.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <exception>
+
+#include "DSharp.h"
+#include "MainSolver/DAGEvaluator.h"
+#include "MainSolver/ComponentTasks.h"
+
+struct dsharp_solver
+{
+    CDSharp theCompiler;
+
+    // the errors of the C layer, the ones of theCompiler otherwise
+    string theError;
+    bool bOwnError;
+};
+
+static int fail(dsharp_solver *s, const string &err)
+{
+    s->theError = err;
+    s->bOwnError = true;
+    return 0;
+}
+
+// for the catch clauses: an error message that can not be stored leaves
+// the error empty instead of throwing across the C interface
+static int fail(dsharp_solver *s, const std::exception &e)
+{
+    try
+    {
+        s->theError = e.what();
+    }
+    catch (...)
+    {
+        s->theError.clear();
+    }
+    s->bOwnError = true;
+    return 0;
+}
+
+static int result(dsharp_solver *s, bool ok)
+{
+    s->bOwnError = false;
+    return ok ? 1 : 0;
+}
+
+static char *copyString(const string &str)
+{
+    char *res = (char *) malloc(str.size() + 1);
+    if (res != NULL)
+        memcpy(res, str.c_str(), str.size() + 1);
+    return res;
+}
+
+dsharp_solver *dsharp_new(void)
+{
+    try
+    {
+        dsharp_solver *s = new dsharp_solver();
+        s->bOwnError = false;
+        // a library writes no progress to the stdout of its host
+        s->theCompiler.options().quietMode = true;
+        return s;
+    }
+    catch (const std::exception &)
+    {
+        return NULL;
+    }
+}
+
+void dsharp_free(dsharp_solver *s)
+{
+    delete s;
+}
+
+const char *dsharp_error(const dsharp_solver *s)
+{
+    return s->bOwnError ? s->theError.c_str() : s->theCompiler.error().c_str();
+}
+
+void dsharp_free_string(char *str)
+{
+    free(str);
+}
+
+int dsharp_set_option(dsharp_solver *s, const char *name, long value)
+{
+    try
+    {
+        CSolverConf &rConf = s->theCompiler.options();
+        bool on = (value != 0);
+
+        if (strcmp(name, "noNCB") == 0)
+            rConf.doNonChronBackTracking = !on;
+        else if (strcmp(name, "noCC") == 0)
+            rConf.allowComponentCaching = !on;
+        else if (strcmp(name, "noIBCP") == 0)
+            rConf.allowImplicitBCP = !on;
+        else if (strcmp(name, "noPP") == 0)
+            rConf.allowPreProcessing = !on;
+        else if (strcmp(name, "noCA") == 0)
+            rConf.analyzeConflicts = !on;
+        else if (strcmp(name, "noDynDecomp") == 0)
+            rConf.disableDynamicDecomp = on;
+        else if (strcmp(name, "noMerge") == 0)
+            rConf.mergeNodes = !on;
+        else if (strcmp(name, "smoothNNF") == 0)
+            rConf.smoothNNF = on;
+        else if (strcmp(name, "disableAllLits") == 0)
+            rConf.ensureAllLits = !on;
+        else if (strcmp(name, "count") == 0)
+            rConf.countOnly = on;
+        else if (strcmp(name, "q") == 0)
+            rConf.quietMode = on;
+        else if (strcmp(name, "t") == 0 && value > 0)
+            rConf.secsTimeBound = value;
+        else if (strcmp(name, "cs") == 0 && value > 0)
+            rConf.maxCacheSize = ((size_t) value) * 1024 * 1024;
+        else if (strcmp(name, "threads") == 0 && value > 0
+                && value <= CComponentTaskPool::MAX_THREADS)
+            rConf.nThreads = value;
+        else
+            return fail(s, string("no option ") + name + " = " + std::to_string(value));
+
+        return result(s, true);
+    }
+    catch (const std::exception &e)
+    {
+        return fail(s, e);
+    }
+}
+
+int dsharp_set_priority_vars(dsharp_solver *s, const int *vars, size_t n)
+{
+    try
+    {
+        s->theCompiler.setPriorityVars(vector<int>(vars, vars + n));
+        return result(s, true);
+    }
+    catch (const std::exception &e)
+    {
+        return fail(s, e);
+    }
+}
+
+int dsharp_load_file(dsharp_solver *s, const char *cnf_file)
+{
+    try
+    {
+        return result(s, s->theCompiler.load(cnf_file));
+    }
+    catch (const std::exception &e)
+    {
+        return fail(s, e);
+    }
+}
+
+int dsharp_load_clauses(dsharp_solver *s, unsigned int n_vars, const int *lits,
+                        size_t n_lits)
+{
+    try
+    {
+        return result(s, s->theCompiler.loadClauses(n_vars, vector<int>(lits, lits + n_lits)));
+    }
+    catch (const std::exception &e)
+    {
+        return fail(s, e);
+    }
+}
+
+int dsharp_set_weight(dsharp_solver *s, int lit, const char *weight)
+{
+    try
+    {
+        CRealNum w;
+        if (!from_stringT(w, weight))
+            return fail(s, string("no number: ") + weight);
+        return result(s, s->theCompiler.setWeight(lit, w));
+    }
+    catch (const std::exception &e)
+    {
+        return fail(s, e);
+    }
+}
+
+int dsharp_compile(dsharp_solver *s)
+{
+    try
+    {
+        SOLVER_StateT state = s->theCompiler.compile();
+        result(s, true);
+
+        if (!s->theCompiler.error().empty())
+            return DSHARP_ERROR;
+        switch (state)
+        {
+        case SUCCESS:
+            return DSHARP_SUCCESS;
+        case TIMEOUT:
+            return DSHARP_TIMEOUT;
+        default:
+            return DSHARP_ABORTED;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fail(s, e);
+        return DSHARP_ERROR;
+    }
+}
+
+// a search that timed out has no count
+static bool hasCount(dsharp_solver *s)
+{
+    if (s->theCompiler.hasResult())
+        return true;
+    fail(s, "no count compiled");
+    return false;
+}
+
+char *dsharp_count(dsharp_solver *s)
+{
+    try
+    {
+        if (!hasCount(s))
+            return NULL;
+        return copyString(to_intStringT(s->theCompiler.count()));
+    }
+    catch (const std::exception &e)
+    {
+        fail(s, e);
+        return NULL;
+    }
+}
+
+char *dsharp_weighted_count(dsharp_solver *s)
+{
+    try
+    {
+        if (!hasCount(s))
+            return NULL;
+        if (!s->theCompiler.isWeighted())
+            return copyString(to_intStringT(s->theCompiler.count()));
+        return copyString(to_stringT(s->theCompiler.weightedCount()));
+    }
+    catch (const std::exception &e)
+    {
+        fail(s, e);
+        return NULL;
+    }
+}
+
+size_t dsharp_dag_size(dsharp_solver *s)
+{
+    try
+    {
+        CDAGEvaluator *pDag = s->theCompiler.dag();
+        return (pDag != NULL) ? pDag->countNodes() : 0;
+    }
+    catch (const std::exception &e)
+    {
+        fail(s, e);
+        return 0;
+    }
+}
+
+int dsharp_dag_node(dsharp_solver *s, size_t i, dsharp_node *node)
+{
+    try
+    {
+        CDAGEvaluator *pDag = s->theCompiler.dag();
+        if (pDag == NULL || i >= pDag->countNodes())
+            return fail(s, "no d-DNNF node " + std::to_string(i));
+
+        switch (pDag->nodeType(i))
+        {
+        case DT_NodeType::kDTAnd:
+            node->type = DSHARP_AND;
+            break;
+        case DT_NodeType::kDTOr:
+            node->type = DSHARP_OR;
+            break;
+        case DT_NodeType::kDTLit:
+            node->type = DSHARP_LIT;
+            break;
+        case DT_NodeType::kDTTop:
+            node->type = DSHARP_TRUE;
+            break;
+        default:
+            node->type = DSHARP_FALSE;
+            break;
+        }
+        node->lit = pDag->nodeLit(i);
+        node->n_children = pDag->countChildren(i);
+        node->children = pDag->children(i);
+        return result(s, true);
+    }
+    catch (const std::exception &e)
+    {
+        return fail(s, e);
+    }
+}
+
+char *dsharp_nnf(dsharp_solver *s, size_t *len)
+{
+    try
+    {
+        string buffer;
+        if (!s->theCompiler.writeNNF(buffer))
+        {
+            result(s, false);
+            return NULL;
+        }
+        *len = buffer.size();
+        result(s, true);
+        return copyString(buffer);
+    }
+    catch (const std::exception &e)
+    {
+        fail(s, e);
+        return NULL;
+    }
+}
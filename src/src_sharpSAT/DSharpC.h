@@ -0,0 +1,98 @@
+#ifndef DSHARPC_H
+#define DSHARPC_H
+
+#include <stddef.h>
+
+/** The C interface of libdsharp
+ *
+ *  A dsharp_solver wraps a CDSharp (DSharp.h): solvers are independent,
+ *  any number of them may compile at the same time on different threads,
+ *  each one used by one thread at a time. Functions returning int give 1
+ *  on success and 0 on failure, dsharp_error() tells why. Strings
+ *  returned by the library are freed with dsharp_free_string().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct dsharp_solver dsharp_solver;
+
+/* the result of dsharp_compile() */
+#define DSHARP_SUCCESS 0
+#define DSHARP_TIMEOUT 1
+#define DSHARP_ABORTED 2
+#define DSHARP_ERROR   -1
+
+/* the node types of dsharp_dag_node() */
+#define DSHARP_AND   0
+#define DSHARP_OR    1
+#define DSHARP_LIT   2
+#define DSHARP_TRUE  3
+#define DSHARP_FALSE 4
+
+typedef struct dsharp_node
+{
+    int type;
+    int lit;                      /* of a DSHARP_LIT node */
+    size_t n_children;
+    const unsigned int *children; /* node indices, all below this node */
+} dsharp_node;
+
+dsharp_solver *dsharp_new(void);
+void dsharp_free(dsharp_solver *s);
+
+/* the last error of s, valid until the next call on s */
+const char *dsharp_error(const dsharp_solver *s);
+
+void dsharp_free_string(char *str);
+
+/* An option by the name of its flag of the binary without the dash:
+ * the switches noNCB, noCC, noIBCP, noPP, noCA, noDynDecomp, noMerge,
+ * smoothNNF, disableAllLits, count and q are set by a non-zero value
+ * (and cleared by 0), t takes seconds, cs megabytes and threads a count
+ * of at most 256.
+ * A new solver is quiet, q = 0 opts in to the progress output of the
+ * binary on stdout. */
+int dsharp_set_option(dsharp_solver *s, const char *name, long value);
+
+/* the variables to decide on first, as with -priority */
+int dsharp_set_priority_vars(dsharp_solver *s, const int *vars, size_t n);
+
+/* a cnf file, as the binary reads it */
+int dsharp_load_file(dsharp_solver *s, const char *cnf_file);
+
+/* n_lits literals over 1..n_vars, every clause followed by a 0 */
+int dsharp_load_clauses(dsharp_solver *s, unsigned int n_vars, const int *lits,
+                        size_t n_lits);
+
+/* the weight of a literal of the formula loaded last, as a decimal
+ * string to keep the precision of the number type */
+int dsharp_set_weight(dsharp_solver *s, int lit, const char *weight);
+
+/* compiles the formula loaded last, DSHARP_SUCCESS, DSHARP_TIMEOUT,
+ * DSHARP_ABORTED or DSHARP_ERROR; every compile needs a load before */
+int dsharp_compile(dsharp_solver *s);
+
+/* the model count of the last compile as a decimal integer, NULL if
+ * there is none */
+char *dsharp_count(dsharp_solver *s);
+
+/* the weighted count of the last compile as a string that restores the
+ * number exactly (exponent notation like 0.8e1 with GMP), the model count
+ * of dsharp_count() for a cnf without weights; NULL if there is none */
+char *dsharp_weighted_count(dsharp_solver *s);
+
+/* the d-DNNF of the last compile, every node after its children and the
+ * root last; 0 nodes if there is none (count, or no successful compile) */
+size_t dsharp_dag_size(dsharp_solver *s);
+int dsharp_dag_node(dsharp_solver *s, size_t i, dsharp_node *node);
+
+/* the d-DNNF in the nnf text format of -Fnnf, *len is set to its size */
+char *dsharp_nnf(dsharp_solver *s, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,774 @@
+#include "BatchEvaluator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+// GCC vectors of 16, 32 and 64 bytes, the width of SSE2, AVX2 and
+//  AVX-512. A row is split into as many vectors as it takes.
+
+typedef uint64_t BitVec2 __attribute__((vector_size(16)));
+typedef uint64_t BitVec4 __attribute__((vector_size(32)));
+typedef uint64_t BitVec8 __attribute__((vector_size(64)));
+
+typedef double ProbVec2 __attribute__((vector_size(16)));
+typedef double ProbVec4 __attribute__((vector_size(32)));
+typedef double ProbVec8 __attribute__((vector_size(64)));
+
+// the operations of the two kinds of lanes, the bits ignore the scales.
+//  They update the accumulator in place: a 32 or 64 byte vector passed or
+//  returned by value would change the ABI of the generic build.
+
+struct BitLanes
+{
+    typedef uint64_t T;
+    enum { ROW_BYTES = CBatchEvaluator::SAT_WORDS * sizeof(uint64_t) };
+
+    template <class V>
+    static inline void mul(V &acc, const V &b)
+    {
+        acc &= b;
+    }
+
+    template <class V>
+    static inline void scale(V &, double)
+    {
+    }
+
+    template <class V>
+    static inline void addScaled(V &acc, const V &b, double)
+    {
+        acc |= b;
+    }
+};
+
+struct ProbLanes
+{
+    typedef double T;
+    enum { ROW_BYTES = CBatchEvaluator::COUNT_LANES * sizeof(double) };
+
+    template <class V>
+    static inline void mul(V &acc, const V &b)
+    {
+        acc *= b;
+    }
+
+    template <class V>
+    static inline void scale(V &acc, double f)
+    {
+        acc *= f;
+    }
+
+    template <class V>
+    static inline void addScaled(V &acc, const V &b, double f)
+    {
+        acc += b * f;
+    }
+};
+
+// one pass over the inner nodes, an And node has one child or more, an
+//  Or node two or more
+template <class Lanes, class V>
+inline __attribute__((always_inline))
+void evalBatchRows(const CBatchEvaluator &eval, typename Lanes::T *values)
+{
+    enum { K = Lanes::ROW_BYTES / sizeof(V) };
+
+    const unsigned char *ops = eval.theOps.data();
+    const unsigned int *firstChild = eval.theFirstChild.data();
+    const unsigned int *childRows = eval.theChildRows.data();
+    const double *nodeScales = eval.theNodeScales.data();
+    const double *edgeScales = eval.theEdgeScales.data();
+    unsigned int nInner = eval.theOps.size();
+
+    const V *rows = (const V *) values;
+    V *out = (V *) values + (size_t) eval.nLitRows * K;
+
+    for (unsigned int i = 0; i < nInner; i++, out += K)
+    {
+        unsigned int c = firstChild[i];
+        unsigned int end = firstChild[i + 1];
+
+        V acc[K];
+        const V *in = rows + (size_t) childRows[c] * K;
+
+        if (ops[i] == DT_NodeType::kDTAnd)
+        {
+            for (int k = 0; k < K; k++)
+                acc[k] = in[k];
+            for (c++; c < end; c++)
+            {
+                in = rows + (size_t) childRows[c] * K;
+                for (int k = 0; k < K; k++)
+                    Lanes::mul(acc[k], in[k]);
+            }
+            for (int k = 0; k < K; k++)
+                Lanes::scale(acc[k], nodeScales[i]);
+        }
+        else
+        {
+            for (int k = 0; k < K; k++)
+            {
+                acc[k] = in[k];
+                Lanes::scale(acc[k], edgeScales[c]);
+            }
+            for (c++; c < end; c++)
+            {
+                in = rows + (size_t) childRows[c] * K;
+                for (int k = 0; k < K; k++)
+                    Lanes::addScaled(acc[k], in[k], edgeScales[c]);
+            }
+        }
+
+        for (int k = 0; k < K; k++)
+            out[k] = acc[k];
+    }
+}
+
+// the passes for every instruction set, build() picks one of them
+
+static void evalBitsScalar(const CBatchEvaluator &eval, uint64_t *rows)
+{
+    evalBatchRows<BitLanes, BitVec2>(eval, rows);
+}
+
+static void evalProbsScalar(const CBatchEvaluator &eval, double *rows)
+{
+    evalBatchRows<ProbLanes, ProbVec2>(eval, rows);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+static void evalBitsAVX2(const CBatchEvaluator &eval, uint64_t *rows)
+{
+    evalBatchRows<BitLanes, BitVec4>(eval, rows);
+}
+
+__attribute__((target("avx2,fma")))
+static void evalProbsAVX2(const CBatchEvaluator &eval, double *rows)
+{
+    evalBatchRows<ProbLanes, ProbVec4>(eval, rows);
+}
+
+__attribute__((target("avx512f")))
+static void evalBitsAVX512(const CBatchEvaluator &eval, uint64_t *rows)
+{
+    evalBatchRows<BitLanes, BitVec8>(eval, rows);
+}
+
+__attribute__((target("avx512f")))
+static void evalProbsAVX512(const CBatchEvaluator &eval, double *rows)
+{
+    evalBatchRows<ProbLanes, ProbVec8>(eval, rows);
+}
+#endif
+
+// a root row below this may have lost its precision
+static const double minPreciseRoot = ldexp(DBL_MIN, 64);
+
+// the first 64 byte boundary in v, a vector one row longer than needed
+template <class T>
+static T *alignRows(vector<T> &v)
+{
+    return (T *) (((uintptr_t) v.data() + 63) & ~(uintptr_t) 63);
+}
+
+// 2^e, 0 below the normal doubles
+static inline double pow2Double(long e)
+{
+    return (e < DBL_MIN_EXP) ? 0 : ldexp(1.0, (int) e);
+}
+
+// r * 2^e
+static void mulPow2(CRealNum &r, long e)
+{
+    if (e >= 0)
+    {
+        CRealNum p;
+        pow2(p, e);
+        r *= p;
+    }
+    else
+        to_div_2exp(r, r, -e);
+}
+
+// a number m * 2^e, m in [0.5, 1) or 0, for the rows without assumptions,
+//  which leave the range of a double on a large d-DNNF
+struct BasisNum
+{
+    double m;
+    long e;
+
+    BasisNum(double x = 0, long exp = 0)
+    {
+        int ex;
+        m = frexp(x, &ex);
+        e = (m == 0) ? 0 : exp + ex;
+    }
+
+    BasisNum operator*(const BasisNum &b) const
+    {
+        return BasisNum(m * b.m, e + b.e);
+    }
+
+    BasisNum operator+(const BasisNum &b) const
+    {
+        if (m == 0)
+            return b;
+        if (b.m == 0)
+            return *this;
+
+        long top = (e > b.e) ? e : b.e;
+        return BasisNum(m * pow2Double(e - top) + b.m * pow2Double(b.e - top), top);
+    }
+};
+
+CBatchEvaluator::CBatchEvaluator()
+    : theExact(NULL), nVars(0), nLitRows(2), iRootRow(0), theBitRows(NULL),
+      theProbRows(NULL), iStamp(0), evalBits(evalBitsScalar),
+      evalProbs(evalProbsScalar), theInstructionSet("scalar")
+{}
+
+void CBatchEvaluator::build(CDAGEvaluator &eval)
+{
+    theExact = &eval;
+    nVars = eval.nVars;
+    nLitRows = 2 * (nVars + 1);
+
+    theDefaultProbs.assign(nLitRows, 0.5);
+    theDefaultProbs[0] = 0;
+    theDefaultProbs[1] = 1;
+    layout();
+
+    theTouchedRows.clear();
+    theMarks.assign(nVars + 1, 0);
+    iStamp = 0;
+
+    evalBits = evalBitsScalar;
+    evalProbs = evalProbsScalar;
+    theInstructionSet = "scalar";
+
+#ifdef BATCH_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        evalBits = evalBitsAVX512;
+        evalProbs = evalProbsAVX512;
+        theInstructionSet = "avx512";
+    }
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        evalBits = evalBitsAVX2;
+        evalProbs = evalProbsAVX2;
+        theInstructionSet = "avx2";
+    }
+#endif
+}
+
+void CBatchEvaluator::layout()
+{
+    const CDAGEvaluator &eval = *theExact;
+
+    theOps.clear();
+    theFirstChild.assign(1, 0);
+    theChildRows.clear();
+    theNodeScales.clear();
+    theEdgeScales.clear();
+
+    // a literal row holds the probability itself, a literal of
+    //  probability 0 gets 1 if a query assumes it
+    theRowExps.assign(nLitRows, 0);
+    theRowBasis.resize(nLitRows);
+    for (unsigned int row = 0; row < nLitRows; row++)
+        theRowBasis[row] = (theDefaultProbs[row] == 0) ? 1 : fabs(theDefaultProbs[row]);
+    theRowBasis[0] = 0;
+
+    // the row of every node of eval
+    vector<unsigned int> rowOf(eval.theTypes.size());
+    vector<unsigned int> children;
+
+    for (unsigned int i = 0; i < eval.theTypes.size(); i++)
+    {
+        unsigned char type = eval.theTypes[i];
+        int lit = eval.theLits[i];
+
+        if (type == DT_NodeType::kDTLit)
+            rowOf[i] = 2 * abs(lit) + (lit < 0);
+        else if (type == DT_NodeType::kDTAnd || type == DT_NodeType::kDTOr)
+        {
+            bool isAnd = (type == DT_NodeType::kDTAnd);
+            bool isFalse = false;
+
+            // True in an And and False in an Or do not count, False
+            //  makes an And False
+            children.clear();
+            for (unsigned int c = eval.theFirstChild[i]; c < eval.theFirstChild[i + 1]; c++)
+            {
+                unsigned int row = rowOf[eval.theChildren[c]];
+                if (row == (unsigned int) isAnd)
+                    continue;
+                if (isAnd && row == 0)
+                    isFalse = true;
+                children.push_back(row);
+            }
+
+            if (isFalse)
+                rowOf[i] = 0;
+            else if (children.empty())
+                rowOf[i] = isAnd;
+            else if (children.size() == 1)
+                rowOf[i] = children[0];
+            else
+                rowOf[i] = isAnd ? addAnd(children) : addOrRow(children);
+        }
+        else
+            rowOf[i] = (type == DT_NodeType::kDTTop);
+    }
+
+    iRootRow = eval.empty() ? 0 : rowOf.back();
+
+    // the vector loads of a pass need rows on 64 byte boundaries
+    theBits.assign((size_t) (countRows() + 1) * SAT_WORDS, ~(uint64_t) 0);
+    theBitRows = alignRows(theBits);
+    for (unsigned int l = 0; l < SAT_WORDS; l++)
+        theBitRows[l] = 0;
+
+    theProbs.assign((size_t) (countRows() + 1) * COUNT_LANES, 0);
+    theProbRows = alignRows(theProbs);
+    for (unsigned int row = 0; row < nLitRows; row++)
+        for (unsigned int l = 0; l < COUNT_LANES; l++)
+            theProbRows[(size_t) row * COUNT_LANES + l] = theDefaultProbs[row];
+}
+
+unsigned int CBatchEvaluator::addAnd(const vector<unsigned int> &children)
+{
+    // chunks of children whose product without assumptions stays within
+    //  2^-512 .. 2^512, every chunk gets a row
+    vector<unsigned int> chunkRows, chunk;
+    BasisNum product(1);
+
+    for (unsigned int i = 0; i < children.size(); i++)
+    {
+        BasisNum next = product * BasisNum(theRowBasis[children[i]]);
+
+        if (!chunk.empty() && labs(next.e) > 512)
+        {
+            chunkRows.push_back(addAndRow(chunk));
+            chunk.clear();
+            next = BasisNum(theRowBasis[children[i]]);
+        }
+        chunk.push_back(children[i]);
+        product = next;
+    }
+
+    chunkRows.push_back(addAndRow(chunk));
+
+    // the rows of the chunks are about 1 each, an And of them takes
+    //  hundreds of chunks in one
+    if (chunkRows.size() == 1)
+        return chunkRows[0];
+    return addAnd(chunkRows);
+}
+
+unsigned int CBatchEvaluator::addAndRow(const vector<unsigned int> &children)
+{
+    BasisNum product(1);
+    long exps = 0;
+
+    for (unsigned int i = 0; i < children.size(); i++)
+    {
+        product = product * BasisNum(theRowBasis[children[i]]);
+        exps += theRowExps[children[i]];
+        theChildRows.push_back(children[i]);
+        theEdgeScales.push_back(1);
+    }
+
+    // the product of the child rows is the value times 2^-exps
+    theOps.push_back(DT_NodeType::kDTAnd);
+    theFirstChild.push_back(theChildRows.size());
+    theNodeScales.push_back(pow2Double(-product.e));
+
+    theRowExps.push_back(exps + product.e);
+    theRowBasis.push_back(product.m);
+    return countRows() - 1;
+}
+
+unsigned int CBatchEvaluator::addOrRow(const vector<unsigned int> &children)
+{
+    BasisNum sum;
+
+    for (unsigned int i = 0; i < children.size(); i++)
+        sum = sum + BasisNum(theRowBasis[children[i]], theRowExps[children[i]]);
+
+    // a child far below the others gets the scale 0, it only counts if
+    //  a query drops the others, and then the root is imprecise
+    for (unsigned int i = 0; i < children.size(); i++)
+    {
+        theChildRows.push_back(children[i]);
+        theEdgeScales.push_back(pow2Double(theRowExps[children[i]] - sum.e));
+    }
+
+    theOps.push_back(DT_NodeType::kDTOr);
+    theFirstChild.push_back(theChildRows.size());
+    theNodeScales.push_back(1);
+
+    theRowExps.push_back(sum.e);
+    theRowBasis.push_back(sum.m);
+    return countRows() - 1;
+}
+
+void CBatchEvaluator::useDefaultProbs(vector<double> &probs)
+{
+    if (probs == theDefaultProbs)
+        return;
+
+    theDefaultProbs.swap(probs);
+    layout();
+}
+
+CBatchEvaluator::QueryState CBatchEvaluator::markQuery(const vector<int> &query)
+{
+    theQueryLits.clear();
+
+    // a new stamp forgets the marks of the last query
+    if (++iStamp == 0x7fffffff)
+    {
+        theMarks.assign(nVars + 1, 0);
+        iStamp = 1;
+    }
+
+    QueryState state = QUERY_OK;
+
+    for (unsigned int i = 0; i < query.size(); i++)
+    {
+        int lit = query[i];
+        unsigned int var = abs(lit);
+
+        if (lit == 0 || var > nVars)
+            return QUERY_INVALID;
+
+        if (theMarks[var] == 2 * iStamp + (lit > 0))
+            state = QUERY_CONFLICT;
+        else if (theMarks[var] != 2 * iStamp + (lit < 0))
+        {
+            theMarks[var] = 2 * iStamp + (lit < 0);
+            theQueryLits.push_back(lit);
+        }
+    }
+
+    return state;
+}
+
+CBatchEvaluator::QueryState CBatchEvaluator::setBitLane(const vector<int> &query,
+        unsigned int l)
+{
+    QueryState state = markQuery(query);
+
+    for (unsigned int i = 0; i < theQueryLits.size(); i++)
+    {
+        int lit = theQueryLits[i];
+
+        // the negation of lit is false in lane l
+        unsigned int row = 2 * abs(lit) + (lit > 0);
+        theBitRows[(size_t) row * SAT_WORDS + l / 64] &= ~((uint64_t) 1 << (l % 64));
+        theTouchedRows.push_back(row);
+    }
+
+    return state;
+}
+
+CBatchEvaluator::QueryState CBatchEvaluator::setProbLane(const vector<int> &query,
+        unsigned int l)
+{
+    QueryState state = markQuery(query);
+
+    for (unsigned int i = 0; i < theQueryLits.size(); i++)
+    {
+        int lit = theQueryLits[i];
+        unsigned int row = 2 * abs(lit) + (lit < 0);
+
+        theProbRows[(size_t) row * COUNT_LANES + l] = 1;
+        theProbRows[(size_t) (row ^ 1) * COUNT_LANES + l] = 0;
+        theTouchedRows.push_back(row);
+    }
+
+    return state;
+}
+
+void CBatchEvaluator::resetBitRows()
+{
+    for (unsigned int i = 0; i < theTouchedRows.size(); i++)
+        for (unsigned int l = 0; l < SAT_WORDS; l++)
+            theBitRows[(size_t) theTouchedRows[i] * SAT_WORDS + l] = ~(uint64_t) 0;
+
+    theTouchedRows.clear();
+}
+
+void CBatchEvaluator::resetProbRows()
+{
+    for (unsigned int i = 0; i < theTouchedRows.size(); i++)
+    {
+        // both literals of the variable
+        unsigned int row = theTouchedRows[i] & ~1u;
+
+        for (unsigned int l = 0; l < COUNT_LANES; l++)
+        {
+            theProbRows[(size_t) row * COUNT_LANES + l] = theDefaultProbs[row];
+            theProbRows[(size_t) (row + 1) * COUNT_LANES + l] = theDefaultProbs[row + 1];
+        }
+    }
+
+    theTouchedRows.clear();
+}
+
+bool CBatchEvaluator::satisfiable(const vector<vector<int> > &queries,
+                                  vector<bool> &rSat)
+{
+    if (theExact == NULL)
+        return false;
+
+    rSat.assign(queries.size(), false);
+
+    for (unsigned int first = 0; first < queries.size(); first += SAT_LANES)
+    {
+        unsigned int nLanes = queries.size() - first;
+        if (nLanes > SAT_LANES)
+            nLanes = SAT_LANES;
+
+        uint64_t conflicts[SAT_WORDS];
+        memset(conflicts, 0, sizeof(conflicts));
+
+        for (unsigned int l = 0; l < nLanes; l++)
+        {
+            QueryState state = setBitLane(queries[first + l], l);
+
+            if (state == QUERY_INVALID)
+            {
+                resetBitRows();
+                return false;
+            }
+            if (state == QUERY_CONFLICT)
+                conflicts[l / 64] |= (uint64_t) 1 << (l % 64);
+        }
+
+        evalBits(*this, theBitRows);
+
+        const uint64_t *root = &theBitRows[(size_t) iRootRow * SAT_WORDS];
+        for (unsigned int l = 0; l < nLanes; l++)
+            rSat[first + l] = ((root[l / 64] & ~conflicts[l / 64]) >> (l % 64)) & 1;
+
+        resetBitRows();
+    }
+
+    return true;
+}
+
+bool CBatchEvaluator::countModels(const vector<vector<int> > &queries,
+                                  vector<CRealNum> &rCounts)
+{
+    if (theExact == NULL)
+        return false;
+
+    rCounts.assign(queries.size(), CRealNum(0));
+
+    vector<double> probs(nLitRows, 0.5);
+    probs[0] = 0;
+    probs[1] = 1;
+    useDefaultProbs(probs);
+
+    vector<unsigned int> imprecise;
+
+    for (unsigned int first = 0; first < queries.size(); first += COUNT_LANES)
+    {
+        unsigned int nLanes = queries.size() - first;
+        if (nLanes > COUNT_LANES)
+            nLanes = COUNT_LANES;
+
+        QueryState states[COUNT_LANES];
+        unsigned int nFree[COUNT_LANES];
+
+        for (unsigned int l = 0; l < nLanes; l++)
+        {
+            states[l] = setProbLane(queries[first + l], l);
+            nFree[l] = nVars - theQueryLits.size();
+
+            if (states[l] == QUERY_INVALID)
+            {
+                resetProbRows();
+                return false;
+            }
+        }
+
+        evalProbs(*this, theProbRows);
+
+        // the count is the root row times 2^(root exponent + #free)
+        const double *root = &theProbRows[(size_t) iRootRow * COUNT_LANES];
+        for (unsigned int l = 0; l < nLanes; l++)
+        {
+            if (states[l] == QUERY_CONFLICT)
+                continue;
+
+            if (root[l] < minPreciseRoot)
+                imprecise.push_back(first + l);
+            else
+            {
+                CRealNum &count = rCounts[first + l];
+                count = root[l];
+                mulPow2(count, theRowExps[iRootRow] + nFree[l]);
+            }
+        }
+
+        resetProbRows();
+    }
+
+    return recount(NULL, queries, imprecise, rCounts);
+}
+
+bool CBatchEvaluator::weightedCount(const vector<CRealNum> &litWeights,
+                                    const vector<vector<int> > &queries,
+                                    vector<CRealNum> &rCounts)
+{
+    if (theExact == NULL)
+        return false;
+
+    rCounts.assign(queries.size(), CRealNum(0));
+
+    // a query scales its root with the product of w(x) + w(-x) over the
+    //  free variables, which is the product over all variables with the
+    //  factor w(x) / (w(x) + w(-x)) of every assumed literal x
+    vector<CRealNum> litFactors(nLitRows);
+    vector<double> probs(nLitRows);
+    vector<bool> zeroSum(nVars + 1, false);
+    unsigned int nZeroSums = 0;
+    CRealNum allSums = 1;
+
+    probs[0] = 0;
+    probs[1] = 1;
+
+    for (unsigned int var = 1; var <= nVars; var++)
+    {
+        // a variable beyond the weights weighs 1 in both polarities
+        CRealNum wPos = 1, wNeg = 1;
+        if (LiteralIdT(var, true).toUInt() < litWeights.size())
+        {
+            wPos = litWeights[LiteralIdT(var, true).toUInt()];
+            wNeg = litWeights[LiteralIdT(var, false).toUInt()];
+        }
+
+        CRealNum sum = wPos + wNeg;
+
+        if (sum == 0)
+        {
+            zeroSum[var] = true;
+            nZeroSums++;
+            litFactors[2 * var] = wPos;
+            litFactors[2 * var + 1] = wNeg;
+            probs[2 * var] = probs[2 * var + 1] = 0;
+        }
+        else
+        {
+            allSums *= sum;
+            litFactors[2 * var] = wPos / sum;
+            litFactors[2 * var + 1] = wNeg / sum;
+            probs[2 * var] = to_doubleT(litFactors[2 * var]);
+            probs[2 * var + 1] = to_doubleT(litFactors[2 * var + 1]);
+        }
+    }
+
+    useDefaultProbs(probs);
+
+    vector<unsigned int> imprecise;
+
+    for (unsigned int first = 0; first < queries.size(); first += COUNT_LANES)
+    {
+        unsigned int nLanes = queries.size() - first;
+        if (nLanes > COUNT_LANES)
+            nLanes = COUNT_LANES;
+
+        QueryState states[COUNT_LANES];
+
+        for (unsigned int l = 0; l < nLanes; l++)
+        {
+            states[l] = setProbLane(queries[first + l], l);
+
+            unsigned int nAssumedZeroSums = 0;
+            CRealNum &scale = rCounts[first + l];
+            scale = allSums;
+
+            for (unsigned int i = 0; i < theQueryLits.size(); i++)
+            {
+                int lit = theQueryLits[i];
+                scale *= litFactors[2 * abs(lit) + (lit < 0)];
+                nAssumedZeroSums += zeroSum[abs(lit)];
+            }
+
+            // a free variable with w(x) + w(-x) = 0 can not be counted
+            if (states[l] == QUERY_INVALID || nAssumedZeroSums < nZeroSums)
+            {
+                resetProbRows();
+                return false;
+            }
+        }
+
+        evalProbs(*this, theProbRows);
+
+        const double *root = &theProbRows[(size_t) iRootRow * COUNT_LANES];
+        for (unsigned int l = 0; l < nLanes; l++)
+        {
+            CRealNum &count = rCounts[first + l];
+
+            if (states[l] == QUERY_CONFLICT)
+                count = 0;
+            else if (fabs(root[l]) < minPreciseRoot)
+            {
+                count = 0;
+                imprecise.push_back(first + l);
+            }
+            else
+            {
+                count *= CRealNum(root[l]);
+                mulPow2(count, theRowExps[iRootRow]);
+            }
+        }
+
+        resetProbRows();
+    }
+
+    return recount(&litWeights, queries, imprecise, rCounts);
+}
+
+bool CBatchEvaluator::recount(const vector<CRealNum> *litWeights,
+                              const vector<vector<int> > &queries,
+                              const vector<unsigned int> &imprecise,
+                              vector<CRealNum> &rCounts)
+{
+    if (imprecise.empty())
+        return true;
+
+    // only a satisfiable query can have a count other than 0
+    vector<vector<int> > recounted;
+    vector<bool> sat;
+
+    for (unsigned int i = 0; i < imprecise.size(); i++)
+        recounted.push_back(queries[imprecise[i]]);
+
+    if (!satisfiable(recounted, sat))
+        return false;
+
+    for (unsigned int i = 0; i < imprecise.size(); i++)
+    {
+        if (!sat[i])
+            continue;
+
+        bool ok = (litWeights == NULL)
+                  ? theExact->countModels(recounted[i], rCounts[imprecise[i]])
+                  : theExact->weightedCount(*litWeights, recounted[i], rCounts[imprecise[i]]);
+        if (!ok)
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,177 @@
+#ifndef BATCHEVALUATOR_H
+#define BATCHEVALUATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <RealNumberTypes.h>
+
+#include "DAGEvaluator.h"
+
+using std::vector;
+
+/** Answers many queries on the d-DNNF of a CDAGEvaluator, a batch per pass
+ *
+ *  A query is a list of assumed literals as for CDAGEvaluator. Every
+ *  value of the pass is a row with one lane per query of the batch, and
+ *  the rows are in one array in evaluation order: row 0 is False, row 1
+ *  True, row 2 * var + (lit < 0) the literal lit and the And and Or nodes
+ *  follow. Literal and constant nodes get no row of their own and a node
+ *  with a single child shares the row of the child, so the pass only
+ *  computes the And and Or nodes with at least two children. Their types,
+ *  child offsets, child rows and scales are separate arrays.
+ *
+ *  satisfiable() keeps one bit per query, a pass answers SAT_LANES
+ *  queries with And as & and Or as |. countModels() and weightedCount()
+ *  evaluate the probabilities of CDAGEvaluator in double lanes,
+ *  COUNT_LANES queries per pass. The probability of a node quickly drops
+ *  below the smallest double, so the row of a node holds its value times
+ *  2^-e, where 2^e is about the value of the node without assumptions.
+ *  An And node multiplies the product of its children with a constant,
+ *  an Or node adds its children times a constant each, and a long And is
+ *  split up so that no partial product leaves the range of a double. The
+ *  exponents only depend on the literal probabilities, a weightedCount()
+ *  with other weights than the last pass lays out the rows again.
+ *
+ *  A query whose root row ends up below 2^64 times the smallest double
+ *  may have lost its precision, it is counted again with the
+ *  CDAGEvaluator if it is satisfiable.
+ *
+ *  The loops over the lanes of a row have a fixed length so the compiler
+ *  turns them into vector instructions. On x86 they are compiled for
+ *  AVX-512 and AVX2 as well and build() picks what the CPU supports.
+ */
+class CBatchEvaluator
+{
+public:
+
+    enum
+    {
+        SAT_WORDS = 8,
+        SAT_LANES = 64 * SAT_WORDS,
+        COUNT_LANES = 16
+    };
+
+private:
+
+    // the d-DNNF to lay out, it answers the imprecise queries as well
+    CDAGEvaluator *theExact;
+
+    unsigned int nVars;
+    unsigned int nLitRows;              // 2 * (nVars + 1)
+
+    // the inner nodes, node i has the row nLitRows + i
+    vector<unsigned char> theOps;       // kDTAnd or kDTOr
+    vector<unsigned int> theFirstChild; // nInner + 1 offsets into theChildRows
+    vector<unsigned int> theChildRows;
+    vector<double> theNodeScales;       // of the product of an And node
+    vector<double> theEdgeScales;       // of every child of an Or node
+
+    // a row holds its value times 2^-theRowExps[row], theRowBasis is the
+    //  row without assumptions (up to the sign of negative weights)
+    vector<long> theRowExps;
+    vector<double> theRowBasis;
+
+    unsigned int iRootRow;
+
+    // SAT_WORDS words and COUNT_LANES doubles per row, the rows begin
+    //  at the first 64 byte boundary of the vectors
+    vector<uint64_t> theBits;
+    vector<double> theProbs;
+    uint64_t *theBitRows;
+    double *theProbRows;
+
+    // the probability of a literal row while no query assumes it, the
+    //  rows are laid out for these
+    vector<double> theDefaultProbs;
+
+    // the literal rows a batch changed
+    vector<unsigned int> theTouchedRows;
+
+    // the variables the query being set up assumes: 2 * stamp + (lit < 0)
+    vector<unsigned int> theMarks;
+    unsigned int iStamp;
+
+    // the literals of that query, each variable once
+    vector<int> theQueryLits;
+
+    typedef void (*BitKernel)(const CBatchEvaluator &, uint64_t *);
+    typedef void (*ProbKernel)(const CBatchEvaluator &, double *);
+
+    BitKernel evalBits;
+    ProbKernel evalProbs;
+    const char *theInstructionSet;
+
+    template <class Lanes, class V>
+    friend void evalBatchRows(const CBatchEvaluator &, typename Lanes::T *);
+
+    enum QueryState
+    {
+        QUERY_OK,
+        QUERY_CONFLICT,
+        QUERY_INVALID
+    };
+
+    // the rows of the d-DNNF of theExact for theDefaultProbs
+    void layout();
+
+    // new inner rows, each returns the row of the node
+    unsigned int addAnd(const vector<unsigned int> &children);
+    unsigned int addAndRow(const vector<unsigned int> &children);
+    unsigned int addOrRow(const vector<unsigned int> &children);
+
+    // lays out the rows again if probs differ from theDefaultProbs
+    void useDefaultProbs(vector<double> &probs);
+
+    // collects the literals of query in theQueryLits
+    QueryState markQuery(const vector<int> &query);
+
+    // the literals of query hold in lane l of the bit or probability rows
+    QueryState setBitLane(const vector<int> &query, unsigned int l);
+    QueryState setProbLane(const vector<int> &query, unsigned int l);
+
+    // the touched literal rows back to their defaults
+    void resetBitRows();
+    void resetProbRows();
+
+    // counts the queries listed in imprecise with theExact, the
+    //  weighted count if litWeights is given
+    bool recount(const vector<CRealNum> *litWeights,
+                 const vector<vector<int> > &queries,
+                 const vector<unsigned int> &imprecise,
+                 vector<CRealNum> &rCounts);
+
+public:
+
+    CBatchEvaluator();
+
+    /// lays out the d-DNNF of eval, which has to stay alive as long as
+    /// the batch evaluator is used
+    void build(CDAGEvaluator &eval);
+
+    unsigned int countRows() const
+    {
+        return nLitRows + theOps.size();
+    }
+
+    /// "avx512", "avx2" or "scalar"
+    const char *instructionSet() const
+    {
+        return theInstructionSet;
+    }
+
+    /// rSat[q] is true if the d-DNNF has a model in which the literals
+    /// of queries[q] hold. Returns false if a literal is not over one of
+    /// the variables or before build().
+    bool satisfiable(const vector<vector<int> > &queries, vector<bool> &rSat);
+
+    /// CDAGEvaluator::countModels() for every query
+    bool countModels(const vector<vector<int> > &queries, vector<CRealNum> &rCounts);
+
+    /// CDAGEvaluator::weightedCount() for every query
+    bool weightedCount(const vector<CRealNum> &litWeights,
+                       const vector<vector<int> > &queries,
+                       vector<CRealNum> &rCounts);
+};
+
+#endif
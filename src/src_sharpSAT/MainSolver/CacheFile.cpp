@@ -0,0 +1,136 @@
+#include "CacheFile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+template <class _T>
+static bool writeSection(FILE *out, const vector<_T> &v)
+{
+    return v.empty() || fwrite(&v[0], sizeof(_T), v.size(), out) == v.size();
+}
+
+bool writeCacheFile(const char *lpstrFileName, uint64_t fingerprint,
+                    const CacheFileContents &contents)
+{
+    CacheFileHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CACHE_FILE_MAGIC, 8);
+    hdr.version = CACHE_FILE_VERSION;
+    hdr.byteOrderMark = CACHE_FILE_BYTEORDER;
+    hdr.fingerprint = fingerprint;
+    hdr.nNodes = contents.nodes.size();
+    hdr.nEntries = contents.entries.size();
+    hdr.nChildren = contents.children.size();
+    hdr.nIds = contents.ids.size();
+    hdr.nValBytes = contents.values.size();
+
+    // the file is written under a temporary name and renamed at the end,
+    // so a concurrent or later run never maps a half written cache
+    string tmpName = string(lpstrFileName) + ".tmp";
+
+    FILE *out = fopen(tmpName.c_str(), "wb");
+    if (out == NULL)
+        return false;
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    ok = ok && writeSection(out, contents.nodes);
+    ok = ok && writeSection(out, contents.entries);
+    ok = ok && writeSection(out, contents.children);
+    ok = ok && writeSection(out, contents.ids);
+    if (ok && !contents.values.empty())
+        ok = fwrite(contents.values.data(), 1, contents.values.size(), out) == contents.values.size();
+
+    ok = (fclose(out) == 0) && ok;
+    if (ok)
+        ok = rename(tmpName.c_str(), lpstrFileName) == 0;
+    if (!ok)
+        remove(tmpName.c_str());
+    return ok;
+}
+
+bool CCacheFileReader::open(const char *lpstrFileName, uint64_t fingerprint, string &err)
+{
+    if (!theFile.open(lpstrFileName))
+    {
+        err = "can not be read";
+        return false;
+    }
+
+    if (theFile.size() < sizeof(CacheFileHeader)
+            || memcmp(theFile.begin(), CACHE_FILE_MAGIC, 8) != 0)
+    {
+        err = "is not a cache file";
+        return false;
+    }
+    memcpy(&theHeader, theFile.begin(), sizeof(theHeader));
+
+    if (theHeader.byteOrderMark != CACHE_FILE_BYTEORDER)
+    {
+        err = "was written on a machine with a different byte order";
+        return false;
+    }
+    if (theHeader.version != CACHE_FILE_VERSION)
+    {
+        err = "has an unsupported version";
+        return false;
+    }
+    if (theHeader.fingerprint != fingerprint)
+    {
+        err = "was written for a different formula";
+        return false;
+    }
+
+    uint64_t size = sizeof(theHeader)
+                    + theHeader.nNodes * sizeof(CacheFileNode)
+                    + theHeader.nEntries * sizeof(CacheFileEntry)
+                    + (theHeader.nChildren + theHeader.nIds) * sizeof(uint32_t)
+                    + theHeader.nValBytes;
+    if (size != theFile.size())
+    {
+        err = "is truncated or has trailing data";
+        return false;
+    }
+
+    // the 8 byte aligned sections come first
+    const char *pos = theFile.begin() + sizeof(theHeader);
+    theNodes = (const CacheFileNode *) pos;
+    pos += theHeader.nNodes * sizeof(CacheFileNode);
+    theEntries = (const CacheFileEntry *) pos;
+    pos += theHeader.nEntries * sizeof(CacheFileEntry);
+    theChildren = (const uint32_t *) pos;
+    pos += theHeader.nChildren * sizeof(uint32_t);
+    theIds = (const uint32_t *) pos;
+    pos += theHeader.nIds * sizeof(uint32_t);
+    theValues = pos;
+
+    // nodes may only refer to nodes stored before them, which also rules out cycles
+    for (uint64_t i = 0; i < theHeader.nNodes; i++)
+    {
+        const CacheFileNode &rNode = theNodes[i];
+        if ((uint64_t) rNode.childOfs + rNode.nChildren > theHeader.nChildren)
+        {
+            err = "has an inconsistent node table";
+            return false;
+        }
+        for (uint32_t c = 0; c < rNode.nChildren; c++)
+            if (theChildren[rNode.childOfs + c] >= i)
+            {
+                err = "has an inconsistent node table";
+                return false;
+            }
+    }
+
+    for (uint64_t i = 0; i < theHeader.nEntries; i++)
+    {
+        const CacheFileEntry &rEntry = theEntries[i];
+        if (rEntry.idOfs + rEntry.nVars + rEntry.nCls > theHeader.nIds
+                || rEntry.valOfs + rEntry.valLen > theHeader.nValBytes
+                || rEntry.dtNode >= theHeader.nNodes)
+        {
+            err = "has an inconsistent entry table";
+            return false;
+        }
+    }
+
+    return true;
+}
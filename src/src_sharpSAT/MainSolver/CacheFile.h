@@ -0,0 +1,155 @@
+#ifndef CACHEFILE_H
+#define CACHEFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include <MappedFile.h>
+
+using std::vector;
+using std::string;
+
+/** Persistent component cache file
+ *
+ *  header      CacheFileHeader
+ *  nodes       nNodes x CacheFileNode, the d-DNNF fragments of all entries,
+ *              each node is stored after all of its children
+ *  entries     nEntries x CacheFileEntry
+ *  children    nChildren x uint32, node indices, the children of a node
+ *              form one run
+ *  ids         nIds x uint32, for each entry the sorted variables and
+ *              then the sorted clauses of its component
+ *  values      nValBytes chars, the model counts as decimal strings
+ *
+ *  Variables are numbered as in the cnf file. A clause is numbered by its
+ *  position among the input clauses with more than one literal. Changing
+ *  the unit clauses therefore keeps the numbering of all other clauses.
+ *  The fingerprint hashes exactly these clauses, and a file is only used
+ *  for a formula with the same fingerprint.
+ *
+ *  Preprocessing can shorten long clauses to binary ones, so the binary
+ *  clauses between the variables of a component may differ between runs.
+ *  binHash records them, and an entry is only loaded if they match.
+ *
+ *  All numbers are stored in the byte order of the writing machine.
+ */
+
+#define CACHE_FILE_MAGIC "dsharpPC"
+#define CACHE_FILE_VERSION 1
+#define CACHE_FILE_BYTEORDER 0x01020304
+
+struct CacheFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+
+    uint64_t fingerprint;
+
+    uint64_t nNodes;
+    uint64_t nEntries;
+    uint64_t nChildren;
+    uint64_t nIds;
+    uint64_t nValBytes;
+};
+
+struct CacheFileNode
+{
+    int32_t type;     // a DT_NodeType
+    int32_t val;      // the literal of kDTLit, the decision variable of kDTOr
+    uint32_t childOfs;
+    uint32_t nChildren;
+};
+
+struct CacheFileEntry
+{
+    uint64_t hashKey; // hash of the variables and clauses as stored
+    uint64_t binHash;
+    uint64_t idOfs;
+    uint64_t valOfs;
+    uint32_t nVars;
+    uint32_t nCls;
+    uint32_t dtNode;
+    uint32_t valLen;
+};
+
+/// the sections of a cache file, filled by the solver before writing
+struct CacheFileContents
+{
+    vector<CacheFileNode> nodes;
+    vector<CacheFileEntry> entries;
+    vector<uint32_t> children;
+    vector<uint32_t> ids;
+    string values;
+};
+
+bool writeCacheFile(const char *lpstrFileName, uint64_t fingerprint,
+                    const CacheFileContents &contents);
+
+/// read-only view of a memory-mapped cache file
+class CCacheFileReader
+{
+    CMappedFile theFile;
+    CacheFileHeader theHeader;
+
+    const CacheFileNode *theNodes;
+    const CacheFileEntry *theEntries;
+    const uint32_t *theChildren;
+    const uint32_t *theIds;
+    const char *theValues;
+
+public:
+
+    /// maps the file and checks that it belongs to the formula with the
+    /// given fingerprint, returns false and sets err otherwise
+    bool open(const char *lpstrFileName, uint64_t fingerprint, string &err);
+
+    void close()
+    {
+        theFile.close();
+    }
+
+    uint64_t countNodes() const
+    {
+        return theHeader.nNodes;
+    }
+
+    uint64_t countEntries() const
+    {
+        return theHeader.nEntries;
+    }
+
+    const CacheFileNode &node(uint64_t i) const
+    {
+        return theNodes[i];
+    }
+
+    const uint32_t *children(const CacheFileNode &rNode) const
+    {
+        return theChildren + rNode.childOfs;
+    }
+
+    const CacheFileEntry &entry(uint64_t i) const
+    {
+        return theEntries[i];
+    }
+
+    const uint32_t *vars(const CacheFileEntry &rEntry) const
+    {
+        return theIds + rEntry.idOfs;
+    }
+
+    const uint32_t *clauses(const CacheFileEntry &rEntry) const
+    {
+        return theIds + rEntry.idOfs + rEntry.nVars;
+    }
+
+    string value(const CacheFileEntry &rEntry) const
+    {
+        return string(theValues + rEntry.valOfs, rEntry.valLen);
+    }
+};
+
+#endif
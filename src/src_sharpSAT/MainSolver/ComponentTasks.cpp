@@ -0,0 +1,192 @@
+#include "ComponentTasks.h"
+
+#include <chrono>
+
+#include "MainSolver.h"
+
+CComponentTask::~CComponentTask()
+{
+    delete theSolver;
+
+    if (theParent != NULL)
+        theParent->release();
+}
+
+void CComponentTask::run()
+{
+    exitState = theSolver->countTask(count, weightedCount, dtNode);
+    theState = DONE;
+}
+
+void abandonTask(CComponentTask *task)
+{
+    task->bAbandoned = true;
+    task->takeBack();
+    task->release();
+}
+
+
+thread_local unsigned int CComponentTaskPool::iMyQueue = 0;
+thread_local unsigned int CComponentTaskPool::iHelpDepth = 0;
+
+CComponentTaskPool::CComponentTaskPool(unsigned int nThreads)
+    : theQueues(nThreads), bStop(false), nIdle(nThreads - 1), nQueued(0), nOffered(0),
+      nTakenBack(0), nStolen(0), theWorkerConf(theConf())
+{
+    theWorkerConf.quietMode = true;
+
+    for (unsigned int t = 1; t < nThreads; t++)
+        theWorkers.push_back(std::thread(&CComponentTaskPool::workerLoop, this, t));
+}
+
+CComponentTaskPool::~CComponentTaskPool()
+{
+    CRunAnalyzer dropped;
+    join(dropped);
+}
+
+void CComponentTaskPool::workerLoop(unsigned int queue)
+{
+    iMyQueue = queue;
+
+    CSolverContext context(theWorkerConf);
+    CSolverContext::CBinding binding(context);
+
+    while (true)
+    {
+        CComponentTask *task = take();
+        if (task != NULL)
+        {
+            nIdle--;
+            runTaken(task);
+            nIdle++;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(theLock);
+        if (bStop)
+            break;
+
+        theWorkSignal.wait(lock, [this] { return bStop || nQueued.load() > 0; });
+    }
+
+    std::lock_guard<std::mutex> guard(theLock);
+    theWorkerStats.addSearchData(context.runAn);
+}
+
+CComponentTask *CComponentTaskPool::take()
+{
+    unsigned int n = theQueues.size();
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        CWorkerQueue &rQueue = theQueues[(iMyQueue + i) % n];
+        std::lock_guard<std::mutex> guard(rQueue.theLock);
+
+        if (rQueue.theTasks.empty())
+            continue;
+
+        CComponentTask *task;
+        if (i == 0)
+        {
+            task = rQueue.theTasks.back();
+            rQueue.theTasks.pop_back();
+        }
+        else
+        {
+            task = rQueue.theTasks.front();
+            rQueue.theTasks.pop_front();
+        }
+        nQueued--;
+
+        // a task the owner took back does not count as stolen
+        if (i != 0 && task->state() == CComponentTask::PENDING)
+            nStolen++;
+        return task;
+    }
+
+    return NULL;
+}
+
+void CComponentTaskPool::runTaken(CComponentTask *task)
+{
+    if (task->start())
+    {
+        task->run();
+
+        // the lock orders the state of the task before the wake up
+        {
+            std::lock_guard<std::mutex> guard(theLock);
+        }
+        theDoneSignal.notify_all();
+    }
+    task->release();
+}
+
+void CComponentTaskPool::offer(CComponentTask *task)
+{
+    {
+        CWorkerQueue &rQueue = theQueues[iMyQueue];
+        std::lock_guard<std::mutex> guard(rQueue.theLock);
+        rQueue.theTasks.push_back(task);
+    }
+    nQueued++;
+    nOffered++;
+
+    {
+        std::lock_guard<std::mutex> guard(theLock);
+    }
+    theWorkSignal.notify_one();
+}
+
+bool CComponentTaskPool::wait(CComponentTask *task, CComponentTask *myTask)
+{
+    while (task->state() != CComponentTask::DONE)
+    {
+        if (myTask != NULL && myTask->aborted())
+            return false;
+
+        if (iHelpDepth < MAX_HELP_DEPTH)
+        {
+            CComponentTask *other = take();
+            if (other != NULL)
+            {
+                // a helping thread prints as little as a worker
+                bool quiet = theConf().quietMode;
+                theConf().quietMode = true;
+                iHelpDepth++;
+                runTaken(other);
+                iHelpDepth--;
+                theConf().quietMode = quiet;
+                continue;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(theLock);
+        if (task->state() != CComponentTask::DONE)
+            theDoneSignal.wait_for(lock, std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
+void CComponentTaskPool::join(CRunAnalyzer &rStats)
+{
+    {
+        std::lock_guard<std::mutex> guard(theLock);
+        bStop = true;
+    }
+    theWorkSignal.notify_all();
+
+    for (unsigned int t = 0; t < theWorkers.size(); t++)
+        theWorkers[t].join();
+    theWorkers.clear();
+
+    // only cancelled tasks are left, their components are gone
+    CComponentTask *task;
+    while ((task = take()) != NULL)
+        task->release();
+
+    rStats.addSearchData(theWorkerStats);
+    theWorkerStats = CRunAnalyzer();
+}
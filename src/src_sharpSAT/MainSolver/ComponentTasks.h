@@ -0,0 +1,230 @@
+#ifndef COMPONENTTASKS_H
+#define COMPONENTTASKS_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+
+#include <RealNumberTypes.h>
+#include <Interface/AnalyzerData.h>
+
+#include "../Basics.h"
+#include "../SolverContext.h"
+#include "DecisionTree.h"
+
+using std::vector;
+
+class CMainSolver;
+
+/** A component counted by a solver of its own, possibly on another thread
+ *
+ *  The solver that decomposes a formula into components may offer the
+ *  large ones to the pool. The task holds a copy of the solver state with
+ *  the component as the formula of decision level 0. It shares the
+ *  literal nodes of the d-DNNF with its owner and reads the caches of
+ *  the solvers above it. Whichever thread reaches the task first counts
+ *  it: a worker that takes it from the queue, or the owner, which takes
+ *  it back and counts it in place.
+ *
+ *  A task is referenced by its component, by the queue and by the tasks
+ *  its solver offered, it is deleted with the last reference. A
+ *  component that goes away before the task is joined abandons it, a
+ *  running task then stops at its next decision.
+ */
+class CComponentTask
+{
+public:
+
+    enum TaskState
+    {
+        PENDING,
+        RUNNING,
+        DONE,
+        CANCELLED
+    };
+
+private:
+
+    std::atomic<int> theState;
+    std::atomic<int> iRefs;
+    std::atomic<bool> bAbandoned;
+
+public:
+
+    // counts the component, the d-DNNF of the result lives in its arena
+    CMainSolver *theSolver;
+
+    // the task of the solver that offered this one, NULL for the first
+    // solver. It is kept alive as long as theSolver reads its cache.
+    CComponentTask *theParent;
+
+    // the result, valid once the task is DONE
+    SOLVER_StateT exitState;
+    CRealNum count;
+    CRealNum weightedCount;
+    DTNode *dtNode;
+
+    CComponentTask(CMainSolver *solver, CComponentTask *parent)
+        : theState(PENDING), iRefs(2), bAbandoned(false), theSolver(solver),
+          theParent(parent), exitState(ABORTED), dtNode(NULL)
+    {
+        if (theParent != NULL)
+            theParent->iRefs++;
+    }
+
+    ~CComponentTask();
+
+    int state() const
+    {
+        return theState.load();
+    }
+
+    /// the task is going to be run, false if it has been cancelled
+    bool start()
+    {
+        int expected = PENDING;
+        return theState.compare_exchange_strong(expected, RUNNING);
+    }
+
+    /// takes the task back before anyone started it
+    bool takeBack()
+    {
+        int expected = PENDING;
+        return theState.compare_exchange_strong(expected, CANCELLED);
+    }
+
+    bool aborted() const
+    {
+        return bAbandoned.load();
+    }
+
+    /// counts the component, the task has to be started
+    void run();
+
+    /// drops a reference, the last one deletes the task
+    void release()
+    {
+        if (--iRefs == 0)
+            delete this;
+    }
+
+    friend void abandonTask(CComponentTask *task);
+};
+
+/// called by the component of the task if the result is not needed anymore
+void abandonTask(CComponentTask *task);
+
+
+/** The threads counting offered components
+ *
+ *  Every thread has a queue of the tasks it offered. A thread takes the
+ *  last task of its own queue and otherwise steals the oldest one of
+ *  another queue, the oldest tasks are the ones closest to the root of
+ *  the search and tend to be the largest. Queue 0 belongs to the thread
+ *  that created the pool.
+ *
+ *  A thread waiting for a task helps with the other tasks in the
+ *  meantime, up to a bounded depth of nested tasks.
+ */
+class CComponentTaskPool
+{
+    struct CWorkerQueue
+    {
+        std::mutex theLock;
+        std::deque<CComponentTask *> theTasks;
+    };
+
+    static const unsigned int MAX_HELP_DEPTH = 8;
+
+    vector<CWorkerQueue> theQueues;
+    vector<std::thread> theWorkers;
+
+    // guards bStop and theWorkerStats, the condition variables wait on it
+    std::mutex theLock;
+    std::condition_variable theWorkSignal;
+    std::condition_variable theDoneSignal;
+    bool bStop;
+
+    // workers not running a task, and the tasks in the queues
+    std::atomic<int> nIdle;
+    std::atomic<int> nQueued;
+
+    /* statistics */
+    std::atomic<unsigned int> nOffered;
+    std::atomic<unsigned int> nTakenBack;
+    std::atomic<unsigned int> nStolen;
+
+    // the search statistics of the worker threads
+    CRunAnalyzer theWorkerStats;
+
+    // the options of the thread that created the pool, the workers
+    // count in contexts of their own with these options
+    CSolverConf theWorkerConf;
+
+    static thread_local unsigned int iMyQueue;
+    static thread_local unsigned int iHelpDepth;
+
+    void workerLoop(unsigned int queue);
+
+    // the next task for the calling thread, NULL if all queues are empty
+    CComponentTask *take();
+
+    // runs a task taken from a queue and drops the reference of the queue
+    void runTaken(CComponentTask *task);
+
+    CComponentTaskPool(const CComponentTaskPool &);
+    CComponentTaskPool &operator=(const CComponentTaskPool &);
+
+public:
+
+    /// the most threads of the search -threads accepts
+    enum { MAX_THREADS = 256 };
+
+    /// starts nThreads - 1 workers, the calling thread makes nThreads.
+    /// The workers take the options of the calling thread.
+    CComponentTaskPool(unsigned int nThreads);
+
+    ~CComponentTaskPool();
+
+    /// workers without a task that no queued task is waiting for
+    int availableWorkers() const
+    {
+        return nIdle.load() - nQueued.load();
+    }
+
+    void offer(CComponentTask *task);
+
+    /// the owner of task took it back to count it itself
+    void addTakenBack()
+    {
+        nTakenBack++;
+    }
+
+    /// waits until task is done, false if myTask, the task of the waiting
+    /// solver, has been abandoned in the meantime
+    bool wait(CComponentTask *task, CComponentTask *myTask);
+
+    /// stops the workers, drops the tasks left in the queues and adds the
+    /// statistics of the workers to rStats
+    void join(CRunAnalyzer &rStats);
+
+    unsigned int countOffered() const
+    {
+        return nOffered.load();
+    }
+
+    unsigned int countTakenBack() const
+    {
+        return nTakenBack.load();
+    }
+
+    unsigned int countStolen() const
+    {
+        return nStolen.load();
+    }
+};
+
+#endif
@@ -0,0 +1,431 @@
+#include "CubeConquer.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <map>
+#include <fstream>
+#include <iostream>
+
+#include <OutputFile.h>
+#include <SomeTime.h>
+
+#include "MainSolver.h"
+
+using std::map;
+using std::ifstream;
+using std::ofstream;
+
+CCubeConquer::CCubeConquer(unsigned int workers)
+    : nWorkers(workers), bWeighted(false), nVars(0), theExitState(ABORTED),
+      theCount(0), theWeightedCount(0)
+{
+    if (nWorkers == 0)
+    {
+        long nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nWorkers = (nCpus > 0) ? (unsigned int) nCpus : 1;
+    }
+}
+
+CCubeConquer::~CCubeConquer()
+{
+    if (theWorkDir.empty())
+        return;
+
+    for (unsigned int c = 0; c < theResults.size(); c++)
+    {
+        unlink(cubeFile(c, "nnf").c_str());
+        unlink(cubeFile(c, "res").c_str());
+    }
+    unlink(workFile("cubes.nnf").c_str());
+    rmdir(theWorkDir.c_str());
+}
+
+string CCubeConquer::cubeFile(unsigned int c, const char *ext) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "cube%u.%s", c, ext);
+    return workFile(name);
+}
+
+void CCubeConquer::cubeLits(unsigned int c, vector<int> &lits) const
+{
+    lits.clear();
+    for (unsigned int i = 0; i < theVars.size(); i++)
+        lits.push_back((c >> i) & 1 ? theVars[i] : -theVars[i]);
+}
+
+void CCubeConquer::runWorker(const CMainSolver &parent, const char *cnfFile,
+                             unsigned int c, long secsLeft)
+{
+    // the solver writes parts of its output to stdout in any case
+    int devNull = open("/dev/null", O_WRONLY);
+    if (devNull >= 0)
+    {
+        dup2(devNull, STDOUT_FILENO);
+        close(devNull);
+    }
+    theConf().quietMode = true;
+
+    // the workers running at the same time share the cache memory
+    theConf().maxCacheSize /= std::min((size_t) nWorkers, theResults.size());
+
+    vector<int> lits;
+    cubeLits(c, lits);
+
+    CMainSolver *solver = new CMainSolver();
+    solver->priorityVars = parent.priorityVars;
+    solver->setCube(lits);
+    solver->setTimeBound(secsLeft);
+
+    theRunAn() = CRunAnalyzer();
+    if (!solver->solve(cnfFile))
+        _exit(3);
+
+    const AnalyzerData &rAda = theRunAn().getData();
+    bool ok = true;
+
+    if (rAda.theExitState == SUCCESS && !theConf().countOnly)
+        ok = solver->writeNNF(cubeFile(c, "nnf").c_str(),
+                              rAda.getNumSatAssignments() == 0);
+
+    ofstream out(cubeFile(c, "res").c_str());
+    out << (int) rAda.theExitState << " " << rAda.elapsedTime << " "
+        << to_stringT(rAda.getNumSatAssignments()) << " "
+        << to_stringT(rAda.rnWeightedCount) << "\n";
+    out.close();
+
+    // the coordinator cleans up, the exit skips the destructors
+    _exit(ok && out ? 0 : 3);
+}
+
+bool CCubeConquer::readResult(unsigned int c)
+{
+    CCubeResult &rRes = theResults[c];
+    ifstream in(cubeFile(c, "res").c_str());
+    int state;
+    string count, weightedCount;
+
+    if (!(in >> state >> rRes.seconds >> count >> weightedCount))
+        return false;
+
+    rRes.exitState = (SOLVER_StateT) state;
+    return from_stringT(rRes.count, count.c_str())
+           && from_stringT(rRes.weightedCount, weightedCount.c_str());
+}
+
+bool CCubeConquer::run(CMainSolver &solver, const char *cnfFile, unsigned int k)
+{
+    CStopWatch watch;
+    watch.markStartTime();
+
+    if (k > MAX_CUBE_VARS)
+    {
+        toERROUT(" At most "<< MAX_CUBE_VARS <<" split variables, not "<< k<<endl);
+        return false;
+    }
+    if (!solver.pickCubeVars(cnfFile, k, theVars))
+        return false;
+    if (theVars.size() > MAX_CUBE_VARS)
+    {
+        toERROUT(" At most "<< MAX_CUBE_VARS <<" split variables, not "
+                 << theVars.size()<<endl);
+        return false;
+    }
+    bWeighted = solver.isWeighted();
+    nVars = solver.originalVarCount;
+
+    unsigned int nCubes = 1u << theVars.size();
+    theResults.assign(nCubes, CCubeResult());
+
+    const char *tmp = getenv("TMPDIR");
+    string dirName = string(tmp != NULL ? tmp : "/tmp") + "/dsharp-cubes-XXXXXX";
+    vector<char> dirBuf(dirName.begin(), dirName.end());
+    dirBuf.push_back(0);
+    if (mkdtemp(&dirBuf[0]) == NULL)
+    {
+        toERROUT(" Error creating the work directory "<< dirName<<endl);
+        return false;
+    }
+    theWorkDir = &dirBuf[0];
+
+    toSTDOUT("Cubes:\t\t\t"<< nCubes <<" on "<< nWorkers <<" workers, split on");
+    for (unsigned int i = 0; i < theVars.size(); i++)
+        toSTDOUT(" "<< theVars[i]);
+    toSTDOUT(endl);
+
+    map<pid_t, unsigned int> running;
+    unsigned int next = 0, nDone = 0;
+    bool ok = true;
+
+    // the state of the first cube that did not succeed, no cube is
+    //  started after it
+    SOLVER_StateT stopState = SUCCESS;
+
+    while ((ok && stopState == SUCCESS && next < nCubes) || !running.empty())
+    {
+        if (ok && stopState == SUCCESS && next < nCubes && running.size() < nWorkers)
+        {
+            watch.markStopTime();
+            long secsLeft = (long) theConf().secsTimeBound - (long) watch.getElapsedTime();
+            if (secsLeft <= 0)
+            {
+                stopState = TIMEOUT;
+                continue;
+            }
+
+            // the buffers would be written by both processes
+            fflush(stdout);
+            std::cout.flush();
+
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                toERROUT(" Error starting a worker: "<< strerror(errno)<<endl);
+                ok = false;
+                for (map<pid_t, unsigned int>::iterator it = running.begin();
+                        it != running.end(); it++)
+                    kill(it->first, SIGKILL);
+                continue;
+            }
+            if (pid == 0)
+                runWorker(solver, cnfFile, next, secsLeft);
+
+            running[pid] = next++;
+            continue;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            toERROUT(" Error waiting for the workers: "<< strerror(errno)<<endl);
+            return false;
+        }
+
+        map<pid_t, unsigned int>::iterator it = running.find(pid);
+        if (it == running.end())
+            continue;
+        unsigned int c = it->second;
+        running.erase(it);
+
+        // killed below, its result is of no use
+        if (!ok || stopState != SUCCESS)
+            continue;
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || !readResult(c))
+        {
+            toERROUT(" The worker of cube "<< c <<" failed"<<endl);
+            ok = false;
+        }
+        else if (theResults[c].exitState == SUCCESS)
+        {
+            toSTDOUT("cube "<< ++nDone <<"/"<< nCubes <<" (#"<< c <<"):\t"
+                     << theResults[c].count <<" models, "<< theResults[c].seconds <<"s"<<endl);
+        }
+        else
+        {
+            stopState = theResults[c].exitState;
+            toSTDOUT("cube "<< ++nDone <<"/"<< nCubes <<" (#"<< c <<"):\t"
+                     << (stopState == TIMEOUT ? "TIMEOUT" : "ABORTED")
+                     <<" after "<< theResults[c].seconds <<"s"<<endl);
+        }
+
+        // the run can not succeed any more, stop the other cubes
+        if (!ok || stopState != SUCCESS)
+            for (it = running.begin(); it != running.end(); it++)
+                kill(it->first, SIGKILL);
+    }
+
+    if (!ok)
+        return false;
+
+    if (stopState != SUCCESS)
+    {
+        theExitState = stopState;
+        return true;
+    }
+
+    theExitState = SUCCESS;
+    theCount = 0;
+    theWeightedCount = 0;
+    for (unsigned int c = 0; c < nCubes; c++)
+    {
+        if (theResults[c].exitState != SUCCESS)
+            theExitState = theResults[c].exitState;
+        theCount += theResults[c].count;
+        theWeightedCount += theResults[c].weightedCount;
+    }
+
+    return true;
+}
+
+bool CCubeConquer::writeNNF(const char *fileName, string &err) const
+{
+    unsigned int nCubes = theResults.size();
+    vector<long> cubeNodes(nCubes, 0), cubeEdges(nCubes, 0);
+
+    // the d-DNNFs of the cubes without models are left out
+    for (unsigned int c = 0; c < nCubes; c++)
+    {
+        if (theResults[c].count == 0)
+            continue;
+
+        ifstream in(cubeFile(c, "nnf").c_str());
+        string magic;
+        long vars;
+        if (!(in >> magic >> cubeNodes[c] >> cubeEdges[c] >> vars) || magic != "nnf")
+        {
+            err = "no nnf header in " + cubeFile(c, "nnf");
+            return false;
+        }
+    }
+
+    // the decision tree, bottom up: level i decides on theVars[i] between
+    //  the cubes that agree on the variables before it
+    vector<long> root(nCubes, -1);
+    long nNodes = 0, nEdges = 0;
+    for (unsigned int c = 0; c < nCubes; c++)
+        if (cubeNodes[c] > 0)
+        {
+            nNodes += cubeNodes[c];
+            nEdges += cubeEdges[c];
+            root[c] = nNodes - 1;
+        }
+
+    vector<long> decisions; // var, positive child, negative child
+    for (int i = (int) theVars.size() - 1; i >= 0; i--)
+    {
+        unsigned int half = 1u << i;
+        for (unsigned int p = 0; p < half; p++)
+        {
+            long pos = root[p | half], neg = root[p];
+            if (pos >= 0 && neg >= 0)
+            {
+                decisions.push_back(abs(theVars[i]));
+                decisions.push_back(pos);
+                decisions.push_back(neg);
+                root[p] = nNodes++;
+                nEdges += 2;
+            }
+            else if (pos >= 0)
+                root[p] = pos;
+        }
+    }
+
+    // the root has to be the last node
+    bool wrapRoot = root[0] >= 0 && root[0] != nNodes - 1;
+
+    COutputFile out;
+    if (!out.open(fileName))
+    {
+        err = string("can not write ") + fileName;
+        return false;
+    }
+
+    if (root[0] < 0)
+    {
+        out.put("nnf 1 0 ");
+        out.putInt(nVars);
+        out.put("\nO 0 0\n");
+        return out.close();
+    }
+
+    out.put("nnf ");
+    out.putInt(nNodes + (wrapRoot ? 1 : 0));
+    out.put(' ');
+    out.putInt(nEdges + (wrapRoot ? 1 : 0));
+    out.put(' ');
+    out.putInt(nVars);
+    out.put('\n');
+
+    long offset = 0;
+    for (unsigned int c = 0; c < nCubes; c++)
+    {
+        if (cubeNodes[c] == 0)
+            continue;
+
+        ifstream in(cubeFile(c, "nnf").c_str());
+        string line;
+        getline(in, line);
+
+        // the children of And and Or nodes move by offset, the decision
+        //  variable of an Or node and the literals stay
+        for (long n = 0; n < cubeNodes[c]; n++)
+        {
+            if (!getline(in, line) || line.empty())
+            {
+                err = "truncated nnf " + cubeFile(c, "nnf");
+                out.close();
+                return false;
+            }
+
+            const char *p = line.c_str();
+            char *end;
+            char type = *p++;
+            out.put(type);
+
+            if (type == 'L')
+            {
+                out.put(' ');
+                out.putInt(strtol(p, &end, 10));
+                out.put('\n');
+                continue;
+            }
+
+            if (type == 'O')
+            {
+                out.put(' ');
+                out.putInt(strtol(p, &end, 10));
+                p = end;
+            }
+
+            long nChildren = strtol(p, &end, 10);
+            p = end;
+            out.put(' ');
+            out.putInt(nChildren);
+            for (long i = 0; i < nChildren; i++)
+            {
+                out.put(' ');
+                out.putInt(strtol(p, &end, 10) + offset);
+                p = end;
+            }
+            out.put('\n');
+        }
+
+        offset += cubeNodes[c];
+    }
+
+    for (unsigned int d = 0; d < decisions.size(); d += 3)
+    {
+        out.put("O ");
+        out.putInt(decisions[d]);
+        out.put(" 2 ");
+        out.putInt(decisions[d + 1]);
+        out.put(' ');
+        out.putInt(decisions[d + 2]);
+        out.put('\n');
+    }
+
+    if (wrapRoot)
+    {
+        out.put("A 1 ");
+        out.putInt(root[0]);
+        out.put('\n');
+    }
+
+    if (!out.close())
+    {
+        err = string("can not write ") + fileName;
+        return false;
+    }
+    return true;
+}
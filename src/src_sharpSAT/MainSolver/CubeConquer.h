@@ -0,0 +1,131 @@
+#ifndef CUBECONQUER_H
+#define CUBECONQUER_H
+
+#include <vector>
+#include <string>
+
+#include <RealNumberTypes.h>
+
+#include "../Basics.h"
+
+using std::vector;
+using std::string;
+
+class CMainSolver;
+
+/** Compiles a formula as 2^k cubes, each in a worker process of its own
+ *
+ *  The k variables the solver would decide on first split the formula
+ *  into the cubes of their literals. A forked worker compiles the formula
+ *  with the literals of its cube as unit clauses and leaves the d-DNNF and
+ *  the counts in the work directory, at most nWorkers of them at a time.
+ *  The cubes have no model in common, so the counts add up, and the d-DNNF
+ *  of the formula is a tree of decision (Or) nodes over the k variables
+ *  with the d-DNNFs of the cubes as its leaves.
+ *
+ *  The time bound of theConf() holds for the whole run: a worker gets
+ *  the time that is left when it starts, and once a cube runs out of time
+ *  or aborts no further cube is started and the running ones are killed.
+ */
+class CCubeConquer
+{
+    struct CCubeResult
+    {
+        SOLVER_StateT exitState;
+        double seconds;
+        CRealNum count;
+        CRealNum weightedCount;
+    };
+
+    unsigned int nWorkers;
+
+    // the files of the workers, removed with the object
+    string theWorkDir;
+
+    // the split variables, cube c sets vars[i] if bit i of c is set
+    vector<int> theVars;
+    vector<CCubeResult> theResults;
+
+    bool bWeighted;
+
+    // the variables of the file, every d-DNNF is over all of them
+    unsigned int nVars;
+
+    SOLVER_StateT theExitState;
+    CRealNum theCount;
+    CRealNum theWeightedCount;
+
+    string cubeFile(unsigned int c, const char *ext) const;
+
+    // the literals of cube c
+    void cubeLits(unsigned int c, vector<int> &lits) const;
+
+    // compiles cube c in the forked process within secsLeft and exits
+    void runWorker(const CMainSolver &parent, const char *cnfFile, unsigned int c,
+                   long secsLeft);
+
+    bool readResult(unsigned int c);
+
+    CCubeConquer(const CCubeConquer &);
+    CCubeConquer &operator=(const CCubeConquer &);
+
+public:
+
+    /// the most split variables run() accepts, 2^k worker processes
+    enum { MAX_CUBE_VARS = 20 };
+
+    /// nWorkers processes at a time, all of the online cpus for 0
+    CCubeConquer(unsigned int workers);
+
+    ~CCubeConquer();
+
+    /// picks k split variables with solver, which keeps the preprocessed
+    /// formula, and compiles the cubes. Returns false if k is above
+    /// MAX_CUBE_VARS or a worker could not be started or failed; a cube
+    /// that runs out of time is no failure, see exitState()
+    bool run(CMainSolver &solver, const char *cnfFile, unsigned int k);
+
+    /// SUCCESS once every cube is compiled
+    SOLVER_StateT exitState() const
+    {
+        return theExitState;
+    }
+
+    const CRealNum &count() const
+    {
+        return theCount;
+    }
+
+    bool isWeighted() const
+    {
+        return bWeighted;
+    }
+
+    const CRealNum &weightedCount() const
+    {
+        return theWeightedCount;
+    }
+
+    const vector<int> &splitVars() const
+    {
+        return theVars;
+    }
+
+    unsigned int countWorkers() const
+    {
+        return nWorkers;
+    }
+
+    /// writes the d-DNNF of the formula, the decision tree over the split
+    /// variables joined with the d-DNNFs of the cubes, in the nnf format
+    /// of -Fnnf. Returns false if a file can not be read or written.
+    bool writeNNF(const char *fileName, string &err) const;
+
+    /// a file in the work directory
+    string workFile(const char *name) const
+    {
+        return theWorkDir + "/" + name;
+    }
+};
+
+#endif
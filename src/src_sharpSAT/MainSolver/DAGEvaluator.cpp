@@ -0,0 +1,567 @@
+#include "DAGEvaluator.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+#include <InputReader.h>
+#include <NNFBinFile.h>
+
+void CDAGEvaluator::clear()
+{
+    theTypes.clear();
+    theLits.clear();
+    theFirstChild.clear();
+    theChildren.clear();
+    theValues.clear();
+    theLitProbs.clear();
+    theDerivs.clear();
+    theLitDerivs.clear();
+    nVars = 0;
+}
+
+void CDAGEvaluator::build(CDTNodeArena &arena, DTNode *root,
+                          unsigned int nVariables)
+{
+    clear();
+    nVars = nVariables;
+
+    // the index of every node in the arrays, -1 while it is not copied
+    vector<int> index(arena.countNodes(), -1);
+    vector<unsigned char> state(arena.countNodes(), 0);
+    vector<DTNode *> openList(1, root);
+
+    theFirstChild.push_back(0);
+
+    while (!openList.empty())
+    {
+        DTNode *node = openList.back();
+        int id = node->getID();
+
+        if (state[id] == 2)
+        {
+            openList.pop_back();
+            continue;
+        }
+
+        // the children of True and False do not matter, compressNode
+        //  leaves them on a node it turns into a constant
+        bool constant = node->isTop() || node->isBottom();
+
+        if (state[id] == 0 && !constant)
+        {
+            state[id] = 1;
+            for (DTNode::ChildIterator it = node->getChildrenBegin();
+                    it != node->getChildrenEnd(); it++)
+                if (state[(*it)->getID()] == 0)
+                    openList.push_back(*it);
+            continue;
+        }
+        openList.pop_back();
+        state[id] = 2;
+
+        index[id] = theTypes.size();
+        theTypes.push_back(node->getType());
+        theLits.push_back(node->getType() == DT_NodeType::kDTLit ? node->getVal() : 0);
+
+        if (!constant)
+            for (DTNode::ChildIterator it = node->getChildrenBegin();
+                    it != node->getChildrenEnd(); it++)
+                theChildren.push_back(index[(*it)->getID()]);
+        theFirstChild.push_back(theChildren.size());
+
+        if (abs(theLits.back()) > (int) nVars)
+            nVars = abs(theLits.back());
+    }
+
+    theValues.resize(theTypes.size());
+    theLitProbs.resize(2 * (nVars + 1));
+}
+
+void CDAGEvaluator::buildFalse(unsigned int nVariables)
+{
+    clear();
+    nVars = nVariables;
+
+    theTypes.push_back(DT_NodeType::kDTBottom);
+    theLits.push_back(0);
+    theFirstChild.push_back(0);
+    theFirstChild.push_back(0);
+
+    theValues.resize(1);
+    theLitProbs.resize(2 * (nVars + 1));
+}
+
+// tokenizing helpers for the text nnf format, a window of the input
+//  reader always ends at a line break
+
+static inline const char *findEndOfLine(const char *pos, const char *end)
+{
+    const char *eol = (const char *) memchr(pos, '\n', end - pos);
+    return (eol == NULL) ? end : eol;
+}
+
+static inline bool readNNFInt(const char *&pos, const char *end, long long &val)
+{
+    while (pos < end && isspace((unsigned char) *pos))
+        pos++;
+
+    bool neg = false;
+    if (pos < end && *pos == '-')
+        neg = (*pos++ == '-');
+
+    if (pos == end || !isdigit((unsigned char) *pos))
+        return false;
+
+    long long v = 0;
+    while (pos < end && isdigit((unsigned char) *pos) && v <= INT_MAX)
+        v = v * 10 + (*pos++ - '0');
+
+    val = neg ? -v : v;
+    return v <= INT_MAX;
+}
+
+static inline bool readNNFUInt(const char *&pos, const char *end, unsigned int &val)
+{
+    long long v;
+    if (!readNNFInt(pos, end, v) || v < 0)
+        return false;
+    val = v;
+    return true;
+}
+
+bool CDAGEvaluator::loadNNF(const char *fileName, string &err)
+{
+    clear();
+
+    char magic[8];
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL)
+    {
+        err = "can not be read";
+        return false;
+    }
+    bool binary = (fread(magic, 1, 8, file) == 8
+                   && memcmp(magic, NNF_BIN_MAGIC, 8) == 0);
+    fclose(file);
+
+    if (!binary)
+        return loadNNFText(fileName, err);
+
+    CNNFBinReader in;
+    if (!in.open(fileName, err))
+        return false;
+
+    nVars = in.countVars();
+    theFirstChild.push_back(0);
+
+    NNFBinNode node;
+    while (in.next(node, err))
+    {
+        if (node.type == 'L')
+        {
+            if (node.lit == 0 || node.lit > INT_MAX || node.lit < -INT_MAX)
+            {
+                err = "holds a literal out of range";
+                return false;
+            }
+            theTypes.push_back(DT_NodeType::kDTLit);
+            theLits.push_back(node.lit);
+            if (abs(theLits.back()) > (int) nVars)
+                nVars = abs(theLits.back());
+        }
+        else
+        {
+            theTypes.push_back(node.type == 'A' ? DT_NodeType::kDTAnd : DT_NodeType::kDTOr);
+            theLits.push_back(0);
+            // the reader checked that every child comes before its parent
+            for (unsigned int i = 0; i < node.children.size(); i++)
+                theChildren.push_back(node.children[i]);
+        }
+        theFirstChild.push_back(theChildren.size());
+    }
+
+    if (!err.empty())
+        return false;
+
+    if (theTypes.empty())
+    {
+        err = "holds no nodes";
+        return false;
+    }
+
+    theValues.resize(theTypes.size());
+    theLitProbs.resize(2 * (nVars + 1));
+    return true;
+}
+
+bool CDAGEvaluator::loadNNFText(const char *fileName, string &err)
+{
+    CInputReader in;
+
+    if (!in.open(fileName))
+    {
+        err = in.getError();
+        return false;
+    }
+
+    const char *pos, *end, *eol;
+    unsigned int nLine = 0;
+    unsigned int nNodes = 0, nEdges = 0;
+    bool readingHeader = true;
+    char lineErr[64];
+
+    theFirstChild.push_back(0);
+
+    while (in.nextWindow(pos, end))
+    {
+        for (; pos < end; pos = (eol == end) ? end : eol + 1)
+        {
+            eol = findEndOfLine(pos, end);
+            nLine++;
+
+            const char *p = pos;
+            while (p < eol && isspace((unsigned char) *p))
+                p++;
+            if (p == eol)
+                continue;
+
+            if (readingHeader)
+            {
+                unsigned int nHeaderVars;
+                bool ok = (eol - p >= 3 && strncmp(p, "nnf", 3) == 0);
+                p += 3;
+                if (!ok || !readNNFUInt(p, eol, nNodes) || !readNNFUInt(p, eol, nEdges)
+                        || !readNNFUInt(p, eol, nHeaderVars))
+                {
+                    sprintf(lineErr, "line %u: ", nLine);
+                    err = string(lineErr) + "expected the header nnf Nodes Edges Vars";
+                    return false;
+                }
+                nVars = nHeaderVars;
+                // every node and edge takes at least two bytes of text, a
+                //  header claiming more is not trusted
+                if (nNodes + (size_t) nEdges <= in.getFileSize())
+                {
+                    theTypes.reserve(nNodes);
+                    theLits.reserve(nNodes);
+                    theFirstChild.reserve(nNodes + 1);
+                    theChildren.reserve(nEdges);
+                }
+                readingHeader = false;
+                continue;
+            }
+
+            bool ok = true;
+
+            if (*p == 'L')
+            {
+                long long lit = 0;
+                ok = readNNFInt(++p, eol, lit) && lit != 0;
+                theTypes.push_back(DT_NodeType::kDTLit);
+                theLits.push_back(lit);
+                if (ok && abs(theLits.back()) > (int) nVars)
+                    nVars = abs(theLits.back());
+            }
+            else if (*p == 'A' || *p == 'O')
+            {
+                unsigned int choiceVar, nChildren, child;
+                theTypes.push_back(*p == 'A' ? DT_NodeType::kDTAnd : DT_NodeType::kDTOr);
+                theLits.push_back(0);
+
+                ok = (*p++ == 'A' || readNNFUInt(p, eol, choiceVar))
+                     && readNNFUInt(p, eol, nChildren);
+                for (unsigned int i = 0; ok && i < nChildren; i++)
+                {
+                    // a child has to come before its parent
+                    ok = readNNFUInt(p, eol, child) && child + 1 < theTypes.size();
+                    theChildren.push_back(child);
+                }
+            }
+            else
+                ok = false;
+
+            if (!ok)
+            {
+                sprintf(lineErr, "line %u: ", nLine);
+                err = string(lineErr) + "expected L lit, A n children or O var n children";
+                return false;
+            }
+            theFirstChild.push_back(theChildren.size());
+        }
+    }
+
+    if (in.failed())
+    {
+        err = in.getError();
+        return false;
+    }
+
+    if (theTypes.empty())
+    {
+        err = "holds no nodes";
+        return false;
+    }
+
+    theValues.resize(theTypes.size());
+    theLitProbs.resize(2 * (nVars + 1));
+    return true;
+}
+
+CRealNum CDAGEvaluator::evaluate()
+{
+    for (unsigned int i = 0; i < theTypes.size(); i++)
+    {
+        CRealNum &val = theValues[i];
+        unsigned int end = theFirstChild[i + 1];
+
+        switch (theTypes[i])
+        {
+        case DT_NodeType::kDTLit:
+            val = theLitProbs[2 * abs(theLits[i]) + (theLits[i] < 0)];
+            break;
+        case DT_NodeType::kDTAnd:
+            val = 1;
+            for (unsigned int c = theFirstChild[i]; c < end; c++)
+                val *= theValues[theChildren[c]];
+            break;
+        case DT_NodeType::kDTOr:
+            val = 0;
+            for (unsigned int c = theFirstChild[i]; c < end; c++)
+                val += theValues[theChildren[c]];
+            break;
+        case DT_NodeType::kDTTop:
+            val = 1;
+            break;
+        default:
+            val = 0;
+        }
+    }
+
+    return theValues.back();
+}
+
+bool CDAGEvaluator::countModels(const vector<int> &assumptions,
+                                CRealNum &rCount)
+{
+    rCount = 0;
+
+    CRealNum half;
+    to_div_2exp(half, CRealNum(1), 1);
+
+    for (unsigned int i = 0; i < theLitProbs.size(); i++)
+        theLitProbs[i] = half;
+
+    unsigned int nFree = nVars;
+    bool conflict = false;
+
+    for (unsigned int i = 0; i < assumptions.size(); i++)
+    {
+        int lit = assumptions[i];
+        unsigned int var = abs(lit);
+
+        if (lit == 0 || var > nVars)
+            return false;
+
+        CRealNum &pos = theLitProbs[2 * var + (lit < 0)];
+        CRealNum &neg = theLitProbs[2 * var + (lit > 0)];
+
+        if (pos == 0)
+            conflict = true;
+        else if (pos == half)
+            nFree--;
+
+        pos = 1;
+        neg = 0;
+    }
+
+    if (conflict || empty())
+        return true;
+
+    CRealNum scale;
+    pow2(scale, nFree);
+
+    rCount = evaluate() * scale;
+    return true;
+}
+
+bool CDAGEvaluator::setWeightedProbs(const vector<CRealNum> &litWeights,
+                                     const vector<int> &assumptions,
+                                     bool &rConflict, CRealNum &rScale)
+{
+    // theLitProbs marks the assumed literals with 1 and their negation
+    //  with 0 first, the other variables are free
+    for (unsigned int i = 0; i < theLitProbs.size(); i++)
+        theLitProbs[i] = -1;
+
+    rConflict = false;
+
+    for (unsigned int i = 0; i < assumptions.size(); i++)
+    {
+        int lit = assumptions[i];
+        unsigned int var = abs(lit);
+
+        if (lit == 0 || var > nVars)
+            return false;
+
+        CRealNum &pos = theLitProbs[2 * var + (lit < 0)];
+        CRealNum &neg = theLitProbs[2 * var + (lit > 0)];
+
+        if (pos == 0)
+            rConflict = true;
+
+        pos = 1;
+        neg = 0;
+    }
+
+    rScale = 1;
+
+    for (unsigned int var = 1; var <= nVars; var++)
+    {
+        CRealNum &pos = theLitProbs[2 * var];
+        CRealNum &neg = theLitProbs[2 * var + 1];
+
+        // a variable beyond the weights weighs 1 in both polarities
+        CRealNum wPos = 1, wNeg = 1;
+        if (LiteralIdT(var, true).toUInt() < litWeights.size())
+        {
+            wPos = litWeights[LiteralIdT(var, true).toUInt()];
+            wNeg = litWeights[LiteralIdT(var, false).toUInt()];
+        }
+
+        if (pos == 1)
+            rScale *= wPos;
+        else if (neg == 1)
+            rScale *= wNeg;
+        else
+        {
+            CRealNum sum = wPos + wNeg;
+            if (sum == 0)
+                return false;
+
+            pos = wPos / sum;
+            neg = wNeg / sum;
+            rScale *= sum;
+        }
+    }
+
+    return true;
+}
+
+bool CDAGEvaluator::weightedCount(const vector<CRealNum> &litWeights,
+                                  const vector<int> &assumptions,
+                                  CRealNum &rCount)
+{
+    rCount = 0;
+
+    bool conflict;
+    CRealNum scale;
+
+    if (!setWeightedProbs(litWeights, assumptions, conflict, scale))
+        return false;
+
+    if (conflict || empty())
+        return true;
+
+    rCount = evaluate() * scale;
+    return true;
+}
+
+void CDAGEvaluator::differentiate()
+{
+    theDerivs.resize(theTypes.size());
+    for (unsigned int i = 0; i < theDerivs.size(); i++)
+        theDerivs[i] = 0;
+    theDerivs.back() = 1;
+
+    theLitDerivs.resize(theLitProbs.size());
+    for (unsigned int i = 0; i < theLitDerivs.size(); i++)
+        theLitDerivs[i] = 0;
+
+    // back to front, every parent comes after its children
+    for (unsigned int i = theTypes.size(); i-- > 0;)
+    {
+        const CRealNum &deriv = theDerivs[i];
+        unsigned int first = theFirstChild[i];
+        unsigned int end = theFirstChild[i + 1];
+
+        if (deriv == 0)
+            continue;
+
+        switch (theTypes[i])
+        {
+        case DT_NodeType::kDTLit:
+            theLitDerivs[2 * abs(theLits[i]) + (theLits[i] < 0)] += deriv;
+            break;
+        case DT_NodeType::kDTAnd:
+        {
+            // a child gets the product of its siblings, the products of the
+            //  children before it front to back and after it back to front,
+            //  so a child with value 0 needs no division
+            if (theProducts.size() < end - first)
+                theProducts.resize(end - first);
+
+            CRealNum prod = deriv;
+            for (unsigned int c = first; c < end; c++)
+            {
+                theProducts[c - first] = prod;
+                prod *= theValues[theChildren[c]];
+            }
+
+            prod = 1;
+            for (unsigned int c = end; c-- > first;)
+            {
+                theDerivs[theChildren[c]] += theProducts[c - first] * prod;
+                prod *= theValues[theChildren[c]];
+            }
+            break;
+        }
+        case DT_NodeType::kDTOr:
+            for (unsigned int c = first; c < end; c++)
+                theDerivs[theChildren[c]] += deriv;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool CDAGEvaluator::marginals(const vector<CRealNum> &litWeights,
+                              const vector<int> &assumptions,
+                              CRealNum &rCount, vector<CRealNum> &rLitCounts)
+{
+    rCount = 0;
+    rLitCounts.assign(2 * (nVars + 1), CRealNum(0));
+
+    bool conflict;
+    CRealNum scale;
+
+    if (!setWeightedProbs(litWeights, assumptions, conflict, scale))
+        return false;
+
+    if (conflict || empty())
+        return true;
+
+    CRealNum root = evaluate();
+    differentiate();
+
+    rCount = root * scale;
+
+    // decomposability makes the root a + b p(x) + c p(-x), where a sums
+    //  the branches without x, b = d root / d p(x) and c = d root / d p(-x).
+    //  x is free in the branches of a, so x holds in p(x) (a + b) of the
+    //  root, which is p(x) (root + p(-x) (b - c)) as p(x) + p(-x) = 1
+    for (unsigned int var = 1; var <= nVars; var++)
+    {
+        const CRealNum &pos = theLitProbs[2 * var];
+        const CRealNum &neg = theLitProbs[2 * var + 1];
+        CRealNum diff = theLitDerivs[2 * var] - theLitDerivs[2 * var + 1];
+
+        rLitCounts[LiteralIdT(var, true).toUInt()] = pos * (root + neg * diff) * scale;
+        rLitCounts[LiteralIdT(var, false).toUInt()] = neg * (root - pos * diff) * scale;
+    }
+
+    return true;
+}
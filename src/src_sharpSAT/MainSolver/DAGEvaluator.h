@@ -0,0 +1,155 @@
+#ifndef DAGEVALUATOR_H
+#define DAGEVALUATOR_H
+
+#include <vector>
+#include <string>
+
+#include <RealNumberTypes.h>
+
+#include "DecisionTree.h"
+
+using std::vector;
+using std::string;
+
+/** The final d-DNNF in a flat form for counting after the search
+ *
+ *  build() copies the nodes reachable from the root into arrays, every
+ *  node after all of its children, so a query is one front to back pass
+ *  and the DTNode graph is not touched again. The copy does not change
+ *  when the literals of a query change, so one compilation answers any
+ *  number of queries.
+ *
+ *  A query evaluates the d-DNNF with the probability of every literal:
+ *  1/2 for a free variable, 1 or 0 if the variable is assumed. AND nodes
+ *  multiply (decomposable), OR nodes add (deterministic), and the root
+ *  value times 2^#free variables is the number of models. The d-DNNF does
+ *  not have to be smooth, a variable missing below an OR branch simply
+ *  contributes a factor 1 there.
+ *
+ *  The weighted count works the same way with the probability
+ *  w(x) / (w(x) + w(-x)) of a literal x and the product of all
+ *  w(x) + w(-x) in place of 2^#free variables.
+ *
+ *  marginals() follows the evaluation with one back to front pass that
+ *  takes the derivative of the root by every node, which gives the count
+ *  under every single literal at once instead of a pass per literal.
+ *
+ *  loadNNF() reads the same arrays from a file written with -Fnnf or
+ *  -Fnnfbin, so a d-DNNF can be queried without compiling it again.
+ */
+class CDAGEvaluator
+{
+    // the nodes in evaluation order, the root is the last one
+    vector<unsigned char> theTypes;     // a DT_NodeType
+    vector<int> theLits;                // the literal of a kDTLit node
+    vector<unsigned int> theFirstChild; // nNodes + 1 offsets into theChildren
+    vector<unsigned int> theChildren;   // node indices
+
+    unsigned int nVars;
+
+    vector<CRealNum> theValues;
+
+    // the probability of lit at 2 * var + (lit < 0)
+    vector<CRealNum> theLitProbs;
+
+    // the derivatives of the root value by the value of every node and
+    //  by the probability of every literal, and a scratch row for And
+    vector<CRealNum> theDerivs;
+    vector<CRealNum> theLitDerivs;
+    vector<CRealNum> theProducts;
+
+    CRealNum evaluate();
+
+    // a backward pass over the values of the last evaluate()
+    void differentiate();
+
+    // theLitProbs for weightedCount(), rScale is the factor of the root
+    bool setWeightedProbs(const vector<CRealNum> &litWeights,
+                          const vector<int> &assumptions,
+                          bool &rConflict, CRealNum &rScale);
+
+    bool loadNNFText(const char *fileName, string &err);
+
+    // CBatchEvaluator copies the node arrays, CDAGSampler reads them
+    //  and the values of the last evaluation
+    friend class CBatchEvaluator;
+    friend class CDAGSampler;
+
+public:
+
+    CDAGEvaluator()
+        : nVars(0)
+    {}
+
+    /// copies the d-DNNF below root, a theory over the variables 1..nVars
+    void build(CDTNodeArena &arena, DTNode *root, unsigned int nVars);
+
+    /// the d-DNNF of an unsatisfiable theory
+    void buildFalse(unsigned int nVars);
+
+    /// reads an nnf file in the text or the binary format, returns false
+    /// and sets err if the file can not be read or is malformed
+    bool loadNNF(const char *fileName, string &err);
+
+    void clear();
+
+    bool empty() const
+    {
+        return theTypes.empty();
+    }
+
+    unsigned int countNodes() const
+    {
+        return theTypes.size();
+    }
+
+    unsigned int countVars() const
+    {
+        return nVars;
+    }
+
+    /// node i, a DT_NodeType; the children of a node come before it and
+    /// the root is the last node
+    DT_NodeType nodeType(unsigned int i) const
+    {
+        return (DT_NodeType) theTypes[i];
+    }
+
+    /// the literal of a kDTLit node, 0 for the other types
+    int nodeLit(unsigned int i) const
+    {
+        return theLits[i];
+    }
+
+    unsigned int countChildren(unsigned int i) const
+    {
+        return theFirstChild[i + 1] - theFirstChild[i];
+    }
+
+    /// the countChildren(i) node indices of the children of node i
+    const unsigned int *children(unsigned int i) const
+    {
+        return theChildren.data() + theFirstChild[i];
+    }
+
+    /// The number of models over nVars variables that make every literal
+    /// of assumptions true. Returns false if a literal is not over one of
+    /// the variables, contradicting literals just give 0.
+    bool countModels(const vector<int> &assumptions, CRealNum &rCount);
+
+    /// The sum of the weights of these models, the weight of a model is the
+    /// product of litWeights[LiteralIdT(lit).toUInt()] over its literals.
+    /// Also returns false for a free variable with w(x) + w(-x) = 0.
+    bool weightedCount(const vector<CRealNum> &litWeights,
+                       const vector<int> &assumptions, CRealNum &rCount);
+
+    /// weightedCount() and at the same time in
+    /// rLitCounts[LiteralIdT(lit).toUInt()] the weighted count of the
+    /// models in which lit holds as well, for every literal. Pass empty
+    /// litWeights for plain model counts.
+    bool marginals(const vector<CRealNum> &litWeights,
+                   const vector<int> &assumptions,
+                   CRealNum &rCount, vector<CRealNum> &rLitCounts);
+};
+
+#endif
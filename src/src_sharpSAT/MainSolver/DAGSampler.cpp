@@ -0,0 +1,225 @@
+#include "DAGSampler.h"
+
+#include <stdlib.h>
+#include <thread>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+// splitmix64, small and fast with a state of one word
+static inline uint64_t nextRandom(uint64_t &state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// uniform in [0, 1)
+static inline double nextUnit(uint64_t &state)
+{
+    return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// writes n at pos, returns the end of it
+static inline char *writeInt(char *pos, int n)
+{
+    char digits[12];
+    int len = 0;
+    unsigned int u = (n < 0) ? -(unsigned int) n : n;
+
+    do
+    {
+        digits[len++] = '0' + u % 10;
+        u /= 10;
+    }
+    while (u > 0);
+
+    if (n < 0)
+        *pos++ = '-';
+    while (len > 0)
+        *pos++ = digits[--len];
+
+    return pos;
+}
+
+bool CDAGSampler::build(CDAGEvaluator &eval, const vector<CRealNum> &litWeights,
+                        const vector<int> &assumptions)
+{
+    theDAG = NULL;
+
+    // fills theValues and theLitProbs of eval
+    CRealNum count;
+    if (!eval.weightedCount(litWeights, assumptions, count) || eval.empty()
+            || !(count > 0))
+        return false;
+
+    nVars = eval.nVars;
+    theFreeProbs.resize(nVars + 1);
+
+    for (unsigned int var = 1; var <= nVars; var++)
+    {
+        if (eval.theLitProbs[2 * var] < 0 || eval.theLitProbs[2 * var + 1] < 0)
+            return false;
+        theFreeProbs[var] = to_doubleT(eval.theLitProbs[2 * var]);
+    }
+
+    const vector<CRealNum> &values = eval.theValues;
+    const vector<unsigned int> &children = eval.theChildren;
+
+    theEdgeCum.assign(children.size(), 1.0);
+
+    for (unsigned int i = 0; i < eval.theTypes.size(); i++)
+    {
+        if (eval.theTypes[i] != DT_NodeType::kDTOr || values[i] == 0)
+            continue;
+
+        unsigned int first = eval.theFirstChild[i];
+        unsigned int end = eval.theFirstChild[i + 1];
+        CRealNum sum = 0;
+
+        for (unsigned int c = first; c < end; c++)
+        {
+            sum += values[children[c]];
+            theEdgeCum[c] = to_doubleT(sum / values[i]);
+        }
+
+        // rounding must not leave a chance for the children of value 0
+        //  behind the last child that can be taken
+        for (unsigned int c = end; c-- > first;)
+        {
+            theEdgeCum[c] = 1;
+            if (values[children[c]] != 0)
+                break;
+        }
+    }
+
+    theDAG = &eval;
+    return true;
+}
+
+void CDAGSampler::drawModel(uint64_t seed, uint64_t k, vector<unsigned int> &stack,
+                            vector<signed char> &rModel) const
+{
+    uint64_t state = seed;
+    state = nextRandom(state) ^ (k * 0xd1342543de82ef95ULL);
+
+    const vector<unsigned char> &types = theDAG->theTypes;
+    const vector<int> &lits = theDAG->theLits;
+    const vector<unsigned int> &firstChild = theDAG->theFirstChild;
+    const vector<unsigned int> &children = theDAG->theChildren;
+
+    rModel.assign(nVars + 1, 0);
+
+    stack.clear();
+    stack.push_back(types.size() - 1);
+
+    // decomposable: the branches taken share no variable, so no node is
+    //  visited twice apart from constants
+    while (!stack.empty())
+    {
+        unsigned int i = stack.back();
+        stack.pop_back();
+
+        switch (types[i])
+        {
+        case DT_NodeType::kDTLit:
+            rModel[abs(lits[i])] = (lits[i] > 0) ? 1 : -1;
+            break;
+        case DT_NodeType::kDTAnd:
+            for (unsigned int c = firstChild[i]; c < firstChild[i + 1]; c++)
+                stack.push_back(children[c]);
+            break;
+        case DT_NodeType::kDTOr:
+        {
+            double r = nextUnit(state);
+            unsigned int c = firstChild[i];
+            while (r >= theEdgeCum[c])
+                c++;
+            stack.push_back(children[c]);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    for (unsigned int var = 1; var <= nVars; var++)
+        if (rModel[var] == 0)
+            rModel[var] = (nextUnit(state) < theFreeProbs[var]) ? 1 : -1;
+}
+
+void CDAGSampler::sample(uint64_t seed, uint64_t k, vector<signed char> &rModel) const
+{
+    vector<unsigned int> stack;
+    drawModel(seed, k, stack, rModel);
+}
+
+void CDAGSampler::drawModels(uint64_t seed, uint64_t first, uint64_t last,
+                             string *rText) const
+{
+    vector<unsigned int> stack;
+    vector<signed char> model;
+
+    rText->clear();
+
+    for (uint64_t k = first; k < last; k++)
+    {
+        drawModel(seed, k, stack, model);
+
+        // a literal takes at most 11 characters and a blank
+        size_t fill = rText->size();
+        rText->resize(fill + 12 * (size_t) nVars + 2);
+
+        char *begin = &(*rText)[0];
+        char *pos = begin + fill;
+
+        for (unsigned int var = 1; var <= nVars; var++)
+        {
+            pos = writeInt(pos, model[var] * (int) var);
+            *pos++ = ' ';
+        }
+        *pos++ = '0';
+        *pos++ = '\n';
+
+        rText->resize(pos - begin);
+    }
+}
+
+bool CDAGSampler::writeSamples(FILE *out, uint64_t nSamples, uint64_t seed,
+                               unsigned int nThreads) const
+{
+    if (theDAG == NULL)
+        return false;
+
+    nThreads = max(nThreads, 1u);
+
+    // a round gives every thread a chunk of about a million literals,
+    //  the chunks are written in the order of the models
+    uint64_t chunk = max<uint64_t>(16, (1 << 20) / (nVars + 1));
+    vector<string> texts(nThreads);
+
+    for (uint64_t round = 0; round < nSamples; round += chunk * nThreads)
+    {
+        vector<std::thread> threads;
+
+        for (unsigned int t = 1; t < nThreads; t++)
+        {
+            uint64_t first = min(nSamples, round + t * chunk);
+            uint64_t last = min(nSamples, first + chunk);
+            threads.push_back(std::thread(&CDAGSampler::drawModels, this,
+                                          seed, first, last, &texts[t]));
+        }
+        drawModels(seed, round, min(nSamples, round + chunk), &texts[0]);
+
+        for (unsigned int t = 0; t < threads.size(); t++)
+            threads[t].join();
+
+        for (unsigned int t = 0; t < nThreads; t++)
+            if (fwrite(texts[t].data(), 1, texts[t].size(), out) != texts[t].size())
+                return false;
+    }
+
+    return fflush(out) == 0;
+}
@@ -0,0 +1,78 @@
+#ifndef DAGSAMPLER_H
+#define DAGSAMPLER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include <RealNumberTypes.h>
+
+#include "DAGEvaluator.h"
+
+using std::vector;
+using std::string;
+
+/** Draws random models from the d-DNNF of a CDAGEvaluator
+ *
+ *  build() evaluates the d-DNNF once and keeps for every child of an Or
+ *  node the probability to take it, its share of the value of the node,
+ *  as a running sum over the children. A model is drawn from the root
+ *  down: an And node visits all of its children, an Or node one of them
+ *  and a literal node sets its variable. A variable that no visited
+ *  literal sets is free below the branches taken and gets its own
+ *  probability. Without weights every model has the same chance, with
+ *  weights the chance of a model is its share of the weighted count.
+ *
+ *  The random numbers of model k only depend on the seed and k, so the
+ *  same seed writes the same models with any number of threads.
+ */
+class CDAGSampler
+{
+    // the d-DNNF, it has to stay alive while the sampler is used
+    const CDAGEvaluator *theDAG;
+
+    unsigned int nVars;
+
+    // for every child of an Or node the probability to take it or one of
+    //  the children before it, 1 from the last child that can be taken
+    vector<double> theEdgeCum;
+
+    // the probability of x for a variable no branch sets
+    vector<double> theFreeProbs;
+
+    // sets rModel[var] to 1 or -1 for every variable of model k
+    void drawModel(uint64_t seed, uint64_t k, vector<unsigned int> &stack,
+                   vector<signed char> &rModel) const;
+
+    // appends the models first..last - 1 as DIMACS lines to rText
+    void drawModels(uint64_t seed, uint64_t first, uint64_t last,
+                    string *rText) const;
+
+public:
+
+    CDAGSampler()
+        : theDAG(NULL), nVars(0)
+    {}
+
+    /// prepares drawing the models of the d-DNNF of eval in which the
+    /// literals of assumptions hold, weighted if litWeights is not empty.
+    /// Returns false if there is no such model, for an assumption that is
+    /// not over one of the variables and for negative weights.
+    bool build(CDAGEvaluator &eval, const vector<CRealNum> &litWeights,
+               const vector<int> &assumptions);
+
+    /// model k, rModel[var] is 1 or -1 for each of the variables
+    void sample(uint64_t seed, uint64_t k, vector<signed char> &rModel) const;
+
+    /// the most threads of writeSamples -sampleThreads accepts
+    enum { MAX_THREADS = 256 };
+
+    /// writes the models 0..nSamples - 1 to out, one line of literals
+    /// ending in 0 per model, drawn by nThreads threads. Returns false if
+    /// a write fails.
+    bool writeSamples(FILE *out, uint64_t nSamples, uint64_t seed,
+                      unsigned int nThreads) const;
+};
+
+#endif
@@ -55,7 +55,10 @@ bool CDecisionStack::pop()
         allComponentsStack.pop_back();
     }
 
-    (end()-2)->includeSol(top().getOverallSols());
+    if (theClPool.isWeighted())
+        (end()-2)->includeSol(top().getOverallSols(), top().getOverallWeightedSols());
+    else
+        (end()-2)->includeSol(top().getOverallSols());
 
     pop_back();
     return true;
@@ -75,26 +78,31 @@ void CDecisionStack::push(DTNode * other)
 }
 
 
-void CDecisionStack::init(unsigned int resSize)
+void CDecisionStack::init(CDTNodeArena &arena, unsigned int resSize)
 {
     clear();
     reserve(resSize);
     allImpliedLits.clear();
     allImpliedLits.reserve(theClPool.countAllVars());
+    // left over from a previous run of the solver
+    for (vector<CComponentId *>::iterator it = allComponentsStack.begin();
+            it != allComponentsStack.end(); it++)
+        delete *it;
     allComponentsStack.clear();
     allComponentsStack.reserve(theClPool.countAllVars());
     allComponentsStack.push_back(new CComponentId());
 
     // initialize the stack to contain at least level zero
-    DTNode * dummyLeft = new DTNode(DT_NodeType::kDTAnd, 2);
-    DTNode * dummyRight = new DTNode(DT_NodeType::kDTAnd, 1);
-    dtMain = new DTNode(DT_NodeType::kDTAnd, 0);
+    dtMain = arena.newNode(DT_NodeType::kDTAnd);
+    DTNode * dummyRight = arena.newNode(DT_NodeType::kDTAnd);
+    DTNode * dummyLeft = arena.newNode(DT_NodeType::kDTAnd);
 
-    dummyLeft->addParent(dtMain, true);
-    dummyRight->addParent(dtMain, true);
+    dummyLeft->addParent(dtMain);
+    dummyRight->addParent(dtMain);
 
     push_back(CDecision(dtMain));
     back().flipped = true;
+    top().iImpLitOfs = 0;
     top().iRemCompOfs = 1;
     top().iEndRemComps = 1;
     addToDecLev = 0;
@@ -37,6 +37,10 @@ class CDecision
 
     //  Solutioncount
     CRealNum  rnNumSols[2];
+
+    //  the weighted count of a weighted formula, rnNumSols decides
+    //  when a branch is empty
+    CRealNum  rnWeightedSols[2];
     
     ////////////////////
     /// decision tree node
@@ -78,6 +82,8 @@ public:
         flipped = false;
         rnNumSols[0] = 0.0;
         rnNumSols[1] = 0.0;
+        rnWeightedSols[0] = 0.0;
+        rnWeightedSols[1] = 0.0;
         refCompId = 0;
         iImpLitOfs = (unsigned int) -1;
         iRemCompOfs = (unsigned int) -1;
@@ -92,8 +98,10 @@ public:
     DTNode * getOrDTNode() { return flipNode; }
     DTNode * getCurrentDTNode()
     {
-        if (isFlipped()) return flipNode->secondNode;
-        else return flipNode->firstNode;
+        // decisions of a counting only run have no node
+        if (flipNode == NULL) return NULL;
+        if (isFlipped()) return flipNode->secondNode();
+        else return flipNode->firstNode();
     }
 
     bool isFlipped()
@@ -112,6 +120,20 @@ public:
             rnNumSols[flipped] *= rnCodedSols;
     }
 
+    void includeSol(const CRealNum &rnCodedSols, const CRealNum &rnWeighted)
+    {
+        if (rnNumSols[flipped] == 0.0)   rnWeightedSols[flipped] = rnWeighted;
+        else
+            rnWeightedSols[flipped] *= rnWeighted;
+        includeSol(rnCodedSols);
+    }
+
+    // the weight of a literal implied in the current branch
+    void includeLitWeight(const CRealNum &rnWeight)
+    {
+        rnWeightedSols[flipped] *= rnWeight;
+    }
+
     const CRealNum &getBranchSols() const
     {
         return rnNumSols[flipped];
@@ -122,6 +144,11 @@ public:
         return rnNumSols[0] + rnNumSols[1];
     }
 
+    const CRealNum getOverallWeightedSols() const
+    {
+        return rnWeightedSols[0] + rnWeightedSols[1];
+    }
+
     friend class CDecisionStack;
 };
 
@@ -161,7 +188,12 @@ public:
         addToDecLev = 0;
     }
 
-    ~CDecisionStack() {}
+    ~CDecisionStack()
+    {
+        for (vector<CComponentId *>::iterator it = allComponentsStack.begin();
+                it != allComponentsStack.end(); it++)
+            delete *it;
+    }
 
     //begin for implicit BCP
     void beginTentative()
@@ -287,7 +319,8 @@ public:
         return size()-1+addToDecLev;    // 0 means pre-1st-decision
     }
 
-    void init(unsigned int resSize = 1);
+    // the root nodes of the d-DNNF are created in arena
+    void init(CDTNodeArena &arena, unsigned int resSize = 1);
 };
 
 /*@}*/
@@ -22,57 +22,55 @@
 #include "DecisionTree.h"
 #include "MainSolver.h"
 
-/////////////
-// DT_Node //
-/////////////
-set<DTNode *>::iterator DTNode::getChildrenBegin()
+static bool lessID(DTNode *a, DTNode *b)
 {
-	return children.begin();
+	return a->getID() < b->getID();
 }
 
-set<DTNode *>::iterator DTNode::getChildrenEnd()
+// orders literals by variable, the negative literal first
+static bool lessVar(int a, int b)
 {
-	return children.end();
+	int varA = (a < 0) ? -1 * a : a;
+	int varB = (b < 0) ? -1 * b : b;
+	return (varA < varB) || ((varA == varB) && (a < b));
 }
 
-set<int>::iterator DTNode::getVariablesBegin()
+/////////////
+// DT_Node //
+/////////////
+DTNode::ChildIterator DTNode::getChildrenBegin()
 {
-	return variables.begin();
+	return childArray();
 }
 
-set<int>::iterator DTNode::getVariablesEnd()
+DTNode::ChildIterator DTNode::getChildrenEnd()
 {
-	return variables.end();
+	return childArray() + nChildren;
 }
 
 DTNode * DTNode::onlyChild()
 {
-	return *(children.begin());
+	return childArray()[0];
 }
 
-int DTNode::numChildren()
+DTNode * DTNode::firstNode()
 {
-	return children.size();
+	return (nChildren > 0) ? childArray()[0] : NULL;
 }
 
-int DTNode::numVariables()
+DTNode * DTNode::secondNode()
 {
-	return variables.size();
+	return (nChildren > 1) ? childArray()[1] : NULL;
 }
 
-bool DTNode::hasVariable(int var)
+int DTNode::numChildren()
 {
-	return variables.find(var) != variables.end();
+	return nChildren;
 }
 
 bool DTNode::hasChild(DTNode * child)
 {
-	return children.find(child) != children.end();
-}
-
-int DTNode::numParents()
-{
-	return parents.size();
+	return std::find(getChildrenBegin(), getChildrenEnd(), child) != getChildrenEnd();
 }
 
 int DTNode::getID()
@@ -123,30 +121,50 @@ void DTNode::botIfy()
 }
 
 // Add parent
-void DTNode::addParent(DTNode * newParent, bool link)
+void DTNode::addParent(DTNode * newParent)
 {
 	if (!newParent->isValid())
 		toSTDOUT("Error: Attempting to add invalid parent." << endl);
 
-	parents.insert(newParent);
-	if (link)
-		newParent->addChild(this);
+	newParent->addChild(this);
 }
 
-// Add a child
-void DTNode::addChild(DTNode * newChild, bool link)
+// Add a child, the children form a set
+void DTNode::addChild(DTNode * newChild)
 {
 	if (!newChild->isValid())
 		toSTDOUT("Error: Attempting to add invalid child." << endl);
 
-	if (!firstNode)
-		firstNode = newChild;
-	else if (!secondNode)
-		secondNode = newChild;
+	if (hasChild(newChild))
+		return;
+
+	pushChild(newChild);
+}
+
+void DTNode::pushChild(DTNode * newChild)
+{
+	if (nChildren == capChildren)
+	{
+		// grow the child array, the first spill leaves the inline slots
+		unsigned int newCap = 2 * capChildren;
+		DTNode ** newArray = new DTNode *[newCap];
+		std::copy(getChildrenBegin(), getChildrenEnd(), newArray);
+		if (capChildren > INLINE_CHILDREN)
+			delete[] heapChildren;
+		heapChildren = newArray;
+		capChildren = newCap;
+	}
+
+	childArray()[nChildren++] = newChild;
+}
+
+void DTNode::pushUnmarked(DTNode * newChild)
+{
+	if (newChild->marked)
+		return;
 
-	children.insert(newChild);
-	if (link)
-		newChild->addParent(this);
+	newChild->marked = true;
+	pushChild(newChild);
 }
 
 // A child was deleted
@@ -155,433 +173,256 @@ bool DTNode::childDeleted(DTNode * oldChild)
 	if (!oldChild->isValid())
 		toSTDOUT("Error: Attempting to delete invalid child." << endl);
 
-	if (children.find(oldChild) == children.end())
+	ChildIterator it = std::find(getChildrenBegin(), getChildrenEnd(), oldChild);
+	if (it == getChildrenEnd())
 	{
 		return false;
 	}
-	
-	if (firstNode == oldChild)
-		firstNode = NULL;
-	
-	if (secondNode == oldChild)
-		secondNode = NULL;
 
-	children.erase(oldChild);
+	// keep the order, the first two children of an OR node are its branches
+	std::copy(it + 1, getChildrenEnd(), it);
+	nChildren--;
 
 	return true;
 }
 
-// A parent was deleted
-bool DTNode::parentDeleted(DTNode * oldParent)
+void DTNode::clearChildren()
 {
-	if (!oldParent->isValid())
-		toSTDOUT("Error: Attempting to delete invalid parent." << endl);
+	// the array is kept, the node is only ever refilled by the same passes
+	nChildren = 0;
+}
 
-	if (parents.find(oldParent) == parents.end())
-	{
-		return false;
-	}
+size_t DTNode::childMemory()
+{
+	return (capChildren > INLINE_CHILDREN) ? capChildren * sizeof(DTNode *) : 0;
+}
 
-	parents.erase(oldParent);
+void DTNode::mapChildren(const vector<DTNode *> &repr)
+{
+	ChildIterator it;
+	for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
+		*it = repr[(*it)->getID()];
 
-	return true;
+	std::sort(getChildrenBegin(), getChildrenEnd(), lessID);
+	nChildren = std::unique(getChildrenBegin(), getChildrenEnd()) - getChildrenBegin();
 }
 
-void DTNode::compressNode()
+int DTNode::getTag()
 {
+	if (DT_NodeType::kDTLit == type)
+		return val;
+	if (DT_NodeType::kDTOr == type)
+		return (int) choiceVar;
+	return 0;
+}
 
+template <class Visitor>
+void DTNode::visitPostOrder(Visitor visit)
+{
 	if (checked)
 		return;
 	checked = true;
 
-	set<DTNode *>::iterator it;
-	set<DTNode *>::iterator it2;
-	bool found = false;
-	bool allTrue, allFalse;
+	// every entry is a node and the index of its next child to visit
+	vector<std::pair<DTNode *, unsigned int> > stack;
+	stack.push_back(std::make_pair(this, 0u));
 
-	switch (type)
+	while (!stack.empty())
 	{
-	case DT_NodeType::kDTAnd:
-		// First we recurse
-		for (it = children.begin(); it != children.end(); it++)
-		{
-			(*it)->compressNode();
-		}
+		DTNode *node = stack.back().first;
 
-		// Next we collapse if all the children are True
-		allTrue = true;
-		for (it = children.begin(); it != children.end(); it++)
-		{
-			if (!((*it)->isTop()))
-				allTrue = false;
-		}
-		if (allTrue)
+		if (stack.back().second < node->nChildren)
 		{
-			// Remove the children
-			for (it = children.begin(); it != children.end(); it++)
+			DTNode *child = node->childArray()[stack.back().second++];
+			if (!child->checked)
 			{
-				(*it)->parentDeleted(this);
-
-				if ((0 == (*it)->numParents()) && ((*it)->getType() != DT_NodeType::kDTLit))
-					delete *it;
-
+				child->checked = true;
+				stack.push_back(std::make_pair(child, 0u));
 			}
-			children.clear();
-			type = DT_NodeType::kDTTop;
-			return;
 		}
-
-		// Next collapse if the child has only one child itself
-		found = true;
-		while (found)
+		else
 		{
-			found = false;
-			for (it = children.begin(); it != children.end() && !found; it++)
-			{
-				if (1 == (*it)->numChildren())
-				{
-					DTNode * oldNode = (*it);
+			stack.pop_back();
+			visit(node);
+		}
+	}
+}
 
-					childDeleted(oldNode);
-					oldNode->parentDeleted(this);
+void DTNode::compressNode()
+{
+	// Children come first, so every node sees the final state of its
+	//  children and grandchildren
+	vector<DTNode *> kids, stack;
+	vector<int> lits;
+	visitPostOrder([&](DTNode *node) { node->compressLocal(kids, stack, lits); });
+}
 
-					addChild(oldNode->onlyChild(), true);
+void DTNode::compressLocal(vector<DTNode *> &kids, vector<DTNode *> &stack,
+		vector<int> &lits)
+{
+	if ((DT_NodeType::kDTAnd != type) && (DT_NodeType::kDTOr != type))
+		return;
 
-					// Get rid of the oldNode if this was the only parent
-					if ((0 == oldNode->numParents()) && (oldNode->getType()
-                                                         != DT_NodeType::kDTLit))
-						delete oldNode;
-                    found = true;
-                    break; // Note: required to prevent segfault (mac OS)
-				}
-			}
-		}
+	// True is neutral below an AND node and False decides it, the other
+	//  way around below an OR node
+	bool isAnd = (DT_NodeType::kDTAnd == type);
+	DT_NodeType neutral = isAnd ? DT_NodeType::kDTTop : DT_NodeType::kDTBottom;
+	DT_NodeType decisive = isAnd ? DT_NodeType::kDTBottom : DT_NodeType::kDTTop;
 
-		// Now we check if a False child exists (which falsifies this node)
-		for (it = children.begin(); it != children.end(); it++)
-		{
-			if (DT_NodeType::kDTBottom == (*it)->getType())
-			{
-				// Remove the children
-				for (it2 = children.begin(); it2 != children.end(); it2++)
-				{
-					(*it2)->parentDeleted(this);
+	ChildIterator it;
 
-					if ((0 == (*it2)->numParents()) && ((*it2)->getType()
-                                                        != DT_NodeType::kDTLit))
-						delete *it2;
+	// First we collapse if all the children are neutral, most nodes have
+	//  no child any of the rules below applies to and are left alone
+	bool allNeutral = true;
+	bool unchanged = true;
+	for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
+	{
+		DT_NodeType childType = (*it)->getType();
+		if (neutral != childType)
+			allNeutral = false;
+
+		if ((1 == (*it)->numChildren()) || (neutral == childType)
+				|| (decisive == childType) || (type == childType)
+				|| ((0 == (*it)->numChildren()) && ((DT_NodeType::kDTAnd
+						== childType) || (DT_NodeType::kDTOr == childType))))
+			unchanged = false;
+	}
+	if (allNeutral)
+	{
+		clearChildren();
+		type = neutral;
+		return;
+	}
 
-				}
-				children.clear();
-				type = DT_NodeType::kDTBottom;
-				return;
-			}
-		}
+	if (!unchanged)
+		rebuildChildren(neutral, decisive, kids, stack);
 
-		// Get rid of empty OR and AND children
-		found = true;
-		while (found)
-		{
-			found = false;
-			for (it = children.begin(); it != children.end() && !found; it++)
-			{
-				if (0 == (*it)->numChildren())
-				{
-					if ((DT_NodeType::kDTAnd == (*it)->getType()) || (DT_NodeType::kDTOr
-                                                                      == (*it)->getType()))
-					{
-						DTNode * oldNode = (*it);
-						oldNode->parentDeleted(this);
-						childDeleted(oldNode);
-
-						if ((0 == oldNode->numParents()) && (oldNode->getType()
-                                                           != DT_NodeType::kDTLit))
-							delete oldNode;
-                        found = true;
-                        break; // Note: required to prevent segfault (mac OS)
-					}
-				}
-			}
-		}
+	if (DT_NodeType::kDTOr != type)
+		return;
+
+	// Finally, revert to true if two children are opposite literals
+	lits.clear();
+	for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
+	{
+		if (DT_NodeType::kDTLit == (*it)->getType())
+			lits.push_back((*it)->getVal());
+	}
+	if (lits.size() < 2)
+		return;
 
-		// Get rid of the True children
-		found = true;
-		while (found)
+	std::sort(lits.begin(), lits.end(), lessVar);
+	for (size_t i = 1; i < lits.size(); i++)
+	{
+		if (lits[i - 1] == -1 * lits[i])
 		{
-			found = false;
-			for (it = children.begin(); it != children.end() && !found; it++)
-			{
-				if (DT_NodeType::kDTTop == (*it)->getType())
-				{
-					DTNode * oldNode = (*it);
-					oldNode->parentDeleted(this);
-					childDeleted(oldNode);
-
-					if ((0 == oldNode->numParents()) && (oldNode->getType()
-                                                       != DT_NodeType::kDTLit))
-						delete oldNode;
-                    found = true;
-                    break; // Note: required to prevent segfault (mac OS)
-				}
-			}
+			topIfy();
+			return;
 		}
+	}
+}
 
-		// Finally check for 'AND' children (we want the final graph to be an AND-OR tree)
-		found = true;
-		while (found)
-		{
-			found = false;
-			for (it = children.begin(); it != children.end() && !found; it++)
-			{
-				if (DT_NodeType::kDTAnd == (*it)->getType())
-				{
+void DTNode::rebuildChildren(DT_NodeType neutral, DT_NodeType decisive,
+		vector<DTNode *> &kids, vector<DTNode *> &stack)
+{
+	ChildIterator it;
 
-					DTNode * oldNode = (*it);
-					oldNode->parentDeleted(this);
-					childDeleted(oldNode);
-
-					// Add links from the current node to the grandchildren
-					for (it2 = oldNode->getChildrenBegin(); it2
-							!= oldNode->getChildrenEnd(); it2++)
-					{
-						if (!(*it2)->isValid())
-						{
-							toSTDOUT("Error: Found bad and grandchild!!" << endl);
-						}
-
-						addChild(*it2, true);
-					}
-
-					// Remove oldNode if it no longer has a parent
-					if ((0 == oldNode->numParents()) && (oldNode->getType()
-                                                         != DT_NodeType::kDTLit))
-						delete oldNode;
-
-					// Mark as found
-					found = true;
-                    break; // Note: required to prevent segfault (mac OS)
-				}
-			}
-		}
-		break;
-	case DT_NodeType::kDTOr:
+	// Next replace a child that has only one child itself by that child
+	kids.clear();
+	for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
+	{
+		DTNode *child = *it;
+		while (1 == child->numChildren())
+			child = child->onlyChild();
 
-		// First we recurse
-		for (it = children.begin(); it != children.end(); it++)
+		if (!child->marked)
 		{
-			(*it)->compressNode();
+			child->marked = true;
+			kids.push_back(child);
 		}
+	}
+	for (size_t i = 0; i < kids.size(); i++)
+		kids[i]->marked = false;
 
-		// Next we collapse if all the children are False
-		allFalse = true;
-		for (it = children.begin(); it != children.end(); it++)
-		{
-			if (!((*it)->isBottom()))
-				allFalse = false;
-		}
-		if (allFalse)
+	// Now we check if a decisive child exists
+	for (size_t i = 0; i < kids.size(); i++)
+	{
+		if (decisive == kids[i]->getType())
 		{
-			// Remove the children
-			for (it = children.begin(); it != children.end(); it++)
-			{
-				(*it)->parentDeleted(this);
-				if ((0 == (*it)->numParents()) && ((*it)->getType() != DT_NodeType::kDTLit))
-					delete *it;
-			}
-			children.clear();
-			type = DT_NodeType::kDTBottom;
+			clearChildren();
+			type = decisive;
 			return;
 		}
+	}
 
-		// Next collapse if the child has only one child
-		found = true;
-		while (found)
-		{
-			found = false;
-			for (it = children.begin(); it != children.end() && !found; it++)
-			{
-				if (1 == (*it)->numChildren())
-				{
-					DTNode * oldNode = (*it);
-
-					childDeleted(oldNode);
-					oldNode->parentDeleted(this);
+	// Rebuild the children in one sweep: drop the empty OR and AND children
+	//  and the neutral ones, and replace a child of the same type by its
+	//  children (we want the final graph to be an AND-OR tree)
+	clearChildren();
+	for (size_t i = 0; i < kids.size(); i++)
+	{
+		DTNode *child = kids[i];
 
-					addChild(oldNode->onlyChild(), true);
+		if ((0 == child->numChildren()) && ((DT_NodeType::kDTAnd
+				== child->getType()) || (DT_NodeType::kDTOr == child->getType())))
+			continue;
 
-					// Get rid of the oldNode if this was the only parent
-					if ((0 == oldNode->numParents()) && (oldNode->getType()
-                                                         != DT_NodeType::kDTLit))
-                        delete oldNode;
-                    found = true;
-                    break; // Note: required to prevent segfault (mac OS)
-				}
-			}
-		}
+		if (neutral == child->getType())
+			continue;
 
-		// Now we check if a True child exists (which trivializes this node)
-		for (it = children.begin(); it != children.end(); it++)
+		if (type != child->getType())
 		{
-			if (DT_NodeType::kDTTop == (*it)->getType())
-			{
-				// Remove the children
-				for (it2 = children.begin(); it2 != children.end(); it2++)
-				{
-					(*it2)->parentDeleted(this);
-					if ((0 == (*it2)->numParents()) && ((*it2)->getType()
-                                                        != DT_NodeType::kDTLit))
-						delete *it2;
-				}
-				children.clear();
-				type = DT_NodeType::kDTTop;
-				return;
-			}
+			pushUnmarked(child);
+			continue;
 		}
 
-		// Get rid of empty OR and AND children
-		found = true;
-		while (found)
+		stack.assign(child->getChildrenBegin(), child->getChildrenEnd());
+		while (!stack.empty())
 		{
-			found = false;
-			for (it = children.begin(); it != children.end() && !found; it++)
-			{
-				if (0 == (*it)->numChildren())
-				{
-					if ((DT_NodeType::kDTAnd == (*it)->getType()) || (DT_NodeType::kDTOr
-                                                                      == (*it)->getType()))
-					{
-						DTNode * oldNode = (*it);
-						oldNode->parentDeleted(this);
-						childDeleted(oldNode);
-
-						if ((0 == oldNode->numParents()) && (oldNode->getType()
-                                                           != DT_NodeType::kDTLit))
-							delete oldNode;
-                        found = true;
-                        break; // Note: required to prevent segfault (mac OS)
-					}
-				}
-			}
-		}
+			DTNode *grandChild = stack.back();
+			stack.pop_back();
 
-		// Get rid of the False children
-		found = true;
-		while (found)
-		{
-			found = false;
-			for (it = children.begin(); it != children.end() && !found; it++)
+			if (!grandChild->isValid())
 			{
-				if (DT_NodeType::kDTBottom == (*it)->getType())
-				{
-					DTNode * oldNode = (*it);
-					oldNode->parentDeleted(this);
-					childDeleted(oldNode);
-
-					if ((0 == oldNode->numParents()) && (oldNode->getType()
-                                                       != DT_NodeType::kDTLit))
-						delete oldNode;
-                    found = true;
-                    break; // Note: required to prevent segfault (mac OS)
-				}
+				toSTDOUT("Error: Found bad "
+						<< ((DT_NodeType::kDTAnd == type) ? "and" : "or")
+						<< " grandchild!!" << endl);
 			}
-		}
 
-		// Check for 'OR' children (we want the final graph to be an AND-OR tree)
-		found = true;
-		while (found)
-		{
-			found = false;
-			for (it = children.begin(); it != children.end() && !found; it++)
-			{
-				if (DT_NodeType::kDTOr == (*it)->getType())
-				{
-					DTNode * oldNode = (*it);
-					oldNode->parentDeleted(this);
-					childDeleted(oldNode);
-
-					// Add links from the current node to the grandchildren
-					for (it2 = oldNode->getChildrenBegin(); it2
-							!= oldNode->getChildrenEnd(); it2++)
-					{
-						if (!(*it2)->isValid())
-						{
-							toSTDOUT("Error: Found bad or grandchild!!" << endl);
-						}
-
-						addChild(*it2, true);
-					}
-
-					// Remove oldNode if it no longer has a parent
-					if ((0 == oldNode->numParents()) && (oldNode->getType()
-                                                         != DT_NodeType::kDTLit))
-						delete oldNode;
-
-					// Mark as found
-					found = true;
-                    break; // Note: required to prevent segfault (mac OS)
-				}
-			}
+			if (type == grandChild->getType())
+				stack.insert(stack.end(), grandChild->getChildrenBegin(),
+						grandChild->getChildrenEnd());
+			else
+				pushUnmarked(grandChild);
 		}
-		
-		// Finally, revert to true if two children are opposite literals
-		{
-			set<int> litChildren;
-			found = false;
-			for (it = children.begin(); it != children.end(); it++) {
-				if (DT_NodeType::kDTLit == (*it)->getType()) {
-					if (litChildren.find(-1 * (*it)->getVal()) != litChildren.end())
-						found = true;
-					litChildren.insert((*it)->getVal());
-				}
-			}
-			if (found) {
-				topIfy();
-			}
-		}
-		break;
-		/* Leaf node */
-	case DT_NodeType::kDTBottom:
-	case DT_NodeType::kDTTop:
-	case DT_NodeType::kDTLit:
-	default:
-		return;
 	}
+	for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
+		(*it)->marked = false;
 }
 
 int DTNode::count(bool isRoot)
 {
 	if (checked)
 		return 1;
-	checked = true;
 
-	set<DTNode *>::iterator it;
+	// Every edge counts once, edges to literal nodes of the same literal
+	//  count as one
 	int sum = isRoot ? 0 : 1;
-	set<int> childrenSeen;
-	set<int> litsSeen;
+	vector<int> lits;
 
-	// First we recurse
-	for (it = children.begin(); it != children.end(); it++)
-	{
-		if (DT_NodeType::kDTLit == (*it)->getType())
+	visitPostOrder([&](DTNode *node) {
+		ChildIterator it;
+		lits.clear();
+		for (it = node->getChildrenBegin(); it != node->getChildrenEnd(); it++)
 		{
-			int lit_num = (*it)->getVal();
-			if (litsSeen.find(lit_num) == litsSeen.end())
-			{
-				litsSeen.insert(lit_num);
-				sum += 1;
-			}
-
+			if (DT_NodeType::kDTLit == (*it)->getType())
+				lits.push_back((*it)->getVal());
+			else
+				sum++;
 		}
-		else
-		{
-			int node_id = (*it)->getID();
-			if (childrenSeen.find(node_id) == childrenSeen.end())
-			{
-				childrenSeen.insert(node_id);
-				sum += (*it)->count(false);
-			}
-		}
-	}
+
+		std::sort(lits.begin(), lits.end());
+		sum += std::unique(lits.begin(), lits.end()) - lits.begin();
+	});
 
 	return sum;
 }
@@ -592,37 +433,38 @@ void DTNode::uncheck(int unID)
 	if (uncheckID == unID)
 		return;
 
-	set<DTNode *>::iterator it;
 	checked = false;
 	uncheckID = unID;
 
-	// Recurse
-	for (it = children.begin(); it != children.end(); it++)
+	// every entry is a node and the index of its next child to visit
+	vector<std::pair<DTNode *, unsigned int> > stack;
+	stack.push_back(std::make_pair(this, 0u));
+
+	while (!stack.empty())
 	{
-		(*it)->uncheck(unID);
+		DTNode *node = stack.back().first;
+
+		if (stack.back().second < node->nChildren)
+		{
+			DTNode *child = node->childArray()[stack.back().second++];
+			if (child->uncheckID != unID)
+			{
+				child->checked = false;
+				child->uncheckID = unID;
+				stack.push_back(std::make_pair(child, 0u));
+			}
+		}
+		else
+			stack.pop_back();
 	}
 }
 
 bool DTNode::validate()
 {
-	set<DTNode *>::iterator it;
-
-	for (it = parents.begin(); it != parents.end(); it++)
-	{
-		if (!(*it)->isValid())
-		{
-			toSTDOUT("Error: Node has invalid parent." << endl);
-			return false;
-		}
-		if (!(*it)->hasChild(this))
-		{
-			toSTDOUT("Error: Node's parent doesn't have child." << endl);
-			return false;
-		}
-	}
+	ChildIterator it;
 
 	// Recurse
-	for (it = children.begin(); it != children.end(); it++)
+	for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
 	{
 		if (!(*it)->isValid())
 		{
@@ -643,15 +485,9 @@ bool DTNode::validate()
 //        and the first child is the literal.
 void DTNode::reset()
 {
-	set<DTNode *>::iterator it;
-
-	for (it = children.begin(); it != children.end(); it++)
-		(*it)->parentDeleted(this);
-
-	children.erase(children.begin(), children.end());
-
 	// Save the first node
-	addChild(firstNode, true);
+	if (nChildren > 1)
+		nChildren = 1;
 }
 
 // Printout
@@ -665,8 +501,8 @@ void DTNode::print(int depth)
 
 	if (depth != 0)
 	{
-		set<DTNode *>::iterator it;
-		for (it = children.begin(); it != children.end(); it++)
+		ChildIterator it;
+		for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
 		{
 			(*it)->print(depth - 1);
 		}
@@ -674,64 +510,159 @@ void DTNode::print(int depth)
 	toSTDOUT(")");
 }
 
-// Prep the nnf format
-void DTNode::prepNNF(vector<DTNode*> * nodeList)
+template <class Skip, class Visitor>
+void DTNode::visitNNFOrder(Skip skip, Visitor visit)
 {
-	if (nnfID != -1)
-		return;
+	// every entry is a node and the index of its next child to visit
+	vector<std::pair<DTNode *, unsigned int> > stack;
+	stack.push_back(std::make_pair(this, 0u));
 
-	if (((DT_NodeType::kDTTop == type) || (DT_NodeType::kDTBottom == type)) && !(CSolverConf::smoothNNF))
+	while (!stack.empty())
 	{
-		toSTDOUT("Error: type of DTNode is either top or bottom." << endl);
-		return;
-	}
+		DTNode *node = stack.back().first;
 
-	if (DT_NodeType::kDTLit != type)
-	{
-		set<DTNode *>::iterator it;
-		for (it = children.begin(); it != children.end(); it++)
+		if ((0 == stack.back().second) && skip(node))
 		{
-			(*it)->prepNNF(nodeList);
+			stack.pop_back();
+			continue;
 		}
-	}
 
-	// Add / id this DT node
-	nnfID = nodeList->size();
-	nodeList->push_back(this);
+		if ((DT_NodeType::kDTLit != node->type) && (stack.back().second
+				< node->nChildren))
+		{
+			DTNode *child = node->childArray()[stack.back().second++];
+			stack.push_back(std::make_pair(child, 0u));
+			continue;
+		}
+
+		stack.pop_back();
+		visit(node);
+	}
 }
 
+// Prep the nnf format, every node is numbered after its children
+unsigned int DTNode::numberNNF()
+{
+	unsigned int nNodes = 0;
+
+	visitNNFOrder([](DTNode *node) {
+		if (node->nnfID != -1)
+			return true;
+
+		if (((DT_NodeType::kDTTop == node->type) || (DT_NodeType::kDTBottom
+				== node->type)) && !(theConf().smoothNNF))
+		{
+			toSTDOUT("Error: type of DTNode is either top or bottom." << endl);
+			return true;
+		}
+		return false;
+	}, [&nNodes](DTNode *node) {
+		node->nnfID = nNodes++;
+	});
+
+	return nNodes;
+}
 
 // Output the nnf format
-void DTNode::genNNF(ostream & out)
+template <class Output>
+void DTNode::writeNNFNodes(Output & out)
 {
+	// the walk of numberNNF again, a node with a number below the next one
+	//  to write is done already
+	int nextID = 0;
+
+	visitNNFOrder([&nextID](DTNode *node) {
+		return (-1 == node->nnfID) || (node->nnfID < nextID);
+	}, [&](DTNode *node) {
+		node->genNNF(out);
+		nextID++;
+	});
+}
+
+void DTNode::writeNNF(COutputFile & out)
+{
+	writeNNFNodes(out);
+}
+
+void DTNode::writeNNF(CNNFBinWriter & out)
+{
+	writeNNFNodes(out);
+}
+
+void DTNode::genNNF(COutputFile & out)
+{
+	ChildIterator it;
+
 	if (DT_NodeType::kDTLit == type)
-		out << "L " << val << endl;
+	{
+		out.put("L ");
+		out.putInt(val);
+		out.put('\n');
+	}
 	else if (DT_NodeType::kDTTop == type)
-		out << "A 0" << endl;
+		out.put("A 0\n");
 	else if (DT_NodeType::kDTBottom == type)
-		out << "O 0 0" << endl;
+		out.put("O 0 0\n");
 	else if (DT_NodeType::kDTAnd == type)
 	{
-		out << "A " << children.size();
+		out.put("A ");
+		out.putUInt(nChildren);
 
-		set<DTNode *>::iterator it;
-		for (it = children.begin(); it != children.end(); it++)
-			out << " " << (*it)->nnfID;
+		for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
+		{
+			out.put(' ');
+			out.putInt((*it)->nnfID);
+		}
 
-		out << endl;
+		out.put('\n');
 	}
 	else if (DT_NodeType::kDTOr == type)
 	{
-		out << "O " << choiceVar << " " << children.size();
+		out.put("O ");
+		out.putUInt(choiceVar);
+		out.put(' ');
+		out.putUInt(nChildren);
 
-		if (2 != children.size())
-			toSTDOUT("Error: Or node with " << children.size() << " children.");
+		if (2 != nChildren)
+			toSTDOUT("Error: Or node with " << nChildren << " children.");
 
-		set<DTNode *>::iterator it;
-		for (it = children.begin(); it != children.end(); it++)
-			out << " " << (*it)->nnfID;
+		for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
+		{
+			out.put(' ');
+			out.putInt((*it)->nnfID);
+		}
 
-		out << endl;
+		out.put('\n');
+	}
+}
+
+void DTNode::genNNF(CNNFBinWriter & out)
+{
+	ChildIterator it;
+
+	if (DT_NodeType::kDTLit == type)
+	{
+		out.addLit(val);
+		return;
+	}
+
+	// True and False are written like in the text format
+	if ((DT_NodeType::kDTAnd == type) || (DT_NodeType::kDTTop == type))
+		out.beginAnd((DT_NodeType::kDTTop == type) ? 0 : nChildren);
+	else if (DT_NodeType::kDTBottom == type)
+		out.beginOr(0, 0);
+	else if (DT_NodeType::kDTOr == type)
+	{
+		out.beginOr(choiceVar, nChildren);
+
+		if (2 != nChildren)
+			toSTDOUT("Error: Or node with " << nChildren << " children.");
+	}
+
+	if ((DT_NodeType::kDTAnd == type) || (DT_NodeType::kDTOr == type))
+	{
+		for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
+			out.addChild((*it)->nnfID);
 	}
 }
 
@@ -744,8 +675,8 @@ bool DTNode::checkCycle(int sourceID, bool first)
 		return true;
 	}
 
-	set<DTNode *>::iterator it;
-	for (it = children.begin(); it != children.end(); it++)
+	ChildIterator it;
+	for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
 	{
 		if ((*it)->checkCycle(sourceID, false)) {
 			toSTDOUT(" " << getID());
@@ -762,84 +693,220 @@ bool DTNode::checkCycle(int sourceID, bool first)
  * Modified: Christian Muise         *
  *************************************/
 
-void DTNode::smooth(int &num_nodes, CMainSolver &solver, set<int> &literals)
+void DTNode::smooth(CDTNodeArena &arena, CMainSolver &solver,
+		vector<vector<int> > &nodeVars, set<int> &literals)
+{
+	// The nodes added below get no variables, only the parents of the node
+	//  they are added to look at what lies below it
+	if (nodeVars.size() < arena.countNodes())
+		nodeVars.resize(arena.countNodes());
+
+	// Checked means that it is already smoothed, the others are smoothed
+	//  after their children
+	vector<int> variables, merged;
+	visitPostOrder([&](DTNode *node) {
+		node->smoothLocal(arena, solver, nodeVars, literals, variables, merged);
+	});
+}
+
+void DTNode::smoothLocal(CDTNodeArena &arena, CMainSolver &solver,
+		vector<vector<int> > &nodeVars, set<int> &literals,
+		vector<int> &variables, vector<int> &merged)
 {
-	// Checked means that it is already smoothed
-	if (checked)
-		return;
-	checked = true;
 	variables.clear();
 
 	// If this is a literal, we just add the variable
 	if (DT_NodeType::kDTLit == type) {
 		int var = (val < 0) ? -1 * val : val;
-		variables.insert(var);
+		variables.push_back(var);
 		literals.insert(val);
+		nodeVars[id].swap(variables);
 		return;
 	}
 
-	// First we recurse and record the variables below
-	set<DTNode *>::iterator it;
-	for (it = children.begin(); it != children.end(); it++)
+	// Record the variables below, the children are smoothed already
+	ChildIterator it;
+	for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
 	{
-		(*it)->smooth(num_nodes, solver, literals);
-		variables.insert((*it)->getVariablesBegin(), (*it)->getVariablesEnd());
+		const vector<int> &childVars = nodeVars[(*it)->getID()];
+		merged.clear();
+		std::set_union(variables.begin(), variables.end(), childVars.begin(),
+				childVars.end(), std::back_inserter(merged));
+		variables.swap(merged);
 	}
 
 	// If this is an AND node, there's nothing to do
 	if (DT_NodeType::kDTAnd == type)
+	{
+		nodeVars[id].swap(variables);
 		return;
+	}
 
-	set<DTNode *> toAdd;
-	set<DTNode *> toRemove;
+	vector<DTNode *> toAdd;
+	vector<DTNode *> toRemove;
 	
 	// We must make sure that every child has all of the variables (smoothness)
-	for (it = children.begin(); it != children.end(); it++)
+	for (it = getChildrenBegin(); it != getChildrenEnd(); it++)
 	{
 		// If the counts are the same, then it is already smooth
-		if (variables.size() != (*it)->numVariables()) {
+		if (variables.size() != nodeVars[(*it)->getID()].size()) {
 			// Create the new AND child
-			DTNode* newAnd = new DTNode(DT_NodeType::kDTAnd, num_nodes++);
+			DTNode* newAnd = arena.newNode(DT_NodeType::kDTAnd);
 
-			(*it)->parentDeleted(this);
-			
-			toAdd.insert(newAnd);
-			toRemove.insert(*it);
+			toAdd.push_back(newAnd);
+			toRemove.push_back(*it);
 			
-			newAnd->addChild(*it, true);
+			newAnd->addChild(*it);
 			
 			// Add all of the missing variables
-			set<int>::iterator var_it;
+			vector<int>::iterator var_it;
 			for (var_it = variables.begin(); var_it != variables.end(); var_it++)
 			{
 				int var = *var_it;
-				if (!((*it)->hasVariable(var)))
+				const vector<int> &childVars = nodeVars[(*it)->getID()];
+				if (!std::binary_search(childVars.begin(), childVars.end(), var))
 				{
-					DTNode* newOr = new DTNode(DT_NodeType::kDTOr, num_nodes++);
-					newAnd->addChild(newOr, true);
-					newOr->addChild(solver.get_lit_node_full(var), true);
-					newOr->addChild(solver.get_lit_node_full(-1 * var), true);
+					DTNode* newOr = arena.newNode(DT_NodeType::kDTOr);
+					newAnd->addChild(newOr);
+					newOr->addChild(solver.get_lit_node_full(var));
+					newOr->addChild(solver.get_lit_node_full(-1 * var));
 					newOr->choiceVar = (unsigned) var;
+
+					literals.insert(var);
+					literals.insert(-1 * var);
 				}
 			}
-			// Record the new values
-			newAnd->smooth(num_nodes, solver, literals);
 		}
 	}
 	
-	for (it = toRemove.begin(); it != toRemove.end(); it++)
-		childDeleted(*it);
-	
-	for (it = toAdd.begin(); it != toAdd.end(); it++)
-		addChild(*it, true);
+	vector<DTNode *>::iterator nt;
+	for (nt = toRemove.begin(); nt != toRemove.end(); nt++)
+		childDeleted(*nt);
 	
-	return;
+	for (nt = toAdd.begin(); nt != toAdd.end(); nt++)
+		addChild(*nt);
+
+	nodeVars[id].swap(variables);
+}
+
+
+////////////////////
+// CDTUniqueTable //
+////////////////////
+CompHashT CDTUniqueTable::hashOf(DTNode *node)
+{
+	CompHashT h = compHashStep(compHashStep(0, node->getType()), node->getTag());
+
+	DTNode::ChildIterator it;
+	for (it = node->getChildrenBegin(); it != node->getChildrenEnd(); it++)
+		h = compHashStep(h, (*it)->getID());
+
+	return h ^ (h >> 32);
+}
+
+bool CDTUniqueTable::equal(DTNode *a, DTNode *b)
+{
+	return a->getType() == b->getType() && a->getTag() == b->getTag()
+			&& a->numChildren() == b->numChildren()
+			&& std::equal(a->getChildrenBegin(), a->getChildrenEnd(),
+					b->getChildrenBegin());
+}
+
+void CDTUniqueTable::init(unsigned int nNodes)
+{
+	// at most half full
+	size_t nSlots = 16;
+	while (nSlots < 2 * (size_t) nNodes)
+		nSlots <<= 1;
+
+	theSlots.assign(nSlots, NULL);
 }
 
-void DTNode::sub_parents(DTNode *newChild) {
-	for (set<DTNode *>::iterator it = parents.begin(); it != parents.end(); it++) {
-		(*it)->childDeleted(this);
-		(*it)->addChild(newChild, true);
+DTNode * CDTUniqueTable::unique(DTNode *node)
+{
+	size_t mask = theSlots.size() - 1;
+
+	for (size_t i = hashOf(node) & mask;; i = (i + 1) & mask)
+	{
+		if (theSlots[i] == NULL)
+		{
+			theSlots[i] = node;
+			return node;
+		}
+		if (equal(theSlots[i], node))
+			return theSlots[i];
 	}
-	parents.clear();
+}
+
+//////////////////
+// CDTNodeArena //
+//////////////////
+size_t CDTNodeArena::memoryUsage()
+{
+	size_t mem = theChunks.size() * CHUNK_SIZE * sizeof(DTNode)
+			+ theChunks.capacity() * sizeof(DTNode *);
+
+	for (unsigned int i = 0; i < iNodes; i++)
+		mem += node(i)->childMemory();
+
+	return mem;
+}
+
+DTNode * CDTNodeArena::copyGraph(CDTNodeArena &from, DTNode *root)
+{
+	if (!from.owns(root))
+		return root;
+
+	vector<DTNode *> copies(from.countNodes(), NULL);
+	vector<DTNode *> stack(1, root);
+
+	// every node is copied after its children
+	while (!stack.empty())
+	{
+		DTNode *n = stack.back();
+
+		if (copies[n->id] != NULL)
+		{
+			stack.pop_back();
+			continue;
+		}
+
+		bool ready = true;
+		for (DTNode::ChildIterator it = n->getChildrenBegin(); it
+				!= n->getChildrenEnd(); it++)
+			if (from.owns(*it) && copies[(*it)->id] == NULL)
+			{
+				stack.push_back(*it);
+				ready = false;
+			}
+		if (!ready)
+			continue;
+
+		stack.pop_back();
+
+		DTNode *copy = (DT_NodeType::kDTLit == n->type) ? newLit(n->val)
+				: newNode(n->type);
+		copy->val = n->val;
+		copy->choiceVar = n->choiceVar;
+
+		for (DTNode::ChildIterator it = n->getChildrenBegin(); it
+				!= n->getChildrenEnd(); it++)
+			copy->pushChild(from.owns(*it) ? copies[(*it)->id] : *it);
+
+		copies[n->id] = copy;
+	}
+
+	return copies[root->id];
+}
+
+void CDTNodeArena::clear()
+{
+	for (unsigned int i = 0; i < iNodes; i++)
+		node(i)->~DTNode();
+
+	for (unsigned int c = 0; c < theChunks.size(); c++)
+		::operator delete(theChunks[c]);
+
+	theChunks.clear();
+	iNodes = 0;
 }
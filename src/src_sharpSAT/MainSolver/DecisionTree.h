@@ -25,104 +25,144 @@
 #include <set>
 #include <vector>
 #include <algorithm>
+#include <iterator>
 #include <iostream>
+#include <new>
 
 #include <SomeTime.h>
+#include <OutputFile.h>
+#include <NNFBinFile.h>
 #include "InstanceGraph/InstanceGraph.h"
 #include "InstanceGraph/ComponentTypes.h"
 
 #include "../Basics.h"
+#include "../SolverContext.h"
 
 using std::set;
 using std::ostream;
 
 class CMainSolver;
+class CDTNodeArena;
 
+/** A node of the d-DNNF.
+ *
+ *  Nodes live in a CDTNodeArena and are identified by their 32-bit index
+ *  there. Only the child edges are stored, at most INLINE_CHILDREN of them
+ *  inside the node itself, so the common decision and AND nodes need no
+ *  further allocation. Nodes are never freed one by one: a node that drops
+ *  out of the graph stays in the arena until the whole d-DNNF is released.
+ */
 class DTNode
 {
-	DT_NodeType type;
-	set<DTNode *> children;
-	set<DTNode *> parents;
-	set<int> variables;
+public:
 
-	int val;
-	int id;
-	int uncheckID;
+	typedef DTNode ** ChildIterator;
 
-public:
+private:
 
-	unsigned choiceVar;
-	int nnfID;
+	static const unsigned int INLINE_CHILDREN = 2;
 
-	bool checked;
+	union
+	{
+		DTNode * inlineChildren[INLINE_CHILDREN];
+		DTNode ** heapChildren;
+	};
+	unsigned int nChildren;
+	unsigned int capChildren;
 
-	DTNode * firstNode; // These are used to keep track of the children
-	DTNode * secondNode;//  in the case of OR nodes (decision points).
+	DT_NodeType type;
+	int val;
+	unsigned int id;
+	int uncheckID;
+
+	// scratch flag of compressNode, false outside of it
+	bool marked;
+
+	DTNode ** childArray()
+	{
+		return (capChildren > INLINE_CHILDREN) ? heapChildren : inlineChildren;
+	}
 
 	// Constructor mainly for leaf nodes
-	DTNode(int literal, bool lit_constructor, int CURRENT_ID) :
-            type(DT_NodeType::kDTLit), val(literal), firstNode(NULL), secondNode(NULL)
+	DTNode(int literal, unsigned int arenaID) :
+		nChildren(0), capChildren(INLINE_CHILDREN), type(DT_NodeType::kDTLit),
+		val(literal), id(arenaID), uncheckID(0), marked(false), choiceVar(0),
+		nnfID(-1), checked(false)
 	{
-		id = CURRENT_ID;
-		nnfID = -1;
-		CSolverConf::nodeCount++;
-		uncheckID = 0;
-		
-		// Store the variable for this leaf node by default
-		variables.insert((literal < 0) ? -1 * literal : literal);
+		CSolverContext::current().nodeCount++;
 	}
 
-	DTNode(DT_NodeType newType, int CURRENT_ID) :
-		type(newType), firstNode(NULL), secondNode(NULL)
+	DTNode(DT_NodeType newType, unsigned int arenaID) :
+		nChildren(0), capChildren(INLINE_CHILDREN), type(newType), val(0),
+		id(arenaID), uncheckID(0), marked(false), choiceVar(0), nnfID(-1),
+		checked(false)
 	{
-		id = CURRENT_ID;
-		nnfID = -1;
-		CSolverConf::nodeCount++;
-		uncheckID = 0;
+		CSolverContext::current().nodeCount++;
 	}
 
-	// Default destructor
 	~DTNode()
 	{
-		for (set<DTNode *>::iterator it = parents.begin(); it != parents.end(); it++)
-		{
-			(*it)->childDeleted(this);
-		}
-
-		// We delete the children recursively
-		//  if they don't have another parent.
-		//  Obviously, if there are cycles in
-		//  the decision tree then bad things
-		//  will happen.
-		for (set<DTNode *>::iterator it = children.begin(); it
-				!= children.end(); it++)
-		{
-			(*it)->parentDeleted(this);
-
-			// Only delete the child if this was the only parent.
-			if (0 == (*it)->numParents())
-			{
-				// Protect against deleting a literal
-				if (DT_NodeType::kDTLit != (*it)->getType())
-					delete (*it);
-			}
-		}
-
-		children.clear();
-
-		CSolverConf::nodeCount--;
+		if (capChildren > INLINE_CHILDREN)
+			delete[] heapChildren;
+
+		CSolverContext::current().nodeCount--;
 	}
 
-	set<DTNode *>::iterator getChildrenBegin();
-	set<DTNode *>::iterator getChildrenEnd();
+	// nodes are only created and destroyed by the arena
+	DTNode(const DTNode &);
+	DTNode &operator=(const DTNode &);
+
+	friend class CDTNodeArena;
+
+	// Calls visit(node) for the unchecked nodes below this one (itself
+	//  included), every node after all of its children, and marks them checked
+	template <class Visitor>
+	void visitPostOrder(Visitor visit);
 
-	set<int>::iterator getVariablesBegin();
-	set<int>::iterator getVariablesEnd();
-	int numVariables();
-	bool hasVariable(int var);
+	// Depth first walk in the order of the nnf output. A node for which
+	//  skip(node) holds is not entered, visit(node) is called for the others
+	//  after their children.
+	template <class Skip, class Visitor>
+	void visitNNFOrder(Skip skip, Visitor visit);
+
+	// writes the numbered nodes in the order of their numbers
+	template <class Output>
+	void writeNNFNodes(Output & out);
+
+	// appends a child without looking for duplicates
+	void pushChild(DTNode * newChild);
+
+	// pushes newChild unless it is marked, and marks it
+	void pushUnmarked(DTNode * newChild);
+
+	// the rules of compressNode for this node alone, the children have to
+	//  be compressed already
+	void compressLocal(vector<DTNode *> &kids, vector<DTNode *> &stack,
+			vector<int> &lits);
+	void rebuildChildren(DT_NodeType neutral, DT_NodeType decisive,
+			vector<DTNode *> &kids, vector<DTNode *> &stack);
+
+	void smoothLocal(CDTNodeArena &arena, CMainSolver &solver,
+			vector<vector<int> > &nodeVars, set<int> &literals,
+			vector<int> &variables, vector<int> &merged);
+
+public:
+
+	unsigned choiceVar;
+	int nnfID;
+
+	bool checked;
+
+	ChildIterator getChildrenBegin();
+	ChildIterator getChildrenEnd();
 
 	DTNode * onlyChild();
 
+	// The children of a decision (OR) node: the branch on the decision
+	//  literal and the branch on its negation
+	DTNode * firstNode();
+	DTNode * secondNode();
+
 	DT_NodeType getType();
 	int getID();
 	int getVal();
@@ -136,17 +176,29 @@ public:
 	void topIfy();
 	void botIfy();
 
-	// Parent methods
-	void addParent(DTNode * newParent, bool link = false);
-	bool parentDeleted(DTNode *oldParent);
-	int numParents();
+	// Links this node as a child of newParent
+	void addParent(DTNode * newParent);
 
 	// Add a child
-	void addChild(DTNode * newChild, bool link = false);
+	void addChild(DTNode * newChild);
 	bool childDeleted(DTNode * oldChild);
+	void clearChildren();
 	int numChildren();
 	bool hasChild(DTNode * child);
-        
+
+	// heap memory of the child array, 0 while the children are inline
+	size_t childMemory();
+
+	// Replaces every child c by repr[c->getID()], then sorts the
+	//  children by id and drops duplicates
+	void mapChildren(const vector<DTNode *> &repr);
+
+	// the literal of a kDTLit node, the decision variable of a kDTOr node
+	int getTag();
+
+	// The passes over the whole d-DNNF below this node. They use an explicit
+	//  stack, so deep graphs can not overflow the call stack, and compressNode,
+	//  count and smooth expect the nodes to be unchecked.
 	void compressNode();
 	int count(bool isRoot);
 	void uncheck(int unID);
@@ -154,8 +206,14 @@ public:
 	void reset();
 	bool validate();
 
-	void prepNNF(vector<DTNode*> * nodeList);
-	void genNNF(ostream & out);
+	// Numbers the nodes for the nnf output, every node after its children,
+	//  and returns the number of nodes. writeNNF then streams the nodes in
+	//  the order of their numbers, without a list of all the nodes.
+	unsigned int numberNNF();
+	void writeNNF(COutputFile & out);
+	void writeNNF(CNNFBinWriter & out);
+	void genNNF(COutputFile & out);
+	void genNNF(CNNFBinWriter & out);
 
 	// Printout
 	void print(int depth = -1);
@@ -163,9 +221,105 @@ public:
 	// Sanity checks
 	bool checkCycle(int sourceID, bool first = true);
 
-	// Smoothing
-	void smooth(int &num_nodes, CMainSolver &solver, set<int> &literals);
-	void sub_parents(DTNode *newChild);
+	// Smoothing, nodeVars holds the sorted variables below each node (by id)
+	void smooth(CDTNodeArena &arena, CMainSolver &solver,
+			vector<vector<int> > &nodeVars, set<int> &literals);
+};
+
+/** Hash-consing table of d-DNNF nodes.
+ *
+ *  Two nodes are equal if they have the same type, tag and children. The
+ *  children of every node put into the table have to be sorted by id (see
+ *  DTNode::mapChildren) and must not change while the table is in use.
+ */
+class CDTUniqueTable
+{
+	vector<DTNode *> theSlots;
+
+	static CompHashT hashOf(DTNode *node);
+	static bool equal(DTNode *a, DTNode *b);
+
+public:
+
+	// room for nNodes distinct nodes
+	void init(unsigned int nNodes);
+
+	// returns the node in the table that equals node,
+	//  node itself (after inserting it) if there is none
+	DTNode * unique(DTNode *node);
+};
+
+/** Storage of all nodes of a d-DNNF.
+ *
+ *  The nodes are kept in chunks of CHUNK_SIZE, so a node never moves and
+ *  its id maps to its address with a shift and a mask.
+ */
+class CDTNodeArena
+{
+	static const unsigned int CHUNK_BITS = 12;
+	static const unsigned int CHUNK_SIZE = 1 << CHUNK_BITS;
+
+	vector<DTNode *> theChunks;
+	unsigned int iNodes;
+
+	DTNode * allocNode()
+	{
+		if ((iNodes & (CHUNK_SIZE - 1)) == 0)
+			theChunks.push_back((DTNode *) ::operator new(CHUNK_SIZE * sizeof(DTNode)));
+		return theChunks.back() + (iNodes & (CHUNK_SIZE - 1));
+	}
+
+	CDTNodeArena(const CDTNodeArena &);
+	CDTNodeArena &operator=(const CDTNodeArena &);
+
+public:
+
+	CDTNodeArena() : iNodes(0) {}
+
+	~CDTNodeArena()
+	{
+		clear();
+	}
+
+	DTNode * newNode(DT_NodeType type)
+	{
+		DTNode *node = new (allocNode()) DTNode(type, iNodes);
+		iNodes++;
+		return node;
+	}
+
+	DTNode * newLit(int literal)
+	{
+		DTNode *node = new (allocNode()) DTNode(literal, iNodes);
+		iNodes++;
+		return node;
+	}
+
+	DTNode * node(unsigned int id)
+	{
+		return theChunks[id >> CHUNK_BITS] + (id & (CHUNK_SIZE - 1));
+	}
+
+	unsigned int countNodes() const
+	{
+		return iNodes;
+	}
+
+	bool owns(DTNode *n)
+	{
+		return n->id < iNodes && node(n->id) == n;
+	}
+
+	// Copies the nodes below root (itself included) that live in the arena
+	//  from into this one and returns the copy of root. Children in other
+	//  arenas, like the shared literal nodes, are linked as they are.
+	DTNode * copyGraph(CDTNodeArena &from, DTNode *root);
+
+	// bytes held by the arena, including the spilled child arrays
+	size_t memoryUsage();
+
+	// destroys all nodes
+	void clear();
 };
 
 #endif
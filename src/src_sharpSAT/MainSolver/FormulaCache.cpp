@@ -1,5 +1,7 @@
 #include "FormulaCache.h"
 
+#include <algorithm>
+
 /**
  * Available memory in bytes.
  */
@@ -21,7 +23,7 @@ size_t availableMem() {
     {
         return vmstats.free_count * pgs;
     } else {
-        std::cout << "Failed to read free memory and page size, returning 100MB instead." << std::endl;
+        toSTDOUT("Failed to read free memory and page size, returning 100MB instead." << std::endl);
         return 100*1024*1024;
     }
 #elif _WIN32
@@ -44,24 +46,188 @@ size_t availableMem() {
 #endif
 }
 
-unsigned int CFormulaCache::oldestEntryAllowed = (unsigned int) -1;
+void CCacheShard::init()
+{
+    theEntryBase.clear();
+    theEntryBase.push_back(CCacheEntry()); // dummy Element
+    thePackedIds.clear();
+    iDeadPackedIds = 0;
+    theFreeEntries.clear();
+    theWeightedVals.clear();
+    theTable.assign((size_t) 1 << iTableBits, CCacheSlot());
+    iUsedSlots = 0;
+    iClockHand = 1;
+    bEvicting = false;
+    minScoreBound = 0;
+    memUsage = 0;
+    iLookups = 0;
+    iHits = 0;
+    iSumProbeLen = 0;
+    iMaxProbeLen = 0;
+    iHashCollisions = 0;
+    iEvictedEntries = 0;
+    iLockWaits = 0;
+    iSharedLookups = 0;
+    iSharedHits = 0;
+    iContended = 0;
+}
+
+void CCacheShard::insertSlot(CompHashT hashKey, CacheEntryId idx)
+{
+    CCacheSlot ins;
+    ins.hashKey = hashKey;
+    ins.id = idx;
+
+    for (unsigned int pos = homeSlot(hashKey); ; pos = nextSlot(pos), ins.dist++)
+    {
+        CCacheSlot &rSlot = theTable[pos];
+        if (rSlot.id == NIL_ENTRY)
+        {
+            rSlot = ins;
+            break;
+        }
+        // take the slot from an entry that is closer to its home
+        if (rSlot.dist < ins.dist) std::swap(rSlot, ins);
+    }
+    iUsedSlots++;
+}
+
+bool CCacheShard::removeSlot(CompHashT hashKey, CacheEntryId idx)
+{
+    unsigned int pos = homeSlot(hashKey);
+
+    for (unsigned int dist = 0; ; dist++, pos = nextSlot(pos))
+    {
+        if (theTable[pos].id == NIL_ENTRY || theTable[pos].dist < dist) return false;
+        if (theTable[pos].id == idx) break;
+    }
+
+    // backward shift: move the rest of the cluster one slot towards home
+    unsigned int next = nextSlot(pos);
+    while (theTable[next].id != NIL_ENTRY && theTable[next].dist > 0)
+    {
+        theTable[pos] = theTable[next];
+        theTable[pos].dist--;
+        pos = next;
+        next = nextSlot(next);
+    }
+    theTable[pos] = CCacheSlot();
+    iUsedSlots--;
+    return true;
+}
+
+void CCacheShard::rebuildTable(unsigned int bits)
+{
+    iTableBits = bits;
+    iTableMask = (1u << iTableBits) - 1;
+    theTable.assign((size_t) 1 << iTableBits, CCacheSlot());
+    iUsedSlots = 0;
 
+    for (CacheEntryId idx = 1; idx < theEntryBase.size(); idx++)
+    {
+        if (!theEntryBase[idx].empty()) insertSlot(theEntryBase[idx].getHashKey(), idx);
+    }
+}
 
-CFormulaCache::CFormulaCache()
+CacheEntryId CCacheShard::lookup(CComponentId &rComp, const CPackLayout &rL,
+                                 unsigned int &nProbes,
+                                 unsigned int &nCollisions)
 {
-    iBuckets = 900001;// =299999;
-    theData.resize(iBuckets,NULL);
-    theBucketBase.reserve(iBuckets);
-    theEntryBase.reserve(iBuckets*10);
+    CompHashT hV = rComp.getHashKey();
+
+    unsigned int pos = homeSlot(hV);
+    unsigned int dist;
+
+    nCollisions = 0;
+    for (dist = 0; ; dist++, pos = nextSlot(pos))
+    {
+        CCacheSlot &rSlot = theTable[pos];
+
+        // by the Robin Hood invariant hV would have been stored before this slot
+        if (rSlot.id == NIL_ENTRY || rSlot.dist < dist) break;
+
+        if (rSlot.hashKey != hV) continue;
+
+        if (theEntryBase[rSlot.id].equals(rComp, thePackedIds.data(), rL))
+        {
+            nProbes = dist + 1;
+            return rSlot.id;
+        }
+        // same hash key, different component
+        nCollisions++;
+    }
+    nProbes = dist + 1;
+    return NIL_ENTRY;
+}
+
+void CCacheShard::compactPackedIds(const CPackLayout &rL)
+{
+    unsigned int *pIds = thePackedIds.data();
+    size_t rd = 0, wr = 0;
+
+    while (rd < thePackedIds.size())
+    {
+        unsigned int header = pIds[rd];
+        if (header & DEAD_PACKED_RUN)
+        {
+            rd += 1 + (header & ~DEAD_PACKED_RUN);
+            continue;
+        }
+
+        CCacheEntry &rE = theEntryBase[header];
+        unsigned int nBlocks = rE.sizeVarVec(rL) + rE.sizeClVec(rL);
+
+        pIds[wr] = header;
+        rE.relocate(pIds, wr + 1, rL);
+        wr += 1 + nBlocks;
+        rd += 1 + nBlocks;
+    }
+
+    thePackedIds.resize(wr);
+    iDeadPackedIds = 0;
+}
+
+
+CFormulaCache::CFormulaCache(unsigned int tableBits)
+{
+    unsigned int bits = std::max(tableBits, (unsigned int) CACHE_SHARD_BITS + 4) - CACHE_SHARD_BITS;
+    for (unsigned int s = 0; s < CACHE_SHARDS; s++)
+    {
+        CCacheShard &rS = theShards[s];
+        rS.iTableBits = bits;
+        rS.iTableMask = (1u << bits) - 1;
+        rS.theTable.resize((size_t) 1 << bits);
+        rS.theEntryBase.reserve(rS.theTable.size()*10);
+    }
+    iEvictShard = 0;
     scoresDivTime = 50000;
     lastDivTime = 0;
-    if (CSolverConf::maxCacheSize == 0)
-        CSolverConf::maxCacheSize = availableMem() / 2;
+    if (theConf().maxCacheSize == 0)
+        theConf().maxCacheSize = availableMem() / 2;
+    maxMemUsage = theConf().maxCacheSize;
 }
 
+void CFormulaCache::init()
+{
+    for (unsigned int s = 0; s < CACHE_SHARDS; s++)
+        theShards[s].init();
+    iEvictShard = 0;
+    memUsage = 0;
+    maxMemUsage = theConf().maxCacheSize;
+    iCachedComponents = 0;
+    iCacheRetrievals = 0;
+    iSumRetrieveSize = 0;
+    iSumCachedCompSize = 0;
+    iSumCachedMemSize = 0;
+    iCacheTries = 0;
+    scoresDivTime = 50000;
+    lastDivTime = 0;
+    for (unsigned int i = 0; i < PAUSE_HIST_SIZE; i++) thePauseHist[i] = 0;
+    iMaxPauseUsecs = 0;
+}
 
-
-bool CFormulaCache::include(CComponentId &rComp, const CRealNum &val, DTNode * dtNode)
+bool CFormulaCache::include(CComponentId &rComp, const CRealNum &val, DTNode * dtNode,
+                            const CRealNum *weightedVal)
 {
 #ifdef DEBUG
     // if everything is correct, a new value to be cached
@@ -72,34 +238,59 @@ bool CFormulaCache::include(CComponentId &rComp, const CRealNum &val, DTNode * d
     if (rComp.empty()) return false;
     iCacheTries++;
 
-    if (memUsage >= CSolverConf::maxCacheSize)  return false;
+    CompHashT hV = rComp.getHashKey();
+    unsigned int s = shardOf(hV);
+    CCacheShard &rS = theShards[s];
 
-    long unsigned int hV = rComp.getHashKey();
+    if (rS.memUsage >= maxShardMemUsage())  return false;
 
-    CCacheBucket &rBucket = at(clip(hV));
+    rS.lock();
 
+    if (rS.needsGrowth()) rS.rebuildTable(rS.iTableBits + 1);
 
-    CacheEntryId eId = newEntry();
-    CCacheEntry & rEntry = entry(eId);
-    rBucket.push_back(eId);
-    rEntry.createFrom(rComp);
+    CacheEntryId idx = newEntry(rS);
+    CacheEntryId eId = toCacheEntryId(s, idx);
+    CCacheEntry & rEntry = rS.theEntryBase[idx];
+    rS.insertSlot(hV, idx);
+    rS.thePackedIds.push_back(idx); // header of the run
+    rEntry.createFrom(rComp, rS.thePackedIds, thePackLayout);
     rEntry.hashKey = hV;
     rEntry.theVal = val;
     rEntry.theDTNode = dtNode;
+    rEntry.score = 0;
 
-    rComp.cachedAs = eId; // save in the Comp, wwhere it was saved
-    rEntry.theDescendants = rComp.cachedChildren; // save the cache ids of its children
+    if (weightedVal != NULL)
+    {
+        if (rS.theWeightedVals.size() <= idx)
+            rS.theWeightedVals.resize(rS.theEntryBase.size());
+        rS.theWeightedVals[idx] = *weightedVal;
+    }
 
-    rComp.cachedChildren.clear();
+    rS.memUsage += rEntry.memSize(thePackLayout);
+
+    rS.unlock();
+
+    rComp.cachedAs = toRef(eId); // save in the Comp, wwhere it was saved
+
+    // the cached children become descendants of the new entry,
+    // children evicted in the meantime are skipped
+    vector<CacheRefT>::iterator ct;
+    for (ct = rComp.cachedChildren.begin(); ct != rComp.cachedChildren.end(); ct++)
+    {
+        CacheEntryId child = fromRef(*ct);
+        if (child == NIL_ENTRY) continue;
+        if (entry(child).theFather != NIL_ENTRY) unlinkFromFather(child);
+        linkDescendant(eId, child);
+    }
 
-    adjustDescendantsFather(eId);
+    rComp.cachedChildren.clear();
 
 
     //BEGIN satistics
 
     auto memU = memUsage/(10*1024*1024);
 
-    memUsage += rEntry.memSize();
+    memUsage += entry(eId).memSize(thePackLayout);
 
     if (memU < memUsage/(10*1024*1024))
     {
@@ -118,194 +309,314 @@ bool CFormulaCache::include(CComponentId &rComp, const CRealNum &val, DTNode * d
     return true;
 }
 
-bool CFormulaCache::extract(CComponentId &rComp, CRealNum &val, DTNode * dtNode)
+CacheEntryId CFormulaCache::find(CComponentId &rComp)
 {
-    long unsigned int hV = rComp.getHashKey();
+    unsigned int s = shardOf(rComp.getHashKey());
+    CCacheShard &rS = theShards[s];
+    unsigned int nProbes, nCollisions;
 
-    unsigned int v = clip(hV);
+    // the owner changes the shards itself, it reads them without the lock
+    CacheEntryId idx = rS.lookup(rComp, thePackLayout, nProbes, nCollisions);
 
-    if (!isBucketAt(v)) return false;
-    CCacheBucket &rBucket = *theData[v]; // the location of the considered bucket
+    rS.countProbes(nProbes);
+    rS.iHashCollisions += nCollisions;
+    if (idx == NIL_ENTRY) return NIL_ENTRY;
+    return toCacheEntryId(s, idx);
+}
 
-    CCacheEntry *pComp;
+bool CFormulaCache::extract(CComponentId &rComp, CRealNum &val, DTNode * dtNode,
+                            CRealNum *weightedVal)
+{
+    CacheEntryId eId = find(rComp);
+    if (eId == NIL_ENTRY) return false;
 
-    for (CCacheBucket::iterator it = rBucket.begin(); it != rBucket.end();it++)
-    {
-        pComp = &entry(*it);
-        if (hV == pComp->getHashKey() &&  pComp->equals(rComp))
-        {
-            val = pComp->theVal;
-            pComp->score++;
-            pComp->score+= (unsigned int)pComp->sizeVarVec();
+    CCacheEntry *pComp = &entry(eId);
 
-            iCacheRetrievals++;
-            iSumRetrieveSize += rComp.countVars();
+    val = pComp->theVal;
+    if (weightedVal != NULL)
+        *weightedVal = shard(eId).theWeightedVals[eId >> CACHE_SHARD_BITS];
+    pComp->score++;
+    pComp->score+= (unsigned int)pComp->sizeVarVec(thePackLayout);
 
-            if (iCacheRetrievals % 50000 == 0)
-            {
-                double d = iSumRetrieveSize;
-                d /= (double) iCacheRetrievals;
-                toSTDOUT("cache hits:"<< iCacheRetrievals<<" avg size:"<< d<<endl);
-            }
-            
-            pComp->theDTNode->addParent(dtNode, true);
-            
-            return true;
+    shard(eId).iHits++;
+    iCacheRetrievals++;
+    iSumRetrieveSize += rComp.countVars();
 
-        }
+    if (iCacheRetrievals % 50000 == 0)
+    {
+        double d = iSumRetrieveSize;
+        d /= (double) iCacheRetrievals;
+        toSTDOUT("cache hits:"<< iCacheRetrievals<<" avg size:"<< d<<endl);
     }
-    return false;
+
+    // entries of a counting only run carry no node
+    if (pComp->theDTNode != NULL)
+        pComp->theDTNode->addParent(dtNode);
+
+    return true;
 }
 
-int CFormulaCache::removePollutedEntries(CacheEntryId root)
+bool CFormulaCache::extractShared(CComponentId &rComp, CRealNum &val, DTNode * dtNode,
+                                  CRealNum *weightedVal)
 {
-    vector<CacheEntryId>::iterator it;// theDescendants;
-    CCacheBucket &rBuck = at(clip(entry(root).hashKey));
-    unsigned int n = 0;
+    CCacheShard &rS = theShards[shardOf(rComp.getHashKey())];
+    unsigned int nProbes, nCollisions;
 
+    rS.iSharedLookups++;
+    if (!rS.theLock.try_lock_shared())
+    {
+        rS.iContended++;
+        return false;
+    }
 
-    for (CCacheBucket::iterator jt= rBuck.begin(); jt != rBuck.end(); jt++)
+    // the score is the owner's, a shared hit leaves it alone
+    CacheEntryId idx = rS.lookup(rComp, thePackLayout, nProbes, nCollisions);
+    DTNode *node = NULL;
+    if (idx != NIL_ENTRY)
     {
-        if (*jt == root)
-        {
-            rBuck.erase(jt);
-            n++;
-            break;
-        }
+        val = rS.theEntryBase[idx].theVal;
+        if (weightedVal != NULL)
+            *weightedVal = rS.theWeightedVals[idx];
+        node = rS.theEntryBase[idx].theDTNode;
     }
 
-    for (it = entry(root).theDescendants.begin(); it != entry(root).theDescendants.end(); it++)
+    rS.theLock.unlock_shared();
+
+    if (idx == NIL_ENTRY) return false;
+    rS.iSharedHits++;
+
+    // the nodes of an entry are complete once it is cached, the reader
+    // only links its own node to them
+    if (node != NULL)
+        node->addParent(dtNode);
+
+    return true;
+}
+
+int CFormulaCache::removePollutedEntries(CacheRefT root)
+{
+    CacheEntryId eId = fromRef(root);
+
+    // already evicted, its descendants went to its father
+    if (eId == NIL_ENTRY) return 0;
+
+    unlinkFromFather(eId);
+    return removeSubtree(eId);
+}
+
+int CFormulaCache::removeSubtree(CacheEntryId root)
+{
+    CacheEntryId child, next;
+    unsigned int n = 1;
+
+    for (child = entry(root).theFirstChild; child != NIL_ENTRY; child = next)
     {
-        n += removePollutedEntries(*it);
+        next = entry(child).theNextSibling;
+        n += removeSubtree(child);
     }
 
-    entry(root).clear();
+    CCacheShard &rS = shard(root);
+    rS.lock();
+    freeEntry(root);
+    rS.unlock();
 
     return n;
 }
 
-bool CFormulaCache::deleteEntries(CDecisionStack & rDecStack)
+void CFormulaCache::freeEntry(CacheEntryId eId)
 {
-    vector<CCacheBucket>::iterator jt;
-    vector<CCacheEntry>::iterator it,itWrite;
-    CCacheBucket::iterator bt;
+    CCacheShard &rS = shard(eId);
+    CacheEntryId idx = eId >> CACHE_SHARD_BITS;
+    CCacheEntry &rE = rS.theEntryBase[idx];
+
+    rS.removeSlot(rE.hashKey, idx);
 
-    if (memUsage < (size_t) (0.85 * (double) CSolverConf::maxCacheSize)) return false;
+    unsigned int nBlocks = rE.sizeVarVec(thePackLayout) + rE.sizeClVec(thePackLayout);
+    rS.thePackedIds[rE.getOfs() - 1] = DEAD_PACKED_RUN | nBlocks;
+    rS.iDeadPackedIds += nBlocks + 1;
 
-    // first : go through the EntryBase and mark the entries to be deleted as deleted (i.e. EMPTY
-    for (it = beginEntries(); it != endEntries(); it++)
+    rS.memUsage -= rE.memSize(thePackLayout);
+    memUsage -= rE.memSize(thePackLayout);
+    iCachedComponents--;
+    iSumCachedCompSize -= rE.countVars();
+
+    rE.clear();
+    rE.theGeneration++;
+    rS.theFreeEntries.push_back(idx);
+}
+
+bool CFormulaCache::deleteEntries()
+{
+    // a cycle runs on one shard until it ends, the others wait their turn
+    for (unsigned int i = 0; i < CACHE_SHARDS; i++)
     {
-        if (it->score <= minScoreBound)
+        unsigned int s = (iEvictShard + i) & (CACHE_SHARDS - 1);
+        if (evictionStep(s))
         {
-            deleteFromDescendantsTree(toCacheEntryId(it));
-            it->clear();
+            iEvictShard = s;
+            return true;
         }
     }
+    return false;
+}
+
+bool CFormulaCache::evictionStep(unsigned int s)
+{
+    CCacheShard &rS = theShards[s];
+    size_t bound = (size_t) (0.85 * (double) maxShardMemUsage());
 
-    // then go through the BucketBase and rease all Links to empty entries
-    for (jt = theBucketBase.begin(); jt != theBucketBase.end(); jt++)
+    // reclaim the arena once it holds more dead than live blocks
+    bool compact = rS.iDeadPackedIds > (1 << 12) && 2 * rS.iDeadPackedIds > rS.thePackedIds.size();
+
+    if (!rS.bEvicting)
     {
-        for (bt = jt->end()-1; bt != jt->begin()-1; bt--)
-        {
-            if (entry(*bt).empty()) bt = jt->erase(bt);
-        }
+        if (rS.memUsage < bound && !compact) return false;
+        rS.bEvicting = rS.memUsage >= bound;
+        rS.iClockHand = 1;
     }
 
-    // now: go through the decisionStack. and delete all Links to empty entries
-    revalidateCacheLinksIn(rDecStack.getAllCompStack());
+    CStopWatch pauseTime;
+    pauseTime.markStartTime();
 
-    // finally: truly erase the empty entries, but keep the descendants tree consistent
-    size_t newSZ = 0;
-    long int SumNumOfVars= 0;
-    CacheEntryId idOld,idNew;
+    rS.lock();
 
-    itWrite = beginEntries();
-    for (it = beginEntries(); it != endEntries(); it++)
+    // advance the clock hand by at most EVICTION_STEP entries; entries that
+    // have not been used enough since the last score division are evicted,
+    // their descendants are moved to their father
+    for (unsigned int n = 0; rS.bEvicting && n < EVICTION_STEP; n++, rS.iClockHand++)
     {
-        if (!it->empty())
+        if (rS.iClockHand >= rS.theEntryBase.size())
         {
-            if (it != itWrite)
-            {
-                *itWrite = *it;
-                idNew = toCacheEntryId(itWrite);
-                idOld = toCacheEntryId(it);
-                at(clip(itWrite->getHashKey())).substituteIds(idOld,idNew);
-                substituteInDescTree(idOld,idNew);
-                substituteCacheLinksIn(rDecStack.getAllCompStack(),idOld,idNew);
-            }
-            itWrite++;
-            //theEntryBase.pop_back();
-            newSZ += itWrite->memSize();
-            SumNumOfVars += itWrite->sizeVarVec();
+            finishEvictionCycle(s);
+            break;
+        }
+
+        CCacheEntry &rE = rS.theEntryBase[rS.iClockHand];
+        if (!rE.empty() && rE.score <= rS.minScoreBound)
+        {
+            CacheEntryId eId = toCacheEntryId(s, rS.iClockHand);
+            deleteFromDescendantsTree(eId);
+            freeEntry(eId);
+            rS.iEvictedEntries++;
         }
     }
 
-    theEntryBase.erase(itWrite,theEntryBase.end());
+    if (compact) rS.compactPackedIds(thePackLayout);
 
-    iCachedComponents = theEntryBase.size();
-    iSumCachedCompSize = SumNumOfVars*sizeof(unsigned int)*8 / CCacheEntry::bitsPerVar();
+    rS.unlock();
 
-    memUsage = newSZ;
+    pauseTime.markStopTime();
+    countPause(pauseTime.getElapsedusecs());
 
-    toSTDOUT("Cache cleaned: "<<iCachedComponents<<" Components ("<< (memUsage>>10)<< " KB remain"<<endl);
+    return true;
+}
 
-    if (scoresDivTime == 0) scoresDivTime = 1;
-    size_t dbound = CSolverConf::maxCacheSize >> 1; // = 0.5 * maxCacheSize
-    if (memUsage < dbound)
+void CFormulaCache::finishEvictionCycle(unsigned int s)
+{
+    CCacheShard &rS = theShards[s];
+    rS.bEvicting = false;
+
+    size_t dbound = maxShardMemUsage() >> 1; // = 0.5 * maxShardMemUsage
+    if (rS.memUsage < dbound)
+        rS.minScoreBound/= 2;
+    else if (rS.memUsage > dbound)
     {
-        minScoreBound/= 2;
-        if (memUsage < (dbound >> 1)) scoresDivTime *= 2;
+        rS.minScoreBound <<= 1;
+        rS.minScoreBound++;
     }
-    else if (memUsage > dbound)
+    toDEBUGOUT("setting minScoreBound of shard "<<s<<": "<<rS.minScoreBound<<endl);
+
+    // the hash spreads the entries evenly, the first shard stands for all
+    if (s != 0) return;
+
+    toSTDOUT("Cache cleaned: "<<iCachedComponents<<" Components ("<< (memUsage>>10)<< " KB remain"<<endl);
+
+    if (scoresDivTime == 0) scoresDivTime = 1;
+    if (rS.memUsage < (dbound >> 1))
+        scoresDivTime *= 2;
+    else if (rS.memUsage > dbound)
     {
-        minScoreBound <<= 1;
-        minScoreBound++;
         scoresDivTime /= 2;
         if (scoresDivTime < 50000) scoresDivTime = 50000;
     }
     toDEBUGOUT("setting scoresDivTime: "<<scoresDivTime<<endl);
-    toDEBUGOUT("setting minScoreBound: "<<minScoreBound<<endl);
-
-    return true;
 }
 
-
-void CFormulaCache::revalidateCacheLinksIn(const vector<CComponentId *> &rComps)
+void CFormulaCache::printStatistics(CRunAnalyzer & rAn)
 {
-    vector<CComponentId *>::const_iterator it;
-    vector<unsigned int>::iterator jt;
-    for (it = rComps.begin(); it !=rComps.end(); it++)
+    size_t slots = 0;
+    unsigned int usedSlots = 0, lookups = 0, maxProbeLen = 0, collisions = 0;
+    unsigned int evicted = 0, sharedLookups = 0, sharedHits = 0, contended = 0;
+    unsigned int lockWaits = 0;
+    long unsigned int sumProbeLen = 0;
+
+    for (unsigned int s = 0; s < CACHE_SHARDS; s++)
     {
-        if (!isEntry((*it)->cachedAs)) (*it)->cachedAs = 0;
+        CCacheShard &rS = theShards[s];
+        slots += rS.theTable.size();
+        usedSlots += rS.iUsedSlots;
+        lookups += rS.iLookups;
+        sumProbeLen += rS.iSumProbeLen;
+        maxProbeLen = std::max(maxProbeLen, rS.iMaxProbeLen);
+        collisions += rS.iHashCollisions;
+        evicted += rS.iEvictedEntries;
+        sharedLookups += rS.iSharedLookups;
+        sharedHits += rS.iSharedHits;
+        contended += rS.iContended;
+        lockWaits += rS.iLockWaits;
+    }
 
-        if (isEntry((*it)->cachedAs) && entry((*it)->cachedAs).empty()) (*it)->cachedAs = 0;
+    rAn.setValue(FCACHE_MAXMEM,maxMemUsage);  // Formula Cache Memory Bound
+    rAn.setValue(FCACHE_MEMUSE,memUsage);  // Formula Cache memory usage
+    rAn.setValue(FCACHE_USEDBUCKETS,usedSlots); // number of occupied slots
+    rAn.setValue(FCACHE_CACHEDCOMPS,iCachedComponents);
+    rAn.setValue(FCACHE_RETRIEVALS,iCacheRetrievals); // number of retrieved components
+    rAn.setValue(FCACHE_INCLUDETRIES,iCacheTries); // number of times it was tried to put a component into the cache
+    rAn.setValue(FCACHE_TABLESLOTS,slots);
+    rAn.setValue(FCACHE_AVGPROBELEN,lookups == 0 ? 0.0 : (double) sumProbeLen / (double) lookups);
+    rAn.setValue(FCACHE_MAXPROBELEN,maxProbeLen);
+    rAn.setValue(FCACHE_HASHCOLLISIONS,collisions);
+    rAn.setValue(FCACHE_EVICTED,evicted);
+    for (unsigned int i = 0; i < PAUSE_HIST_SIZE; i++)
+        rAn.setValue((DATA_IDX) (FCACHE_PAUSES_100US + i),thePauseHist[i]);
+    rAn.setValue(FCACHE_MAXPAUSE,iMaxPauseUsecs / 1000.0);
+    rAn.setValue(FCACHE_SHAREDLOOKUPS,sharedLookups);
+    rAn.setValue(FCACHE_SHAREDHITS,sharedHits);
+    rAn.setValue(FCACHE_CONTENDED,contended);
+    rAn.setValue(FCACHE_LOCKWAITS,lockWaits);
+}
 
-        for (jt = (*it)->cachedChildren.end()-1; jt != (*it)->cachedChildren.begin()-1; jt--)
-        {
-            if ((!isEntry(*jt)) || entry(*jt).empty())
-            {
-                toDEBUGOUT("_E");
-                jt =(*it)->cachedChildren.erase(jt);
-            }
-        }
+void CFormulaCache::printShardStatistics()
+{
+    toSTDOUT("Cache shards (entries, hits/lookups, shared hits/lookups, turned away, lock waits):"<<endl);
+    for (unsigned int s = 0; s < CACHE_SHARDS; s++)
+    {
+        CCacheShard &rS = theShards[s];
+        toSTDOUT("  "<<s<<":\t"<<rS.theEntryBase.size() - 1 - rS.theFreeEntries.size()
+                <<"\t"<<rS.iHits<<"/"<<rS.iLookups
+                <<"\t"<<rS.iSharedHits<<"/"<<rS.iSharedLookups
+                <<"\t"<<rS.iContended<<"\t"<<rS.iLockWaits<<endl);
     }
 }
 
 
-void CFormulaCache::substituteCacheLinksIn(const vector<CComponentId *> &rComps, CacheEntryId idOld, CacheEntryId idNew)
+void CFormulaCache::revalidateCacheLinksIn(const vector<CComponentId *> &rComps)
 {
     vector<CComponentId *>::const_iterator it;
-    vector<unsigned int>::iterator jt;
+    vector<CacheRefT>::iterator jt;
     for (it = rComps.begin(); it !=rComps.end(); it++)
     {
-        if ((*it)->cachedAs == idOld) (*it)->cachedAs = idNew;
-        for (jt = (*it)->cachedChildren.begin(); jt != (*it)->cachedChildren.end(); jt++)
+        if (fromRef((*it)->cachedAs) == NIL_ENTRY) (*it)->cachedAs = 0;
+
+        for (jt = (*it)->cachedChildren.begin(); jt != (*it)->cachedChildren.end();)
         {
-            if (*jt == idOld)
+            if (fromRef(*jt) == NIL_ENTRY)
             {
-                toDEBUGOUT("_D");
-                *jt = idNew;
+                toDEBUGOUT("_E");
+                jt =(*it)->cachedChildren.erase(jt);
             }
+            else
+                jt++;
         }
     }
 }
@@ -8,6 +8,9 @@
 
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <shared_mutex>
 
 
 #include <SomeTime.h>
@@ -43,14 +46,22 @@ typedef unsigned int CacheEntryId;
 
 class CCacheEntry : public CPackedCompId<unsigned int>
 {
-    long unsigned int hashKey;
+    CompHashT hashKey;
     friend class CFormulaCache;
+    friend struct CCacheShard;
 
-    // theFather and theDescendants:
+    // theFather and the child links:
     // each CCacheEntry is a Node in a tree which represents the relationship
-    // of the components stored
+    // of the components stored. The children of an entry form a doubly
+    // linked list through thePrevSibling/theNextSibling. The tree spans
+    // the shards of the cache, only its owner follows the links.
     CacheEntryId theFather;
-    vector<CacheEntryId> theDescendants;
+    CacheEntryId theFirstChild;
+    CacheEntryId thePrevSibling;
+    CacheEntryId theNextSibling;
+
+    // incremented whenever the entry is freed, outdates all CacheRefTs to it
+    unsigned int theGeneration;
 
 public:
 
@@ -64,139 +75,223 @@ public:
     {
         score = 0;
         theFather = 0;
+        theFirstChild = 0;
+        thePrevSibling = 0;
+        theNextSibling = 0;
+        theGeneration = 0;
     }
 
 
     void clear()
     {
-        theVars.clear();
-        theClauses.clear();
-        theDescendants.clear();
-    }
-
-
-    ~CCacheEntry()
-    {
-        theDescendants.clear();
+        CPackedCompId<unsigned int>::clear();
         theFather = 0;
-        clear();
+        theFirstChild = 0;
+        thePrevSibling = 0;
+        theNextSibling = 0;
     }
 
 
-    long unsigned int getHashKey() const
+    CompHashT getHashKey() const
     {
         return hashKey;
     }
 
-    void setHashKey(long unsigned int &val)
+    void setHashKey(CompHashT &val)
     {
         hashKey = val;
     }
 
-    unsigned int memSize()
+    unsigned int memSize(const CPackLayout &rL)
     {
-        return  CPackedCompId<unsigned int>::memSize() + theDescendants.capacity()*sizeof(CacheEntryId);
+        return  CPackedCompId<unsigned int>::memSize(rL) + sizeof(CCacheEntry);
     }
 
-    void substituteDescendant(CacheEntryId iold, CacheEntryId inew)
+    CacheEntryId getFather()
     {
-        vector<CacheEntryId>::iterator it;
-        for (it = theDescendants.begin();it != theDescendants.end();it++)
-        {
-            if (*it == iold) *it = inew;
-        }
+        return theFather;
     }
 
-    void removeDescendant(CacheEntryId d)
-    {
-        vector<CacheEntryId>::iterator it;
-        for (it = theDescendants.end()-1;it != theDescendants.begin()-1;it--)
-        {
-            if (*it == d)
-            {
-                it = theDescendants.erase(it);
-            }
-        }
-    }
+};
 
 
-    void addDescendants(vector<CacheEntryId> &dVec)
-    {
-        theDescendants.insert(theDescendants.end(),dVec.begin(),dVec.end());
-    }
+/**
+ * a slot of the open addressing hash table of a CCacheShard
+ * the full hash key is kept next to the entry, so that almost all
+ * mismatches are detected without touching theEntryBase
+ */
+struct CCacheSlot
+{
+    CompHashT hashKey;
+    CacheEntryId id;   // index into theEntryBase of the shard, NIL_ENTRY marks a free slot
+    unsigned int dist; // distance from the home slot of hashKey
 
-    CacheEntryId getFather()
+    CCacheSlot() : hashKey(0), id(0), dist(0)
     {
-        return theFather;
     }
-    void substituteFather(CacheEntryId newFather)
-    {
-        theFather = newFather;
-    }
-
-
 };
 
+#define NIL_ENTRY 0
+#define DEAD_PACKED_RUN 0x80000000u
+
+// the entries are spread over 2^CACHE_SHARD_BITS shards by the top bits of
+// their hash keys; the id of an entry is its index in the shard shifted
+// left by CACHE_SHARD_BITS, or'ed with the number of the shard
+#define CACHE_SHARD_BITS 4
+#define CACHE_SHARDS (1u << CACHE_SHARD_BITS)
 
-class CCacheBucket : protected vector<CacheEntryId>
+/**
+ * the entries of CFormulaCache with the same top hash key bits. A shard has
+ * a table, an arena and an eviction clock of its own.
+ *
+ * Only the solver that owns the cache changes a shard, and it holds the
+ * lock of the shard while doing so. The solvers of its component tasks
+ * read the shard under a shared lock, see CFormulaCache::extractShared.
+ */
+struct CCacheShard
 {
-    friend class CFormulaCache;
+    // index 0 is a dummy, so that NIL_ENTRY is never a valid entry
+    vector<CCacheEntry> theEntryBase;
 
+    // arena for the packed encodings of the entries. Each run of blocks
+    // is preceded by a header word, the index of its entry or, once the
+    // entry is freed, DEAD_PACKED_RUN | number of blocks. Dead runs are
+    // reclaimed by compactPackedIds.
+    vector<unsigned int> thePackedIds;
+    size_t iDeadPackedIds;
+
+    // freed indices, reused before theEntryBase grows
+    vector<CacheEntryId> theFreeEntries;
+
+    // the weighted count of every entry of a weighted formula, by index;
+    // unweighted runs leave it empty
+    vector<CRealNum> theWeightedVals;
+
+    /**
+     * Robin Hood hashing with linear probing: an entry may take the slot
+     * of another one that is closer to its home slot, so every probe
+     * sequence stops at the first slot that is nearer to its home than
+     * the searched key would be. Deletions shift the following entries
+     * back, there are no tombstones.
+     */
+    vector<CCacheSlot> theTable;
+    unsigned int iTableBits;
+    unsigned int iTableMask;
+    unsigned int iUsedSlots;
+
+    // clock eviction: a step sweeps at most EVICTION_STEP entries,
+    // a cycle ends when the hand has passed all entries of the shard
+    CacheEntryId iClockHand;
+    bool bEvicting;
+    unsigned int minScoreBound;
 
-public:
+    size_t memUsage;
+
+    std::shared_mutex theLock;
+
+    /* statistics */
+    unsigned int iLookups;
+    unsigned int iHits;
+    long unsigned int iSumProbeLen;
+    unsigned int iMaxProbeLen;
+    unsigned int iHashCollisions;
+    unsigned int iEvictedEntries;
+
+    // changes of the owner that had to wait for a reader
+    unsigned int iLockWaits;
 
-    CCacheBucket()
+    // lookups of the other threads, and the ones turned away because
+    // the owner held the lock
+    std::atomic<unsigned int> iSharedLookups;
+    std::atomic<unsigned int> iSharedHits;
+    std::atomic<unsigned int> iContended;
+
+    CCacheShard() : iTableBits(0), iTableMask(0)
     {
     }
 
-    ~CCacheBucket()
+    // empties the shard, the table keeps the size it has grown to
+    void init();
+
+    void clear()
     {
-        clear();
+        theEntryBase.clear();
+        thePackedIds.clear();
+        theFreeEntries.clear();
+        theWeightedVals.clear();
+        theTable.clear();
     }
 
-    bool substituteIds(CacheEntryId oldId, CacheEntryId newId)
+    // the component hash is fully mixed, the bits below the shard number
+    // choose the home slot
+    unsigned int homeSlot(CompHashT hashKey)
     {
-        for (CCacheBucket::iterator it = begin(); it != end(); it++)
-        {
-            if (*it == oldId)
-            {
-                *it = newId;
-                return true;
-            }
-        }
-        return false;
+        return (unsigned int) ((hashKey << CACHE_SHARD_BITS) >> (64 - iTableBits));
     }
 
-    using vector<CacheEntryId>::size;
-};
-
-class CFormulaCache
-{
-    vector<CCacheBucket> theBucketBase;
-
-    vector<CCacheEntry> theEntryBase;
-
-#define NIL_ENTRY 0
+    unsigned int nextSlot(unsigned int pos)
+    {
+        return (pos + 1) & iTableMask;
+    }
 
-    vector<CCacheBucket *> theData;
+    bool needsGrowth()
+    {
+        // keep the load factor below 7/8
+        return 8 * ((size_t) iUsedSlots + 1) > 7 * theTable.size();
+    }
 
-    vector<CCacheEntry>::iterator beginEntries()
+    // the owner locks a shard before changing it, this waits for readers only
+    void lock()
     {
-        return theEntryBase.begin()+1;
+        if (theLock.try_lock()) return;
+        iLockWaits++;
+        theLock.lock();
     }
-    vector<CCacheEntry>::iterator endEntries()
+
+    void unlock()
     {
-        return theEntryBase.end();
+        theLock.unlock();
     }
 
-    CacheEntryId toCacheEntryId(vector<CCacheEntry>::iterator &it)
+    void countProbes(unsigned int n)
     {
-        return (CacheEntryId)(it - theEntryBase.begin());
+        iLookups++;
+        iSumProbeLen += n;
+        if (n > iMaxProbeLen) iMaxProbeLen = n;
     }
 
+    void insertSlot(CompHashT hashKey, CacheEntryId idx);
+
+    // returns false if idx is not stored under hashKey
+    bool removeSlot(CompHashT hashKey, CacheEntryId idx);
+
+    // resizes the table to 2^bits slots and inserts all valid entries anew
+    void rebuildTable(unsigned int bits);
+
+    // the index of the entry of rComp, NIL_ENTRY if it is not cached;
+    // nProbes and nCollisions are set to the cost of the lookup
+    CacheEntryId lookup(CComponentId &rComp, const CPackLayout &rL,
+                        unsigned int &nProbes, unsigned int &nCollisions);
+
+    void compactPackedIds(const CPackLayout &rL);
+
+private:
+
+    CCacheShard(const CCacheShard &);
+    CCacheShard &operator=(const CCacheShard &);
+};
+
+class CFormulaCache
+{
+    CCacheShard theShards[CACHE_SHARDS];
+
+    // the encoding of the components, the same in every shard
+    CPackLayout thePackLayout;
+
+#define EVICTION_STEP 4096
+    // the shard deleteEntries works on
+    unsigned int iEvictShard;
 
-    unsigned int iBuckets;
-    static unsigned int oldestEntryAllowed;
     /* statistics */
     unsigned int iCacheRetrievals;
     unsigned int iSumRetrieveSize;
@@ -205,15 +300,19 @@ class CFormulaCache
     unsigned int iCachedComponents;
     unsigned int iSumCachedCompSize;
     unsigned int iSumCachedMemSize;
-    unsigned int iUsedBuckets;
     unsigned int scoresDivTime;
-    unsigned int minScoreBound;
 
     unsigned int lastDivTime;
 
+    // histogram of the time spent in deleteEntries: < 0.1ms, < 1ms,
+    // < 10ms, < 100ms and above
+#define PAUSE_HIST_SIZE 5
+    unsigned int thePauseHist[PAUSE_HIST_SIZE];
+    unsigned int iMaxPauseUsecs;
+
     /*end statistics */
     size_t memUsage;
-    //unsigned int maxMemUsage;
+    size_t maxMemUsage; // CSolverConf::maxCacheSize unless set otherwise
 
     double avgCachedSize()
     {
@@ -233,66 +332,94 @@ class CFormulaCache
         return (double) iSumRetrieveSize / (double) iCacheRetrievals;
     }
 
-    unsigned int clip(unsigned int ofs)
+    void countPause(unsigned int usecs)
+    {
+        unsigned int i = 0;
+        for (unsigned int bound = 100; i < PAUSE_HIST_SIZE - 1 && usecs >= bound; bound *= 10) i++;
+        thePauseHist[i]++;
+        if (usecs > iMaxPauseUsecs) iMaxPauseUsecs = usecs;
+    }
+
+    // each shard may use its share of maxMemUsage
+    size_t maxShardMemUsage()
+    {
+        return maxMemUsage / CACHE_SHARDS;
+    }
+
+    unsigned int shardOf(CompHashT hashKey)
+    {
+        return (unsigned int) (hashKey >> (64 - CACHE_SHARD_BITS));
+    }
+
+    CCacheShard &shard(CacheEntryId theId)
     {
-        return ofs % iBuckets;
+        return theShards[theId & (CACHE_SHARDS - 1)];
     }
 
-    unsigned int clip(long unsigned int ofs)
+    CacheEntryId toCacheEntryId(unsigned int s, CacheEntryId idx)
     {
-        return ofs % iBuckets;
+        return (idx << CACHE_SHARD_BITS) | s;
     }
 
+    // the id of the entry of rComp, NIL_ENTRY if it is not cached
+    CacheEntryId find(CComponentId &rComp);
+
     bool isEntry(CacheEntryId theId)
     {
-        return (theId != 0) & (theId < theEntryBase.size());
+        CacheEntryId idx = theId >> CACHE_SHARD_BITS;
+        return (idx != 0) & (idx < shard(theId).theEntryBase.size());
     }
 
     CCacheEntry &entry(CacheEntryId theId)
     {
 #ifdef DEBUG
-        assert(theId < theEntryBase.size());
+        assert(isEntry(theId));
 #endif
-        return theEntryBase[theId];
-    }
-
-    CacheEntryId newEntry()
-    {
-        theEntryBase.push_back(CCacheEntry());
-        return theEntryBase.size()-1;
+        return shard(theId).theEntryBase[theId >> CACHE_SHARD_BITS];
     }
 
-    unsigned int memSizeOf(CCacheBucket &rBuck)
+    // a free index of rS, the shard has to be locked
+    CacheEntryId newEntry(CCacheShard &rS)
     {
-        unsigned int n = 0;
-        for (CCacheBucket::iterator it = rBuck.begin();it!= rBuck.end();it++)
+        if (!rS.theFreeEntries.empty())
         {
-            n += entry(*it).memSize();
+            CacheEntryId idx = rS.theFreeEntries.back();
+            rS.theFreeEntries.pop_back();
+            return idx;
         }
-        return n;
+        rS.theEntryBase.push_back(CCacheEntry());
+        return rS.theEntryBase.size()-1;
     }
 
-    CCacheBucket *createNewCacheBucket()
-    {
-        theBucketBase.push_back(CCacheBucket());
-        iUsedBuckets++;
-        return &theBucketBase.back();
-    }
+    // removes the entry from the table and the arena and puts it on the free list;
+    // the descendants tree has to be updated before and the shard has to be locked
+    void freeEntry(CacheEntryId eId);
+
+    // one eviction step on shard s, false if it needs none
+    bool evictionStep(unsigned int s);
 
-    CCacheBucket &at(unsigned int ofs)
+    // the end of an eviction cycle of shard s: adapt its minScoreBound,
+    // the first shard adapts scoresDivTime for all of them
+    void finishEvictionCycle(unsigned int s);
+
+    CacheRefT toRef(CacheEntryId eId)
     {
-        if (theData[ofs] == NULL) theData[ofs] = createNewCacheBucket();
-        return *theData[ofs];
+        return ((CacheRefT) entry(eId).theGeneration << 32) | eId;
     }
 
-    bool isBucketAt(unsigned int ofs)
+    // NIL_ENTRY if the entry of ref has been freed in the meantime
+    CacheEntryId fromRef(CacheRefT ref)
     {
-#ifdef DEBUG
-        assert(theData.size() > ofs);
-#endif
-        return theData[ofs] != NULL;
+        CacheEntryId eId = (CacheEntryId) ref;
+        if (!isEntry(eId) || entry(eId).theGeneration != (unsigned int) (ref >> 32)
+                || entry(eId).empty())
+            return NIL_ENTRY;
+        return eId;
     }
 
+    CFormulaCache(const CFormulaCache &);
+    CFormulaCache &operator=(const CFormulaCache &);
+
 public:
 
     unsigned int getScoresDivTime()
@@ -308,83 +435,139 @@ public:
         lastDivTime = d;
     }
 
-    CFormulaCache();
+    // the tables of all shards start with 2^tableBits slots together
+    // and grow when needed
+    CFormulaCache(unsigned int tableBits = 20);
 
     ~CFormulaCache()
     {
         reset();
     }
 
-    void init()
+    void init();
+
+    // the bits of the packed variable and clause ids, before the first include
+    void adjustPackSize(unsigned int maxVarId, unsigned int maxClId)
     {
-        theBucketBase.clear();
-        theData.clear();
-        theEntryBase.clear();
-        theEntryBase.push_back(CCacheEntry()); // dummy Element
-        theData.resize(iBuckets,NULL);
-        theBucketBase.reserve(iBuckets);
-        iUsedBuckets = 0;
-        memUsage = 0;
-        iCachedComponents = 0;
-        iCacheRetrievals = 0;
-        iSumRetrieveSize = 0;
-        iSumCachedCompSize = 0;
-        iSumCachedMemSize = 0;
-        iCacheTries = 0;
-        minScoreBound = 0;
+        thePackLayout.adjust(maxVarId, maxClId);
     }
 
-    void reset()
+    const CPackLayout &packLayout() const
     {
-        theBucketBase.clear();
-        theEntryBase.clear();
-        theData.clear();
+        return thePackLayout;
+    }
+
+    void setPackLayout(const CPackLayout &rL)
+    {
+        thePackLayout = rL;
     }
 
-    void printStatistics(CRunAnalyzer & rAn)
+    // the memory bound of this cache, after init()
+    void setMaxMemory(size_t bytes)
     {
-        rAn.setValue(FCACHE_MAXMEM,CSolverConf::maxCacheSize);  // Formula Cache Memory Bound
-        rAn.setValue(FCACHE_MEMUSE,memUsage);  // Formula Cache memory usage
-        rAn.setValue(FCACHE_USEDBUCKETS,iUsedBuckets); // number of hashbuckets used
-        rAn.setValue(FCACHE_CACHEDCOMPS,iCachedComponents);
-        rAn.setValue(FCACHE_RETRIEVALS,iCacheRetrievals); // number of retrieved components
-        rAn.setValue(FCACHE_INCLUDETRIES,iCacheTries); // number of times it was tried to put a component into the cache
+        maxMemUsage = bytes;
+    }
 
+    void reset()
+    {
+        for (unsigned int s = 0; s < CACHE_SHARDS; s++)
+            theShards[s].clear();
     }
 
+    void printStatistics(CRunAnalyzer & rAn);
+
+    // one line per shard with its entries, hits and contention
+    void printShardStatistics();
+
     void divCacheScores()
     {
-        for (vector<CCacheEntry>::iterator it =  theEntryBase.begin(); it != theEntryBase.end(); it++)
+        for (unsigned int s = 0; s < CACHE_SHARDS; s++)
         {
-            (it->score) >>= 1;
+            vector<CCacheEntry> &rBase = theShards[s].theEntryBase;
+            for (vector<CCacheEntry>::iterator it = rBase.begin(); it != rBase.end(); it++)
+            {
+                (it->score) >>= 1;
+            }
         }
     }
 
-    long unsigned int computeHashVal(const CComponentId &rComp);
+    // weightedVal is stored and returned alongside val in a weighted run
+    bool include(CComponentId &rComp, const CRealNum &val, DTNode * dtNode,
+                 const CRealNum *weightedVal = NULL);
 
-    bool include(CComponentId &rComp, const CRealNum &val, DTNode * dtNode);
+    // only the thread of the owning solver may call the other members,
+    // extractShared is the lookup for any other thread. It never waits:
+    // a shard that is being changed just misses.
+    bool extract(CComponentId &rComp, CRealNum &val, DTNode * dtNode,
+                 CRealNum *weightedVal = NULL);
 
-    bool extract(CComponentId &rComp, CRealNum &val, DTNode * dtNode);
+    bool extractShared(CComponentId &rComp, CRealNum &val, DTNode * dtNode,
+                       CRealNum *weightedVal = NULL);
 
-    bool deleteEntries(CDecisionStack & rDecStack);
+    // whether rComp is cached, without counting it as a retrieval
+    bool contains(CComponentId &rComp)
+    {
+        return find(rComp) != NIL_ENTRY;
+    }
+
+    // entry ids range over [1, endEntryId()), see getEntry
+    CacheEntryId endEntryId()
+    {
+        size_t n = 0;
+        for (unsigned int s = 0; s < CACHE_SHARDS; s++)
+            n = std::max(n, theShards[s].theEntryBase.size());
+        return (CacheEntryId) (n << CACHE_SHARD_BITS);
+    }
+
+    // the component, value and d-DNNF of an entry, false if the id is not in use
+    bool getEntry(CacheEntryId eId, vector<VarIdT> &vars, vector<ClauseIdT> &cls,
+                  CRealNum &val, DTNode * &dtNode)
+    {
+        if (!isEntry(eId)) return false;
+        CCacheEntry &rE = entry(eId);
+        if (rE.empty()) return false;
+        rE.unpack(shard(eId).thePackedIds.data(), thePackLayout, vars, cls);
+        val = rE.theVal;
+        dtNode = rE.theDTNode;
+        return true;
+    }
+
+    // one step of the incremental eviction, entry ids stay valid
+    bool deleteEntries();
 
     void revalidateCacheLinksIn(const vector<CComponentId*> &rComps);
-    void substituteCacheLinksIn(const vector<CComponentId*> &rComps, CacheEntryId idOld, CacheEntryId idNew);
 
 
-    int removePollutedEntries(CacheEntryId root); // remove the whole tree below root
+    int removePollutedEntries(CacheRefT root); // remove the whole tree below root
 
+    int removeSubtree(CacheEntryId root);
 
-    bool cacheCompaction(CDecisionStack & rDecStack);
 
-    void adjustDescendantsFather(CacheEntryId father)
+    // makes child the first descendant of father
+    void linkDescendant(CacheEntryId father, CacheEntryId child)
     {
-        vector<CacheEntryId>::iterator it;
-        for (it = entry(father).theDescendants.begin();
-                it != entry(father).theDescendants.end();it++)
-        {
-            entry(*it).theFather = father;
-        }
+        CCacheEntry &rChild = entry(child);
+        rChild.theFather = father;
+        rChild.thePrevSibling = NIL_ENTRY;
+        rChild.theNextSibling = entry(father).theFirstChild;
+        if (rChild.theNextSibling != NIL_ENTRY)
+            entry(rChild.theNextSibling).thePrevSibling = child;
+        entry(father).theFirstChild = child;
+    }
+
+    // removes rEnt from the list of descendants of its father
+    void unlinkFromFather(CacheEntryId rEnt)
+    {
+        CCacheEntry &rE = entry(rEnt);
+        if (rE.thePrevSibling != NIL_ENTRY)
+            entry(rE.thePrevSibling).theNextSibling = rE.theNextSibling;
+        else if (rE.theFather != NIL_ENTRY)
+            entry(rE.theFather).theFirstChild = rE.theNextSibling;
+        if (rE.theNextSibling != NIL_ENTRY)
+            entry(rE.theNextSibling).thePrevSibling = rE.thePrevSibling;
+        rE.theFather = NIL_ENTRY;
+        rE.thePrevSibling = NIL_ENTRY;
+        rE.theNextSibling = NIL_ENTRY;
     }
 
     // delete entries, keeping the descendants tree consistent
@@ -393,46 +576,23 @@ public:
         // let ME be the entry to be deleted
         CacheEntryId father = entry(rEnt).getFather();
         // first remove link from father to ME
-        if (father != NIL_ENTRY)
-        {
-            entry(father).removeDescendant(rEnt);
-            // then add all my descendants to descendants of father
-            entry(father).addDescendants(entry(rEnt).theDescendants);
-        }
-        // next all MY descendants have now father father
-        vector<CacheEntryId>::iterator it;
-        for (it = entry(rEnt).theDescendants.begin();
-                it != entry(rEnt).theDescendants.end();
-                it++)
-        {
-            entry(*it).substituteFather(father);
-        }
-    }
-
-    void substituteInDescTree(CacheEntryId rOld, CacheEntryId rNew)
-    {
-        // let ME be the entry to be deleted
-        CacheEntryId father = entry(rOld).getFather();
-        // first subst link from father to ME
+        unlinkFromFather(rEnt);
 
-        if (father != NIL_ENTRY)
+        // then all my descendants become descendants of father
+        CacheEntryId child = entry(rEnt).theFirstChild, next;
+        for (; child != NIL_ENTRY; child = next)
         {
-#ifdef DEBUG
-            assert(isEntry(father));
-#endif
-            entry(father).substituteDescendant(rOld, rNew);
-        }
-        // next all MY descendants get father rNew
-        vector<CacheEntryId>::iterator it;
-        for (it = entry(rOld).theDescendants.begin();
-                it != entry(rOld).theDescendants.end();
-                it++)
-        {
-#ifdef DEBUG
-            assert(isEntry(*it));
-#endif
-            entry(*it).substituteFather(rNew);
+            next = entry(child).theNextSibling;
+            if (father != NIL_ENTRY)
+                linkDescendant(father, child);
+            else
+            {
+                entry(child).theFather = NIL_ENTRY;
+                entry(child).thePrevSibling = NIL_ENTRY;
+                entry(child).theNextSibling = NIL_ENTRY;
+            }
         }
+        entry(rEnt).theFirstChild = NIL_ENTRY;
     }
 
 };
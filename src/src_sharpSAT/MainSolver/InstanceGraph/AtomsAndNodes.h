@@ -154,9 +154,9 @@ public:
 		return lastTouchTime;
 	}
 
-	void setTouched()
+	void setTouched(int time)
 	{
-		lastTouchTime = CStepTime::getTime();
+		lastTouchTime = time;
 	}
 
 	void setLength(unsigned int nlen)
@@ -0,0 +1,123 @@
+#include "BinaryCnf.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool isBinaryCnf(const char *data, size_t size)
+{
+    return size >= sizeof(BinaryCnfHeader)
+           && memcmp(data, BINARY_CNF_MAGIC, 8) == 0;
+}
+
+bool readBinaryCnf(const char *data, size_t size, unsigned int &nVars,
+                   unsigned int &nCls, vector<int> &litVec, string &err)
+{
+    BinaryCnfHeader hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+
+    if (hdr.byteOrderMark != BINARY_CNF_BYTEORDER)
+    {
+        err = "binary cnf was written on a machine with a different byte order";
+        return false;
+    }
+    if (hdr.version != BINARY_CNF_VERSION)
+    {
+        char buf[100];
+        sprintf(buf, "unsupported binary cnf version %u (expected %u)",
+                hdr.version, BINARY_CNF_VERSION);
+        err = buf;
+        return false;
+    }
+
+    // the counts are untrusted, bound them by the file size before multiplying
+    size_t bodyBytes = size - sizeof(hdr);
+    if (hdr.nLits > bodyBytes / sizeof(int32_t)
+        || hdr.nStoredClauses > bodyBytes / sizeof(uint64_t))
+    {
+        err = "binary cnf is truncated or has trailing data";
+        return false;
+    }
+
+    size_t poolBytes = hdr.nLits * sizeof(int32_t);
+    size_t ofsBytes = hdr.nStoredClauses * sizeof(uint64_t);
+
+    if (bodyBytes != poolBytes + ofsBytes)
+    {
+        err = "binary cnf is truncated or has trailing data";
+        return false;
+    }
+
+    const char *pool = data + sizeof(hdr);
+
+    litVec.resize(hdr.nLits);
+    int32_t lit;
+    for (uint64_t i = 0; i < hdr.nLits; i++)
+    {
+        memcpy(&lit, pool + i * sizeof(int32_t), sizeof(int32_t));
+        if ((int64_t) lit > hdr.nVars || -(int64_t) lit > hdr.nVars)
+        {
+            err = "binary cnf has a literal beyond the number of variables";
+            return false;
+        }
+        litVec[i] = lit;
+    }
+
+    // cheap consistency check: every clause offset has to follow a terminator
+    const char *ofsData = pool + poolBytes;
+    uint64_t ofs;
+    for (uint64_t i = 0; i < hdr.nStoredClauses; i++)
+    {
+        memcpy(&ofs, ofsData + i * sizeof(uint64_t), sizeof(uint64_t));
+        if (ofs >= hdr.nLits || (ofs > 0 && litVec[ofs - 1] != 0))
+        {
+            err = "binary cnf has an inconsistent clause offset table";
+            return false;
+        }
+    }
+    if (hdr.nLits > 0 && litVec.back() != 0)
+    {
+        err = "binary cnf literal pool is not terminated";
+        return false;
+    }
+
+    nVars = hdr.nVars;
+    nCls = hdr.nClauses;
+    return true;
+}
+
+bool writeBinaryCnf(const char *lpstrFileName, unsigned int nVars,
+                    unsigned int nCls, const vector<int> &litVec)
+{
+    vector<uint64_t> offsets;
+    offsets.reserve(nCls);
+
+    bool clauseStart = true;
+    for (size_t i = 0; i < litVec.size(); i++)
+    {
+        if (clauseStart)
+            offsets.push_back(i);
+        clauseStart = (litVec[i] == 0);
+    }
+
+    BinaryCnfHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, BINARY_CNF_MAGIC, 8);
+    hdr.version = BINARY_CNF_VERSION;
+    hdr.byteOrderMark = BINARY_CNF_BYTEORDER;
+    hdr.nVars = nVars;
+    hdr.nClauses = nCls;
+    hdr.nStoredClauses = offsets.size();
+    hdr.nLits = litVec.size();
+
+    FILE *out = fopen(lpstrFileName, "wb");
+    if (out == NULL)
+        return false;
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    if (ok && !litVec.empty())
+        ok = fwrite(&litVec[0], sizeof(int32_t), litVec.size(), out) == litVec.size();
+    if (ok && !offsets.empty())
+        ok = fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), out) == offsets.size();
+
+    return (fclose(out) == 0) && ok;
+}
@@ -0,0 +1,54 @@
+#ifndef BINARYCNF_H
+#define BINARYCNF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+using std::vector;
+using std::string;
+
+/** Binary cnf format
+ *
+ *  header      BinaryCnfHeader
+ *  lit pool    nLits x int32, the DIMACS literals of all clauses,
+ *              each clause terminated by a 0 (the layout of theLitVector)
+ *  offsets     nStoredClauses x uint64, index of the first literal of
+ *              every clause in the pool
+ *
+ *  All numbers are stored in the byte order of the writing machine,
+ *  byteOrderMark tells a loader if that differs from its own.
+ *  Files are written with dsharp -toBinCNF and loaded transparently
+ *  wherever a cnf file is expected.
+ */
+
+#define BINARY_CNF_MAGIC "dsharpBC"
+#define BINARY_CNF_VERSION 1
+#define BINARY_CNF_BYTEORDER 0x01020304
+
+struct BinaryCnfHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+
+    /// as given in the p cnf line
+    uint32_t nVars;
+    uint32_t nClauses;
+
+    /// number of clauses in the literal pool and its length
+    uint64_t nStoredClauses;
+    uint64_t nLits;
+};
+
+bool isBinaryCnf(const char *data, size_t size);
+
+/// fills litVec with the literal pool, returns false and sets err on malformed input
+bool readBinaryCnf(const char *data, size_t size, unsigned int &nVars,
+                   unsigned int &nCls, vector<int> &litVec, string &err);
+
+bool writeBinaryCnf(const char *lpstrFileName, unsigned int nVars,
+                    unsigned int nCls, const vector<int> &litVec);
+
+#endif
@@ -8,12 +8,34 @@
 
 #include <vector>
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
 
 #include <RealNumberTypes.h>
 
 #include "AtomsAndNodes.h"
 
 
+/// hash key of a component
+typedef uint64_t CompHashT;
+
+/// reference to a formula cache entry: the entry index in the low 32 bits,
+/// its generation in the high 32 bits, 0 if not cached
+typedef uint64_t CacheRefT;
+
+class CComponentTask;
+
+/// gives up a task that counts a component, see ComponentTasks.h
+void abandonTask(CComponentTask *task);
+
+/// one step of the incremental component hash: multiply-xorshift,
+/// every input bit reaches the high bits of the state
+inline CompHashT compHashStep(CompHashT h, unsigned int x)
+{
+    h = (h ^ x) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
 //
 //  the identifier of the components
 //  identifier for (truly) binary clauses are not stored, therefore we need
@@ -30,8 +52,8 @@ class CComponentId
 
     unsigned int trueClauseCount;
 
-    long unsigned int hashKeyVars;
-    long unsigned int hashKeyCls;
+    CompHashT hashKeyVars;
+    CompHashT hashKeyCls;
 
 public:
 
@@ -39,10 +61,14 @@ public:
     ///  cachedChildren may be nonempty only if cachedAs == NIL_ENTRY
     ///  if cachedAS != NIL_ENTRY then this component has been cached and
     ///  its descendants can be found in xFormulaCache.entry(cachedAs).theDescendants
-    unsigned int cachedAs;
-    vector<unsigned int> cachedChildren;
+    CacheRefT cachedAs;
+    vector<CacheRefT> cachedChildren;
+
+    /// another thread counts this component if theTask != NULL, the task
+    /// is given up when the component is deleted before its result is taken
+    CComponentTask *theTask;
 
-    void addCachedChildren(const vector<unsigned int> & cc)
+    void addCachedChildren(const vector<CacheRefT> & cc)
     {
         cachedChildren.insert(cachedChildren.end(),cc.begin(),cc.end());
     }
@@ -62,7 +88,7 @@ public:
         theClauses.push_back(cl);
 
         //Compute HashKey
-        if (cl != clsSENTINEL) hashKeyCls = hashKeyCls*7 + cl;
+        if (cl != clsSENTINEL) hashKeyCls = compHashStep(hashKeyCls, cl);
     }
 
     inline void addVar(const VarIdT & var)
@@ -70,13 +96,19 @@ public:
         theVars.push_back(var);
 
         //Compute HashKey
-        if (var != varsSENTINEL) hashKeyVars = hashKeyVars*5 + var;
+        if (var != varsSENTINEL) hashKeyVars = compHashStep(hashKeyVars, var);
 
     }
 
-    long unsigned int getHashKey() const
+    CompHashT getHashKey() const
     {
-        return hashKeyVars + (hashKeyCls<<9);
+        // combine both sequences and finalize (murmur3 fmix64)
+        CompHashT h = hashKeyVars ^ (hashKeyCls * 0xC2B2AE3D27D4EB4FULL);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        return h ^ (h >> 33);
     }
 
 
@@ -86,15 +118,19 @@ public:
         theClauses.clear();
         trueClauseCount = 0;
         cachedAs = 0;
+        hashKeyVars = 0;
+        hashKeyCls = 0;
     }
 
-    CComponentId()
+    CComponentId() : theTask(NULL)
     {
         clear();
-        trueClauseCount = 0;
-        cachedAs = 0;
-        hashKeyVars = 0;
-        hashKeyCls = 0;
+    }
+
+    ~CComponentId()
+    {
+        if (theTask != NULL)
+            abandonTask(theTask);
     }
 
 
@@ -175,65 +211,108 @@ public:
 
 };
 
+/**
+ * the bits per variable and clause id of the packed components of a cache,
+ * they depend on the size of the formula
+ */
+struct CPackLayout
+{
+    unsigned int bpeVars, bpeCls; // bitsperentry
+    unsigned int maskVars, maskCls;
+
+    CPackLayout() : bpeVars(0), bpeCls(0), maskVars(0), maskCls(0)
+    {
+    }
+
+    void adjust(unsigned int maxVarId, unsigned int maxClId)
+    {
+        bpeVars = (unsigned int)ceil(log((double)maxVarId+1)/log(2.0));
+        bpeCls = (unsigned int)ceil(log((double)maxClId+1)/log(2.0));
+
+        maskVars = maskCls = 0;
+        for (unsigned int i=0; i < bpeVars;i++) maskVars = (maskVars<<1) +1;
+        for (unsigned int i=0; i < bpeCls;i++) maskCls = (maskCls<<1) +1;
+    }
+};
+
+/**
+ * the bit packed variables and clauses of a component
+ * the packed blocks are not owned by the object, they live in an arena
+ * (a vector<_T> of its owner) at [theOfs, theOfs + sizeVarVec() + sizeClVec()),
+ * the variables first. Blocks are only ever appended to the arena, the
+ * owner compacts it by moving the blocks of the surviving ids. The owner
+ * also keeps the CPackLayout of its ids.
+ */
 template <class _T, unsigned int _bitsPerBlock = (sizeof(_T)<<3)>
 class CPackedCompId
 {
-    static unsigned int bpeCls, bpeVars; // bitsperentry
-    static unsigned int maskVars,maskCls;
 protected:
-    vector<_T> theVars;
-    vector<_T> theClauses;
+    size_t theOfs;
+    unsigned int nVars;
+    unsigned int nCls;
 
 public:
-    static unsigned int bitsPerVar()
+    unsigned int sizeVarVec(const CPackLayout &rL) const
     {
-        return bpeVars;
+        return (nVars*rL.bpeVars + _bitsPerBlock - 1)/_bitsPerBlock;
     }
-    static unsigned int bitsPerCl()
+    unsigned int sizeClVec(const CPackLayout &rL) const
     {
-        return bpeCls;
+        return (nCls*rL.bpeCls + _bitsPerBlock - 1)/_bitsPerBlock;
     }
 
-    unsigned int sizeVarVec()
+    unsigned int countVars() const
     {
-        return theVars.size();
+        return nVars;
     }
-    unsigned int sizeClVec()
+    unsigned int countCls() const
     {
-        return theClauses.size();
+        return nCls;
     }
 
-    static void adjustPackSize(unsigned int maxVarId, unsigned int maxClId);
+    size_t getOfs() const
+    {
+        return theOfs;
+    }
 
     CPackedCompId()
     {
+        theOfs = 0;
+        clear();
     }
 
-    void createFrom(const CComponentId &rComp);
+    /// appends the packed blocks of rComp to arena
+    void createFrom(const CComponentId &rComp, vector<_T> &arena, const CPackLayout &rL);
 
+    bool equals(const CComponentId &rComp, const _T *arenaBase, const CPackLayout &rL) const;
 
-    bool equals(const CPackedCompId<_T> &rComp) const
+    /// decodes the variables and clauses, without sentinels
+    void unpack(const _T *arenaBase, const CPackLayout &rL,
+                vector<VarIdT> &vars, vector<ClauseIdT> &cls) const;
+
+    /// moves the blocks to newOfs, which must not be behind the current offset
+    void relocate(_T *arenaBase, size_t newOfs, const CPackLayout &rL)
     {
-        return theVars == rComp.theVars
-               && theClauses == rComp.theClauses;
+        if (newOfs != theOfs)
+            memmove(arenaBase + newOfs, arenaBase + theOfs,
+                    (sizeVarVec(rL) + sizeClVec(rL))*sizeof(_T));
+        theOfs = newOfs;
     }
 
-    bool equals(const CComponentId &rComp) const;
-
     void clear()
     {
-        theVars.clear();
-        theClauses.clear();
+        nVars = 0;
+        nCls = 0;
     }
 
     bool empty() const
     {
-        return theVars.empty() && theClauses.empty();
+        return nVars == 0 && nCls == 0;
     }
 
-    int memSize() const
+    int memSize(const CPackLayout &rL) const
     {
-        return (theVars.capacity() + theClauses.capacity())*sizeof(_T);
+        return (sizeVarVec(rL) + sizeClVec(rL))*sizeof(_T);
     }
 
 };
@@ -243,42 +322,20 @@ public:
 /////////////////////////////////////////////////////////////////////////////
 
 template <class _T, unsigned int _bitsPerBlock>
-unsigned int CPackedCompId<_T,_bitsPerBlock>::bpeCls = 0;
-template <class _T, unsigned int _bitsPerBlock>
-unsigned int CPackedCompId<_T,_bitsPerBlock>::bpeVars = 0; // bitsperentry
-template <class _T, unsigned int _bitsPerBlock>
-unsigned int CPackedCompId<_T,_bitsPerBlock>::maskVars = 0;
-template <class _T, unsigned int _bitsPerBlock>
-unsigned int CPackedCompId<_T,_bitsPerBlock>::maskCls = 0; // bitsperentry
-
-template <class _T, unsigned int _bitsPerBlock>
-void CPackedCompId<_T,_bitsPerBlock>::adjustPackSize(unsigned int maxVarId, unsigned int maxClId)
+void CPackedCompId<_T,_bitsPerBlock>::createFrom(const CComponentId &rComp, vector<_T> &arena,
+        const CPackLayout &rL)
 {
-    bpeVars = (unsigned int)ceil(log((double)maxVarId+1)/log(2.0));
-    bpeCls = (unsigned int)ceil(log((double)maxClId+1)/log(2.0));
+    const unsigned int bpeVars = rL.bpeVars, bpeCls = rL.bpeCls;
 
-    maskVars = maskCls = 0;
-    for (unsigned int i=0; i < bpeVars;i++) maskVars = (maskVars<<1) +1;
-    for (unsigned int i=0; i < bpeCls;i++) maskCls = (maskCls<<1) +1;
-}
-
-template <class _T, unsigned int _bitsPerBlock>
-void CPackedCompId<_T,_bitsPerBlock>::createFrom(const CComponentId &rComp)
-{
     vector<VarIdT>::const_iterator it;
     vector<ClauseIdT>::const_iterator jt;
 
-    if (!theVars.empty()) theVars.clear();
-    if (!theClauses.empty()) theClauses.clear();
-
-    theVars.reserve( rComp.countVars()*bpeVars/_bitsPerBlock +1);
-    theClauses.reserve(rComp.countCls()*bpeCls/_bitsPerBlock +1);
+    theOfs = arena.size();
+    nVars = rComp.countVars();
+    nCls = rComp.countCls();
 
     unsigned int bitpos = 0;
     unsigned int h = 0;
-    _T * pBack;
-
-    pBack = &theVars.front();
 
     for (it = rComp.varsBegin(); *it != varsSENTINEL;it++)
     {
@@ -288,18 +345,14 @@ void CPackedCompId<_T,_bitsPerBlock>::createFrom(const CComponentId &rComp)
         if (bitpos >= _bitsPerBlock)
         {
             bitpos -= _bitsPerBlock;
-#ifdef DEBUG
-            assert(theVars.size() < theVars.capacity());
-#endif
-            theVars.push_back(h);
+            arena.push_back(h);
             h = ((*it)>> (bpeVars - bitpos));
         }
     }
-    if (bitpos > 0) theVars.push_back(h);
+    if (bitpos > 0) arena.push_back(h);
 
     bitpos = 0;
     h = 0;
-    pBack = &theClauses.front();
     for (jt = rComp.clsBegin(); *jt != clsSENTINEL;jt++)
     {
         h |= ((*jt)<< (bitpos));
@@ -308,29 +361,32 @@ void CPackedCompId<_T,_bitsPerBlock>::createFrom(const CComponentId &rComp)
         if (bitpos >= _bitsPerBlock)
         {
             bitpos -= _bitsPerBlock;
-#ifdef DEBUG
-            assert(theClauses.size() < theClauses.capacity());
-#endif
-            theClauses.push_back(h);
+            arena.push_back(h);
             h = ((*jt)>> (bpeCls - bitpos));
         }
     }
-    if (bitpos > 0) theClauses.push_back(h);
+    if (bitpos > 0) arena.push_back(h);
+
+#ifdef DEBUG
+    assert(arena.size() == theOfs + sizeVarVec(rL) + sizeClVec(rL));
+#endif
 }
 
 
 template <class _T, unsigned int _bitsPerBlock>
-bool CPackedCompId<_T,_bitsPerBlock>::equals(const CComponentId &rComp) const
+bool CPackedCompId<_T,_bitsPerBlock>::equals(const CComponentId &rComp, const _T *arenaBase,
+        const CPackLayout &rL) const
 {
+    const unsigned int bpeVars = rL.bpeVars, bpeCls = rL.bpeCls;
+    const unsigned int maskVars = rL.maskVars, maskCls = rL.maskCls;
 
-    if ( (theVars.capacity() !=  (unsigned int) rComp.countVars()*bpeVars/_bitsPerBlock +1)
-            || theClauses.capacity() != (unsigned int) rComp.countCls()*bpeCls/_bitsPerBlock +1) return false;
+    if (nVars != rComp.countVars() || nCls != rComp.countCls()) return false;
 
     unsigned int bitpos = 0;
     unsigned int h = 0;
     const _T * pItA;
 
-    pItA = &theVars.front();
+    pItA = arenaBase + theOfs;
 
     for (vector<VarIdT>::const_iterator it = rComp.varsBegin(); *it != varsSENTINEL;it++)
     {
@@ -340,13 +396,14 @@ bool CPackedCompId<_T,_bitsPerBlock>::equals(const CComponentId &rComp) const
         {
             bitpos -= _bitsPerBlock;
             pItA++;
-            h |= ((*pItA)<< (bpeVars - bitpos));
+            // the next block only holds bits of this id if it did not end exactly
+            if (bitpos > 0) h |= ((*pItA)<< (bpeVars - bitpos));
         }
         if (*it != (maskVars & h)) return false;
     }
 
     bitpos = 0;
-    pItA = &theClauses.front();
+    pItA = arenaBase + theOfs + sizeVarVec(rL);
     for (vector<ClauseIdT>::const_iterator jt = rComp.clsBegin(); *jt != clsSENTINEL;jt++)
     {
         h = (*pItA)>> (bitpos);
@@ -356,7 +413,7 @@ bool CPackedCompId<_T,_bitsPerBlock>::equals(const CComponentId &rComp) const
         {
             bitpos -= _bitsPerBlock;
             pItA++;
-            h |= ((*pItA)<< (bpeCls - bitpos));
+            if (bitpos > 0) h |= ((*pItA)<< (bpeCls - bitpos));
         }
         if (*jt != (maskCls & h)) return false;
     }
@@ -366,6 +423,47 @@ bool CPackedCompId<_T,_bitsPerBlock>::equals(const CComponentId &rComp) const
 
 }
 
+template <class _T, unsigned int _bitsPerBlock>
+void CPackedCompId<_T,_bitsPerBlock>::unpack(const _T *arenaBase, const CPackLayout &rL,
+        vector<VarIdT> &vars, vector<ClauseIdT> &cls) const
+{
+    const unsigned int bpeVars = rL.bpeVars, bpeCls = rL.bpeCls;
+    const unsigned int maskVars = rL.maskVars, maskCls = rL.maskCls;
+    unsigned int bitpos = 0;
+    unsigned int h = 0;
+    const _T * pItA = arenaBase + theOfs;
+
+    vars.clear();
+    for (unsigned int i = 0; i < nVars; i++)
+    {
+        h = ((*pItA)>> (bitpos));
+        bitpos+= bpeVars;
+        if (bitpos >= _bitsPerBlock)
+        {
+            bitpos -= _bitsPerBlock;
+            pItA++;
+            if (bitpos > 0) h |= ((*pItA)<< (bpeVars - bitpos));
+        }
+        vars.push_back(maskVars & h);
+    }
+
+    bitpos = 0;
+    pItA = arenaBase + theOfs + sizeVarVec(rL);
+    cls.clear();
+    for (unsigned int i = 0; i < nCls; i++)
+    {
+        h = (*pItA)>> (bitpos);
+        bitpos += bpeCls;
+        if (bitpos >= _bitsPerBlock)
+        {
+            bitpos -= _bitsPerBlock;
+            pItA++;
+            if (bitpos > 0) h |= ((*pItA)<< (bpeCls - bitpos));
+        }
+        cls.push_back(maskCls & h);
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //END Implementation CPackedCompId
 /////////////////////////////////////////////////////////////////////////////
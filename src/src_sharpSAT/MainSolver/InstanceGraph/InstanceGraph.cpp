@@ -2,13 +2,147 @@
 #include <math.h>
 #include<fstream>
 #include<stdio.h>
-#include<limits>
-#include<sstream>
+#include<string.h>
+#include<ctype.h>
+#include<limits.h>
+
+#include <InputReader.h>
+#include <SomeTime.h>
+
+#include "BinaryCnf.h"
 
 using std::ios;
 using std::string;
 
-CRunAnalyzer theRunAn;
+// BEGIN DIMACS tokenizing helpers, these work directly on the bytes of the input
+
+static inline const char *findEndOfLine(const char *pos, const char *end)
+{
+	const char *eol = (const char *) memchr(pos, '\n', end - pos);
+	return (eol == NULL) ? end : eol;
+}
+
+static inline const char *skipLine(const char *pos, const char *end)
+{
+	pos = findEndOfLine(pos, end);
+	return (pos == end) ? end : pos + 1;
+}
+
+// A number beyond INT_MAX is no int either: pos is then left on it,
+//  see isDimacsNumber.
+static inline bool readDimacsInt(const char *&pos, const char *end, int &val)
+{
+	while (pos < end && isspace((unsigned char) *pos))
+		pos++;
+
+	const char *start = pos;
+	bool neg = false;
+	if (pos < end && (*pos == '-' || *pos == '+'))
+		neg = (*pos++ == '-');
+
+	if (pos == end || !isdigit((unsigned char) *pos))
+		return false;
+
+	int v = 0;
+	while (pos < end && isdigit((unsigned char) *pos))
+	{
+		int digit = *pos++ - '0';
+		if (v > (INT_MAX - digit) / 10)
+		{
+			pos = start;
+			return false;
+		}
+		v = v * 10 + digit;
+	}
+
+	val = neg ? -v : v;
+	return true;
+}
+
+// after readDimacsInt failed: was it on a number out of range
+static inline bool isDimacsNumber(const char *pos, const char *end)
+{
+	if (pos < end && (*pos == '-' || *pos == '+'))
+		pos++;
+	return pos < end && isdigit((unsigned char) *pos);
+}
+
+static inline bool readDimacsUInt(const char *&pos, const char *end, unsigned int &val)
+{
+	int v;
+	if (!readDimacsInt(pos, end, v) || v < 0)
+		return false;
+	val = v;
+	return true;
+}
+
+static inline bool readDimacsReal(const char *&pos, const char *end, CRealNum &val)
+{
+	while (pos < end && isspace((unsigned char) *pos))
+		pos++;
+
+	const char *token = pos;
+	while (pos < end && !isspace((unsigned char) *pos))
+		pos++;
+
+	return pos > token && from_stringT(val, string(token, pos).c_str());
+}
+
+// reads a "c p weight Lit W 0" line, or a cachet style "w Var P" line, that
+//  gives Var the weight P and -Var the weight 1-P (P = -1: both weigh 1).
+//  Returns false if the line is no weight line, err is set if it is a
+//  malformed one.
+static bool readWeightLine(const char *pos, const char *eol, unsigned int nLine,
+		vector<int> &weightLits, vector<CRealNum> &weightVals, string &err)
+{
+	int lit, zero;
+	CRealNum w;
+
+	if (eol - pos >= 10 && strncmp(pos, "c p weight", 10) == 0)
+	{
+		pos += 10;
+		if (!readDimacsInt(pos, eol, lit) || lit == 0 || !readDimacsReal(pos, eol, w)
+				|| (readDimacsInt(pos, eol, zero) && zero != 0))
+		{
+			err = "line " + std::to_string(nLine)
+					+ ": failed reading weight line, expected c p weight Lit Weight 0";
+			return true;
+		}
+		weightLits.push_back(lit);
+		weightVals.push_back(w);
+		return true;
+	}
+
+	if (eol - pos >= 2 && pos[0] == 'w' && isspace((unsigned char) pos[1]))
+	{
+		pos++;
+		if (!readDimacsInt(pos, eol, lit) || lit <= 0 || !readDimacsReal(pos, eol, w))
+		{
+			err = "line " + std::to_string(nLine)
+					+ ": failed reading weight line, expected w Var Probability";
+			return true;
+		}
+		if (w == -1)
+		{
+			weightLits.push_back(lit);
+			weightVals.push_back(1);
+			weightLits.push_back(-lit);
+			weightVals.push_back(1);
+		}
+		else
+		{
+			weightLits.push_back(lit);
+			weightVals.push_back(w);
+			weightLits.push_back(-lit);
+			weightVals.push_back(1 - w);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+// END DIMACS tokenizing helpers
 
 // class constructor
 CInstanceGraph::CInstanceGraph()
@@ -113,7 +247,7 @@ bool CInstanceGraph::createConflictClause(const vector<LiteralIdT> &theCClause)
 			printCClstats();
 		getVar(theCClause.front()).scoreVSIDS[theCClause.front().polarity()]++;
 		getVar(theCClause.front()).scoreVSIDS[theCClause.front().oppositeLit().polarity()]++;
-		theRunAn.addClause();
+		theRunAn().addClause();
 		return true;
 	}
 
@@ -129,7 +263,7 @@ bool CInstanceGraph::createConflictClause(const vector<LiteralIdT> &theCClause)
 
 		if (numBinCCls % 100 == 0)
 			printCClstats();
-		theRunAn.addClause();
+		theRunAn().addClause();
 		return true;
 	}
 
@@ -197,7 +331,7 @@ bool CInstanceGraph::createConflictClause(const vector<LiteralIdT> &theCClause)
 
 	if (countCCls() % 10000 == 0)
 		printCClstats();
-	theRunAn.addClause();
+	theRunAn().addClause();
 	return true;
 }
 
@@ -338,7 +472,7 @@ bool CInstanceGraph::deleteConflictCls()
 		if (it->length() != 0)
 			vgl /= pow((double) it->length(), 3);
 
-		if (CStepTime::getTime() - it->getLastTouchTime() > vgl)
+		if (theStepTime.getTime() - it->getLastTouchTime() > vgl)
 		{
 			markCClDeleted(toClauseIdT(it));
 		}
@@ -510,6 +644,8 @@ bool CInstanceGraph::prep_CleanUpPool()
 			if (ctWrite != ct)
 			{
 				*ctWrite = *ct;
+				theClauseOrigins[ctWrite - theClauses.begin()]
+						= theClauseOrigins[ct - theClauses.begin()];
 				prep_substituteClauses(
 						(unsigned int) (ct - theClauses.begin()),
 						(unsigned int) (ctWrite - theClauses.begin()));
@@ -518,6 +654,7 @@ bool CInstanceGraph::prep_CleanUpPool()
 		}
 
 	theClauses.erase(ctWrite, theClauses.end());
+	theClauseOrigins.resize(theClauses.size());
 	iOfsBeginConflictClauses = theClauses.size();
 	///////////////////
 	// clean up LitVector
@@ -599,6 +736,14 @@ bool CInstanceGraph::prep_CleanUpPool()
 			it++;
 		}
 
+	// the variables behind the last one with clauses have none either, their
+	//  offsets would point behind the end of theInClsVector
+	for (; it != theVars.end(); it++)
+	{
+		it->setInClsVecOfs(false, 0);
+		it->setInClsVecOfs(true, 1);
+	}
+
 	theInClsVector.resize((unsigned int) (cltWrite - theInClsVector.begin()));
 
 	theUnitClauses.clear();
@@ -618,14 +763,223 @@ bool CInstanceGraph::prep_CleanUpPool()
 	return true;
 }
 
-bool CInstanceGraph::createfromFile(const char* lpstrFileName)
+bool CInstanceGraph::readCNF(const char* lpstrFileName, unsigned int &nVars,
+		unsigned int &nCls, vector<int> &litVec, vector<CRealNum> &litWeights,
+		CnfParseInfo &info, string &err)
 {
     unsigned int nLine = 0;
-	unsigned int nVars, nCls;
 	int lit;
+	int clauseLen = 0;
+
+	// the weight lines in the order of the file
+	vector<int> weightLits;
+	vector<CRealNum> weightVals;
+
+	litVec.clear();
+	litWeights.clear();
+
+	///BEGIN File input
+	CStopWatch parseWatch;
+	parseWatch.markStartTime();
+
+	// binary cnf files are loaded with bulk copies, no tokenizing needed
+	CMappedFile rawFile;
+	if (!rawFile.open(lpstrFileName))
+	{
+		err = string("Error opening file ") + lpstrFileName;
+		return false;
+	}
+	if (isBinaryCnf(rawFile.begin(), rawFile.size()))
+	{
+		if (!readBinaryCnf(rawFile.begin(), rawFile.size(), nVars, nCls, litVec, err))
+		{
+			err = string(lpstrFileName) + ": " + err;
+			return false;
+		}
+		parseWatch.markStopTime();
+		info.textMBytes = info.fileMBytes = rawFile.size() / (1024.0 * 1024.0);
+		info.seconds = parseWatch.getElapsedTime();
+		info.compressed = false;
+		info.binary = true;
+		return true;
+	}
+	rawFile.close();
+
+	CInputReader inFile;
+	if (!inFile.open(lpstrFileName))
+	{
+		err = inFile.getError();
+		return false;
+	}
+
+	const char *pos;
+	const char *end;
+	const char *eol;
+
+	bool readingHeader = true;
+	bool inClause = false;
+	bool clauseEnded;
+
+	nVars = nCls = 0;
+
+	while (inFile.nextWindow(pos, end))
+	{
+		// read the preamble of the cnf file
+		while (readingHeader && pos < end)
+		{
+			eol = findEndOfLine(pos, end);
+			nLine++;
+			if (eol - pos >= 5 && strncmp(pos, "p cnf", 5) == 0)
+			{
+				pos += 5;
+				if (!readDimacsUInt(pos, eol, nVars) || !readDimacsUInt(pos, eol, nCls))
+				{
+					err = "line " + std::to_string(nLine)
+							+ ": failed reading cnf header line, expected p cnf Vars Clauses";
+					return false;
+				}
+				readingHeader = false;
+				// roughly one literal per four bytes of text
+				if (inFile.getFormat() == CInputReader::IF_PLAIN)
+					litVec.reserve(inFile.getFileSize() / 4);
+			}
+			else if (!readWeightLine(pos, eol, nLine, weightLits, weightVals, err)
+					&& (pos == eol || *pos != 'c'))
+				toERROUT("line " << nLine << ": problem line, expected comment c ... or p cnf Vars Clauses" << endl);
+			if (!err.empty())
+				return false;
+			pos = skipLine(eol, end);
+		}
+
+		// now read the data
+		while (pos < end)
+		{
+			if (inClause || isdigit((unsigned char) *pos) || *pos == '-')
+			{
+				// parse clause (begins with (negative) digit)
+				inClause = true;
+				clauseEnded = false;
+				while (readDimacsInt(pos, end, lit))
+				{
+					if (lit == 0)
+					{
+						clauseEnded = true;
+						break;
+					}
+					if ((unsigned int) abs(lit) > nVars)
+					{
+						err = "line " + std::to_string(nLine + 1) + ": literal " + std::to_string(lit)
+								+ " beyond the " + std::to_string(nVars) + " variables of the header";
+						return false;
+					}
+					clauseLen++;
+					litVec.push_back(lit);
+				}
+				if (!clauseEnded && isDimacsNumber(pos, end))
+				{
+					err = "line " + std::to_string(nLine + 1)
+							+ ": literal out of range";
+					return false;
+				}
+				// the clause continues in the next window
+				if (!clauseEnded && pos == end && !inFile.atEnd())
+					break;
+
+				if (clauseLen > 0)
+					litVec.push_back(0);
+				clauseLen = 0;
+				inClause = false;
+				pos = skipLine(pos, end); // skip till next line
+				nLine++;
+			}
+			else if (!isspace((unsigned char) *pos)) // if whitespace, we eat it instead
+			{
+				// no digit (or whitespace) so we skip the line, unless it
+				//  is a weight line
+				if (readWeightLine(pos, findEndOfLine(pos, end), nLine + 1,
+						weightLits, weightVals, err) && !err.empty())
+					return false;
+				pos = skipLine(pos, end);
+				nLine++;
+			}
+			else
+				pos++;
+		}
+	}
+
+	if (inFile.failed())
+	{
+		err = string(lpstrFileName) + ": " + inFile.getError();
+		return false;
+	}
+
+	parseWatch.markStopTime();
+	info.textMBytes = inFile.getTextSize() / (1024.0 * 1024.0);
+	info.fileMBytes = inFile.getFileSize() / (1024.0 * 1024.0);
+	info.seconds = parseWatch.getElapsedTime();
+	info.compressed = (inFile.getFormat() != CInputReader::IF_PLAIN);
+	info.binary = false;
+	inFile.close();
+	/// END FILE input
+
+	if (!weightLits.empty())
+	{
+		litWeights.resize(2 * (nVars + 1), 1);
+		for (unsigned int i = 0; i < weightLits.size(); i++)
+		{
+			if ((unsigned int) abs(weightLits[i]) > nVars)
+			{
+				err = string(lpstrFileName) + ": weight of literal " + std::to_string(weightLits[i])
+						+ ", but the cnf has " + std::to_string(nVars) + " variables";
+				return false;
+			}
+			litWeights[LiteralIdT(weightLits[i]).toUInt()] = weightVals[i];
+		}
+	}
+
+	return true;
+}
+
+bool CInstanceGraph::createfromFile(const char* lpstrFileName, string &err)
+{
+	unsigned int nVars, nCls;
 	vector<int> litVec;
+	vector<CRealNum> litWeights;
+	CnfParseInfo info;
+
+	if (!readCNF(lpstrFileName, nVars, nCls, litVec, litWeights, info, err))
+		return false;
+
+	for (unsigned int i = 0; i < theCube.size(); i++)
+	{
+		litVec.push_back(theCube[i]);
+		litVec.push_back(0);
+		nCls++;
+	}
+
+	createfromClauses(nVars, nCls, litVec);
+
+	theLitWeights.swap(litWeights);
+
+	// the parse stats are recorded after createfromClauses has reset theRunAn
+	theRunAn().setValue(PARSE_MBYTES, info.textMBytes);
+	theRunAn().setValue(PARSE_TIME, info.seconds);
+	if (info.compressed)
+		theRunAn().setValue(PARSE_COMPRESSED_MBYTES, info.fileMBytes);
+	if (info.seconds > 0.0)
+	{
+		theRunAn().setValue(PARSE_MBPERSEC, info.textMBytes / info.seconds);
+		if (info.compressed)
+			theRunAn().setValue(PARSE_COMPRESSED_MBPERSEC, info.fileMBytes / info.seconds);
+	}
+
+	return true;
+}
+
+bool CInstanceGraph::createfromClauses(unsigned int nVars, unsigned int nCls,
+		vector<int> &litVec)
+{
 	vector<TriValue> seenV;
-	int clauseLen = 0;
 	TriValue pol;
 
 	vector<int> varPosMap;
@@ -634,70 +988,7 @@ bool CInstanceGraph::createfromFile(const char* lpstrFileName)
 	reset(); // clear everything
 	// END INIT
 
-	///BEGIN File input
-	FILE *filedesc;
-	filedesc = fopen(lpstrFileName, "r");
-	if (filedesc == NULL)
-	{
-		toERROUT(" Error opening file "<< lpstrFileName<<endl);
-		exit(3);
-	}
-	fclose(filedesc);
-
-	ifstream inFile(lpstrFileName, ios::in);
-    string line;
-    string nextWord;
-
-    // read the preamble of the cnf file
-    while(std::getline(inFile, line))
-    {
-        nLine++;
-        if (line.compare(0, 5, "p cnf") == 0)
-        {
-            std::stringstream linestream(line);
-            linestream >> nextWord; // eat 'p'
-            linestream >> nextWord; // eat 'cnf'
-            if(!(linestream >> nVars) || !(linestream >> nCls))
-            {
-                toERROUT("line "<<nLine<<": failed reading cnf header line, expected p cnf Vars Clauses"<<endl);
-                exit(3);
-            }
-            break;
-        }
-        else if (line[0] != 'c')
-            toERROUT("line " << nLine << ": problem line, expected comment c ... or p cnf Vars Clauses" << endl);
-    }
-
-    originalVarCount = nVars;
-    char firstChar;
-    // now read the data
-    while (inFile >> firstChar)
-    {
-        if(isdigit(firstChar) || firstChar == '-')
-        {
-            inFile.unget();
-            // parse clause (begins with (negative) digit)
-            while((inFile >> lit) && lit != 0)
-            {
-                clauseLen++;
-                litVec.push_back(lit);
-            }
-            if (clauseLen > 0)
-                litVec.push_back(0);
-            clauseLen = 0;
-            inFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // skip till next line
-            nLine++;
-        }
-        else if (!isspace(firstChar)) // if whitespace, we eat it instead
-        {
-            // no digit (or whitespace) so we skip the line
-            inFile.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
-            nLine++;
-        }
-    }
-
-    inFile.close();
-    /// END FILE input
+	originalVarCount = nVars;
 
 
 	vector<int>::iterator it, jt, itEndCl;
@@ -719,7 +1010,20 @@ bool CInstanceGraph::createfromFile(const char* lpstrFileName)
 	varUntranslation.reserve(nVars + 1);
 	origTranslation.reserve(nVars + 1);
 
-	theRunAn.init(nVars, nCls);
+	theRunAn().init(nVars, nCls);
+
+	// the fingerprint covers every clause with more than one literal,
+	// before duplicate literals are removed below
+	iFormulaFingerprint = 0;
+	for (it = litVec.begin(); it != litVec.end(); it = jt + 1)
+	{
+		for (jt = it; *jt != 0; jt++);
+		if (jt - it < 2)
+			continue;
+		for (; it != jt; it++)
+			iFormulaFingerprint = compHashStep(iFormulaFingerprint, (unsigned int) *it);
+		iFormulaFingerprint = compHashStep(iFormulaFingerprint, 0);
+	}
 
 	vector<vector<ClauseIdT> > _inClLinks[2];
 
@@ -823,6 +1127,7 @@ bool CInstanceGraph::createfromFile(const char* lpstrFileName)
 				}
 #endif
 				idCl = makeClause();
+				theClauseOrigins.push_back(iNonUnitClauses + 1);
 				getClause(idCl).setLitOfs(theLitVector.size());
 
 				theLitVector.push_back(LitA);
@@ -867,6 +1172,9 @@ bool CInstanceGraph::createfromFile(const char* lpstrFileName)
 
 		}
 
+		if (itEndCl - it >= 2)
+			iNonUnitClauses++;
+
 		// undo the entries in seenV
 		for (jt = it; jt != itEndCl; jt++)
 			seenV[abs(*jt)] = X;
@@ -906,7 +1214,7 @@ bool CInstanceGraph::createfromFile(const char* lpstrFileName)
 	theUClLookUp.resize(theVars.size() + 1, X);
 	iOfsBeginConflictClauses = theClauses.size();
 
-	theRunAn.setUsedVars(countAllVars());
+	theRunAn().setUsedVars(countAllVars());
 
 	// Store the original translation
 	origTranslation.clear();
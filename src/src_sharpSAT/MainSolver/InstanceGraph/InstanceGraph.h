@@ -3,6 +3,7 @@
 
 #include<vector>
 #include<deque>
+#include<string>
 
 #ifdef DEBUG
 #include <assert.h>
@@ -12,13 +13,24 @@
 #include <Interface/AnalyzerData.h>
 
 #include "../../Basics.h"
+#include "../../SolverContext.h"
 #include "AtomsAndNodes.h"
 #include "ComponentTypes.h"
 
+using std::string;
+
 typedef vector<CClauseVertex> DepositOfClauses;
 typedef vector<CVariableVertex> DepositOfVars;
 
-extern CRunAnalyzer theRunAn;
+/// what reading a cnf file cost, see CInstanceGraph::readCNF
+struct CnfParseInfo
+{
+	double textMBytes;
+	double fileMBytes;
+	double seconds;
+	bool compressed;
+	bool binary;
+};
 
 class CInstanceGraph
 {
@@ -50,8 +62,26 @@ class CInstanceGraph
 	vector<unsigned> varUntranslation;
 	vector<unsigned> origTranslation;
 
+	/// for every original clause: its position (counting from 1) among the
+	/// input clauses with more than one literal, see getClauseOrigin
+	vector<unsigned int> theClauseOrigins;
+	unsigned int iNonUnitClauses;
+
+	/// hash of the input clauses with more than one literal
+	uint64_t iFormulaFingerprint;
+
+	/// the weight of every literal of the input at LiteralIdT(lit).toUInt(),
+	/// empty if the cnf has no weight lines
+	vector<CRealNum> theLitWeights;
+
+	/// literals createfromFile adds to the input as unit clauses
+	vector<int> theCube;
+
 protected:
 
+	// the decisions so far, the clock of the conflict clause deletion
+	CStepTime theStepTime;
+
 	vector<LiteralIdT> theUnitClauses;
 	vector<TriValue> theUClLookUp;
 
@@ -68,6 +98,11 @@ protected:
 		theClauses.push_back(CClauseVertex(false));
 		iOfsBeginConflictClauses = 0;
 
+		theClauseOrigins.clear();
+		theClauseOrigins.push_back(0);
+		iNonUnitClauses = 0;
+		iFormulaFingerprint = 0;
+
 		theVars.clear();
 		theVars.push_back(CVariableVertex(0, 0)); //initializing the Sentinel
 		theConflicted.clear();
@@ -81,6 +116,8 @@ protected:
 		varTranslation.clear();
 		varUntranslation.clear();
 		origTranslation.clear();
+
+		theLitWeights.clear();
 	}
 
 	void doVSIDSScoreDiv()
@@ -186,6 +223,48 @@ public:
 		return origTranslation;
 	}
 
+	/// the number of a clause that does not depend on the unit clauses of
+	/// the input; only defined for original (not conflict) clauses
+	unsigned int getClauseOrigin(ClauseIdT idCl) const
+	{
+		return theClauseOrigins[idCl];
+	}
+
+	unsigned int countNonUnitClauses() const
+	{
+		return iNonUnitClauses;
+	}
+
+	/// identifies the input formula up to its unit clauses
+	uint64_t getFormulaFingerprint() const
+	{
+		return iFormulaFingerprint;
+	}
+
+	/// true if the cnf has weight lines, see readCNF
+	bool isWeighted() const
+	{
+		return !theLitWeights.empty();
+	}
+
+	/// the literal weights over the variables of the input
+	const vector<CRealNum> & getLitWeights() const
+	{
+		return theLitWeights;
+	}
+
+	/// weighs lit like a weight line of the cnf would, after the formula
+	/// is created; false if lit is no literal of it
+	bool setLitWeight(int lit, const CRealNum &weight)
+	{
+		if (lit == 0 || (unsigned int) abs(lit) > originalVarCount)
+			return false;
+		if (theLitWeights.empty())
+			theLitWeights.resize(2 * (originalVarCount + 1), 1);
+		theLitWeights[LiteralIdT(lit).toUInt()] = weight;
+		return true;
+	}
+
 	/////////////////////////////////////////////////////////
 	// BEGIN access to variables and clauses
 	inline vector<ClauseIdT>::const_iterator var_InClsBegin(VarIdT VarIndex) const
@@ -334,7 +413,29 @@ public:
 
 	// END count something
 
-	bool createfromFile(const char* lpstrFileName);
+	/// reads the clauses of a text, compressed or binary cnf file into litVec,
+	/// each clause is terminated by a 0. The weights of "c p weight Lit W 0"
+	/// and cachet style "w Var P" lines go to litWeights, at
+	/// LiteralIdT(lit).toUInt(); a literal without a weight line weighs 1.
+	/// litWeights stays empty if the file has no weight lines. Returns false
+	/// with err set if the file can not be read.
+	static bool readCNF(const char* lpstrFileName, unsigned int &nVars,
+			unsigned int &nCls, vector<int> &litVec, vector<CRealNum> &litWeights,
+			CnfParseInfo &info, string &err);
+
+	bool createfromFile(const char* lpstrFileName, string &err);
+
+	/// restricts the formulas createfromFile reads to their models in
+	/// which all of lits hold, lits are added as unit clauses
+	void setCube(const vector<int> &lits)
+	{
+		theCube = lits;
+	}
+
+	/// builds the instance from clauses in the litVec layout of readCNF,
+	/// litVec is modified (duplicate literals are zeroed)
+	bool createfromClauses(unsigned int nVars, unsigned int nCls,
+			vector<int> &litVec);
 
 	void convertComponent(CComponentId &oldComp, vector<int> * newComp);
 
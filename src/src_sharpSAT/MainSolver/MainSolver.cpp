@@ -3,8 +3,64 @@
 CMainSolver::CMainSolver() :
 	decStack(*this)
 {
-	stopWatch.setTimeBound(CSolverConf::secsTimeBound);
+	stopWatch.setTimeBound(theConf().secsTimeBound);
 	remPoll = 0;
+	nnf_node_count = -1;
+	thePool = NULL;
+	theTask = NULL;
+}
+
+// the hash table of a task starts small, most components are small
+#define TASK_CACHE_BITS 12
+
+CMainSolver::CMainSolver(CMainSolver &parent, const CComponentId &comp) :
+	CInstanceGraph(parent), decStack(*this), stopWatch(parent.stopWatch),
+			xFormulaCache(TASK_CACHE_BITS)
+{
+	remPoll = 0;
+	nnf_node_count = -1;
+	thePool = parent.thePool;
+	theTask = NULL;
+	ancestorCaches = parent.ancestorCaches;
+	ancestorCaches.push_back(&parent.xFormulaCache);
+
+	compile_mode = parent.compile_mode;
+	bdg_var_count = parent.bdg_var_count;
+	enable_DT_recording = parent.enable_DT_recording;
+
+	// the literal nodes stay in the arena of the first solver
+	litNodes = parent.litNodes;
+
+	solverLitWeights = parent.solverLitWeights;
+	solverVarWeights = parent.solverVarWeights;
+	priorityVars = parent.priorityVars;
+
+	// the assignment of parent can not be undone here
+	for (VarIdT v = 1; v <= countAllVars(); v++)
+		if (!getVar(v).isActive())
+		{
+			bool val = getVar(v).getboolVal();
+			AntecedentT ant = getVar(v).getAntecedent();
+			getVar(v).unsetVal();
+			getVar(v).setVal(val, 0, ant);
+		}
+
+	// the clock starts over, the conflict clauses of parent look recent to
+	//  the task and are not deleted under it
+	theStepTime.makeStart();
+
+	decStack.init(dtArena, countAllVars());
+	decStack.TOSRefComp() = comp;
+	decStack.TOSRefComp().cachedAs = 0;
+	decStack.TOSRefComp().cachedChildren.clear();
+	decStack.TOSRefComp().theTask = NULL;
+
+	xFormulaCache.init();
+	xFormulaCache.setMaxMemory(theConf().maxCacheSize / theConf().nThreads);
+	xFormulaCache.setPackLayout(parent.xFormulaCache.packLayout());
+
+	bcpImplQueue.reserve(countAllVars());
+	componentSearchStack.reserve(countAllVars() + 2);
 }
 
 // class destructor
@@ -13,20 +69,84 @@ CMainSolver::~CMainSolver()
 	toDEBUGOUT("removed. Poll: " << remPoll << endl);
 }
 
+void CMainSolver::releaseDecisionTree()
+{
+	// every node of the d-DNNF (and of the cache file) lives in the arena
+	dtArena.clear();
+
+	litNodes.clear();
+	dirtyLitNodes.clear();
+	backbones.clear();
+
+	nnf_node_count = -1;
+	dagEval.clear();
+}
+
+CDAGEvaluator & CMainSolver::dagEvaluator()
+{
+	if (dagEval.empty())
+	{
+		if (decStack.top().getOverallSols() == 0)
+			dagEval.buildFalse(bdg_var_count);
+		else
+			dagEval.build(dtArena, decStack.top().getDTNode(), bdg_var_count);
+	}
+	return dagEval;
+}
+
+bool CMainSolver::pickCubeVars(const char *lpstrFileName, unsigned int k,
+		vector<int> &vars)
+{
+	string err;
+
+	vars.clear();
+
+	stopWatch.markStartTime();
+	releaseDecisionTree();
+
+	if (!createfromFile(lpstrFileName, err))
+	{
+		toERROUT(" "<< err<<endl);
+		return false;
+	}
+	decStack.init(dtArena, countAllVars());
+	theStepTime.makeStart();
+
+	if (!performPreProcessing())
+		return true;
+
+	vector<unsigned int> origVar;
+	makeOrigVarMap(origVar);
+
+	// the priority variables first, then the best score
+	vector<pair<pair<int, int>, VarIdT> > ranked;
+	for (VarIdT v = 1; v <= countAllVars(); v++)
+		if (getVar(v).isActive())
+			ranked.push_back(std::make_pair(std::make_pair(
+					(int) priorityVars.count(getVar(v).getVarNum()),
+					vsadsScore(getVar(v))), v));
+
+	sort(ranked.rbegin(), ranked.rend());
+
+	for (unsigned int i = 0; i < k && i < ranked.size(); i++)
+		vars.push_back(origVar[ranked[i].second]);
+	return true;
+}
+
 bool CMainSolver::performPreProcessing()
 {
 	if (!prepBCP())
 	{
-		theRunAn.setExitState(SUCCESS);
+		theRunAn().setExitState(SUCCESS);
 		stopWatch.markStopTime();
 		return false;
 	}
-	if (CSolverConf::allowPreProcessing)
+	if (theConf().allowPreProcessing)
 	{
 		toSTDOUT("BEGIN preprocessing" << endl);
 		if (!prepFindHiddenBackBoneLits())
 		{
-			theRunAn.setExitState(SUCCESS);
+			theRunAn().setExitState(SUCCESS);
 			toSTDOUT("ERR: UNSAT Formula" << endl);
 			stopWatch.markStopTime();
 			return false;
@@ -43,21 +163,40 @@ bool CMainSolver::performPreProcessing()
 	return true;
 }
 
-void CMainSolver::solve(const char *lpstrFileName)
+bool CMainSolver::solve(const char *lpstrFileName)
 {
-	SOLVER_StateT exSt;
+	string err;
 
 	stopWatch.markStartTime();
 
-	num_Nodes = 3;
-	
-	enable_DT_recording = true;
+	if (!createfromFile(lpstrFileName, err))
+	{
+		toERROUT(" "<< err<<endl);
+		return false;
+	}
 
-	createfromFile(lpstrFileName);
+	compileFormula();
+	return true;
+}
+
+void CMainSolver::compile()
+{
+	stopWatch.markStartTime();
+	compileFormula();
+}
+
+void CMainSolver::compileFormula()
+{
+	SOLVER_StateT exSt;
+
+	releaseDecisionTree();
 
-	decStack.init(countAllVars());
+	// a counting only run never builds the d-DNNF
+	enable_DT_recording = !theConf().countOnly;
 
-	CStepTime::makeStart();
+	decStack.init(dtArena, countAllVars());
+
+	theStepTime.makeStart();
 
 	xFormulaCache.init();
 
@@ -67,8 +206,8 @@ void CMainSolver::solve(const char *lpstrFileName)
 	for (int i = 0; i <= originalVarCount; ++i)
 	{
 		//Original:
-		litNodes.push_back(new DTNode(i, true, num_Nodes++));
-		litNodes.push_back(new DTNode(-1 * i, true, num_Nodes++));
+		litNodes.push_back(dtArena.newLit(i));
+		litNodes.push_back(dtArena.newLit(-1 * i));
 	}
 
 	toSTDOUT("#Vars:" << countAllVars() << endl);
@@ -77,17 +216,20 @@ void CMainSolver::solve(const char *lpstrFileName)
 
 	bool needToCount = performPreProcessing();
 
-	theRunAn.setRemovedClauses(theRunAn.getData().nRemovedClauses
-			+ theRunAn.getData().nOriginalClauses - getMaxOriginalClIdx() + 1
+	theRunAn().setRemovedClauses(theRunAn().getData().nRemovedClauses
+			+ theRunAn().getData().nOriginalClauses - getMaxOriginalClIdx() + 1
 			- countBinClauses());
 
 	if (needToCount)
 	{
 		// the following call only correct if bin clauses not used for caching
-		CCacheEntry::adjustPackSize(countAllVars(), getMaxOriginalClIdx());
+		xFormulaCache.adjustPackSize(countAllVars(), getMaxOriginalClIdx());
+
+		if (!cacheFileName.empty() && theConf().allowComponentCaching)
+			loadCacheFile();
 
-		lastTimeCClDeleted = CStepTime::getTime();
-		lastCClCleanUp = CStepTime::getTime();
+		lastTimeCClDeleted = theStepTime.getTime();
+		lastCClCleanUp = theStepTime.getTime();
 		makeCompIdFromActGraph(decStack.TOSRefComp());
 		bcpImplQueue.clear();
 		bcpImplQueue.reserve(countAllVars());
@@ -96,23 +238,57 @@ void CMainSolver::solve(const char *lpstrFileName)
 		// become erroneous due to realloc
 		componentSearchStack.reserve(countAllVars() + 2);
 
+		mapLitWeights();
+
+		// without dynamic decomposition there are no components to share
+		if (theConf().nThreads > 1 && !theConf().disableDynamicDecomp)
+			thePool = new CComponentTaskPool(theConf().nThreads);
+
 		exSt = countSAT();
 
-		theRunAn.setExitState(exSt);
-		theRunAn.setSatCount(decStack.top().getOverallSols());
+		if (thePool != NULL)
+		{
+			abandonOfferedTasks();
+			thePool->join(theRunAn());
+
+			toSTDOUT("Component tasks (offered/taken back/stolen): "
+					<< thePool->countOffered() << "/"
+					<< thePool->countTakenBack() << "/"
+					<< thePool->countStolen() << endl);
+			if (theConf().allowComponentCaching)
+				xFormulaCache.printShardStatistics();
+
+			delete thePool;
+			thePool = NULL;
+		}
+
+		theRunAn().setExitState(exSt);
+		theRunAn().setSatCount(decStack.top().getOverallSols());
+		if (isWeighted())
+			theRunAn().setWeightedCount(finalWeightedCount());
+
+		// the entries of an interrupted run may still be polluted
+		if (!cacheFileName.empty() && theConf().allowComponentCaching
+				&& exSt == SUCCESS)
+			saveCacheFile();
 	}
 	else
 	{
 
-		theRunAn.setExitState(SUCCESS);
-		theRunAn.setSatCount(0.0);
+		theRunAn().setExitState(SUCCESS);
+		theRunAn().setSatCount(0.0);
+		if (isWeighted())
+			theRunAn().setWeightedCount(0.0);
 	}
 
 	stopWatch.markStopTime();
 
-	theRunAn.setElapsedTime(stopWatch.getElapsedTime());
+	theRunAn().setElapsedTime(stopWatch.getElapsedTime());
 
-	xFormulaCache.printStatistics(theRunAn);
+	xFormulaCache.printStatistics(theRunAn());
+
+	if (!enable_DT_recording)
+		return;
 
 	// There may have been some translation done during the preprocessing
 	//  phase, so we translate the bdg literals back.
@@ -128,22 +304,29 @@ void CMainSolver::solve(const char *lpstrFileName)
 		{
 			// Check to make sure that the node hasn't been altered
 			if (bbit->toSignedInt() == get_lit_node(bbit->toSignedInt())->getVal())
-				decStack.top().getCurrentDTNode()->addChild(get_lit_node(bbit->toSignedInt()), true);
+				decStack.top().getCurrentDTNode()->addChild(get_lit_node(bbit->toSignedInt()));
 			else
-				decStack.top().getCurrentDTNode()->addChild(get_lit_node_full(bbit->toSignedInt()), true);
+				decStack.top().getCurrentDTNode()->addChild(get_lit_node_full(bbit->toSignedInt()));
 		}
 	}
 
 	// We compress the tree now that the search is finished
 	decStack.top().getDTNode()->uncheck(2);
-	std::cout << "Uncompressed Edges: " << decStack.top().getDTNode()->count(true) << endl;
+	int nUncompressed = decStack.top().getDTNode()->count(true);
+	toSTDOUT("Uncompressed Edges: " << nUncompressed << endl);
+
+	CStopWatch compressWatch;
+	compressWatch.markStartTime();
 
 	decStack.top().getDTNode()->uncheck(3);
 	decStack.top().getDTNode()->compressNode();
 
+	compressWatch.markStopTime();
+	theRunAn().setValue(DT_COMPRESSTIME, compressWatch.getElapsedTime());
+
 	decStack.top().getDTNode()->uncheck(4);
 	bdg_edge_count = decStack.top().getDTNode()->count(true);
-	std::cout << "Compressed Edges: " << bdg_edge_count << endl;
+	toSTDOUT("Compressed Edges: " << bdg_edge_count << endl);
 	
 	// There may have been some translation done during the file parsing
 	//  phase, so we translate the bdg literals back.
@@ -154,68 +337,182 @@ void CMainSolver::solve(const char *lpstrFileName)
                 litNodes[i]->uncheck(5);
 	translateLiterals(getOrigTranslation());
 	
-	if (CSolverConf::smoothNNF) {
-		// Smooth the d-DNNF (note: this may cause AND-AND parent-children)
-		set<int> literals;
-		decStack.top().getDTNode()->uncheck(6);
-		decStack.top().getDTNode()->smooth(num_Nodes, *this, literals);
-		
-		// See if we've got every literal in the d-DNNF
-		if (2 * originalVarCount == literals.size())
-			return;
-		
-		// TODO: Fix an AND node to the top
-		if (DT_NodeType::kDTAnd != decStack.top().getDTNode()->getType())
-			toSTDOUT("Error: The top node wasn't an AND node.");
-		
-		// Make sure that every literal appears some place
-		DTNode* botNode = new DTNode(DT_NodeType::kDTAnd, num_Nodes++);
-		botNode->botIfy();
-		for (int i = 1; i <= originalVarCount; ++i) {
-		
-			// Check if neither exist
-			if ((literals.find(i) == literals.end()) &&
-				(literals.find(-1 * i) == literals.end())) {
-					
-				// Add an arbitrary choice between the two
-				DTNode* newOr = new DTNode(DT_NodeType::kDTOr, num_Nodes++);
-				newOr->choiceVar = (unsigned) i;
-				decStack.top().getDTNode()->addChild(newOr, true);
-				newOr->addChild(new DTNode(i, true, num_Nodes++), true);
-				newOr->addChild(new DTNode((-1 * i), true, num_Nodes++), true);
-				
-			} else if ((literals.find(i) == literals.end()) && CSolverConf::ensureAllLits) {
-				
-				DTNode* newOr = new DTNode(DT_NodeType::kDTOr, num_Nodes++);
-				DTNode* newAnd = new DTNode(DT_NodeType::kDTAnd, num_Nodes++);
-				
-				get_lit_node_full(-1 * i)->sub_parents(newOr);
-				
-				newOr->addChild(get_lit_node_full(-1 * i), true);
-				newOr->addChild(newAnd, true);
-				newOr->choiceVar = (unsigned) i;
-				
-				newAnd->addChild(new DTNode(i, true, num_Nodes++), true);
-				newAnd->addChild(botNode, true);
-				
-			} else if ((literals.find(-1 * i) == literals.end()) && CSolverConf::ensureAllLits) {
-				
-				DTNode* newOr = new DTNode(DT_NodeType::kDTOr, num_Nodes++);
-				DTNode* newAnd = new DTNode(DT_NodeType::kDTAnd, num_Nodes++);
-				
-				get_lit_node_full(i)->sub_parents(newOr);
-				
-				newOr->addChild(get_lit_node_full(i), true);
-				newOr->addChild(newAnd, true);
-				newOr->choiceVar = (unsigned) i;
-				
-				newAnd->addChild(new DTNode((-1 * i), true, num_Nodes++), true);
-				newAnd->addChild(botNode, true);
+	if (theConf().smoothNNF)
+		smoothDecisionTree();
+
+	if (theConf().mergeNodes)
+		mergeDecisionTree();
+
+	theRunAn().setValue(DT_NODES, dtArena.countNodes());
+	theRunAn().setValue(DT_MEMUSE, dtArena.memoryUsage());
+	theRunAn().setValue(DT_BYTESPERNODE,
+			(double) dtArena.memoryUsage() / dtArena.countNodes());
+}
+
+void CMainSolver::mergeDecisionTree()
+{
+	CStopWatch mergeWatch;
+	mergeWatch.markStartTime();
+
+	DTNode *root = decStack.top().getDTNode();
+
+	// the representative of every node, children are merged first
+	vector<DTNode *> repr(dtArena.countNodes(), NULL);
+	vector<unsigned char> state(dtArena.countNodes(), 0);
+	vector<DTNode *> openList(1, root);
+
+	CDTUniqueTable uniqueTable;
+	uniqueTable.init(dtArena.countNodes());
+
+	unsigned int nNodes = 0, nMerged = 0;
+
+	while (!openList.empty())
+	{
+		DTNode *node = openList.back();
+
+		if (state[node->getID()] == 2)
+		{
+			openList.pop_back();
+			continue;
+		}
+		if (state[node->getID()] == 0)
+		{
+			state[node->getID()] = 1;
+			for (DTNode::ChildIterator it = node->getChildrenBegin(); it
+					!= node->getChildrenEnd(); it++)
+				if (state[(*it)->getID()] == 0)
+					openList.push_back(*it);
+			continue;
+		}
+		openList.pop_back();
+		state[node->getID()] = 2;
+		nNodes++;
+
+		node->mapChildren(repr);
+
+		// the root has to stay where it is
+		repr[node->getID()] = (node == root) ? node : uniqueTable.unique(node);
+		if (repr[node->getID()] != node)
+			nMerged++;
+	}
+
+	decStack.top().getDTNode()->uncheck(7);
+	bdg_edge_count = decStack.top().getDTNode()->count(true);
+
+	mergeWatch.markStopTime();
+
+	toSTDOUT("Merged Nodes: " << nMerged << " of " << nNodes << endl);
+	toSTDOUT("Merged Edges: " << bdg_edge_count << endl);
+
+	theRunAn().setValue(DT_MERGEDNODES, nMerged);
+	theRunAn().setValue(DT_MERGETIME, mergeWatch.getElapsedTime());
+}
+
+void CMainSolver::smoothDecisionTree()
+{
+	// Smooth the d-DNNF (note: this may cause AND-AND parent-children)
+	set<int> literals;
+	vector<vector<int> > nodeVars;
+	decStack.top().getDTNode()->uncheck(6);
+	decStack.top().getDTNode()->smooth(dtArena, *this, nodeVars, literals);
+	
+	// See if we've got every literal in the d-DNNF
+	if (2 * originalVarCount == literals.size())
+		return;
+	
+	// TODO: Fix an AND node to the top
+	if (DT_NodeType::kDTAnd != decStack.top().getDTNode()->getType())
+		toSTDOUT("Error: The top node wasn't an AND node.");
+	
+	// The parents of the literals that get replaced below
+	map<DTNode *, vector<DTNode *> > litParents;
+	if (theConf().ensureAllLits)
+		collectLitParents(litParents);
+
+	// Make sure that every literal appears some place
+	DTNode* botNode = dtArena.newNode(DT_NodeType::kDTAnd);
+	botNode->botIfy();
+	for (int i = 1; i <= originalVarCount; ++i) {
+	
+		// Check if neither exist
+		if ((literals.find(i) == literals.end()) &&
+			(literals.find(-1 * i) == literals.end())) {
 				
-			}
+			// Add an arbitrary choice between the two
+			DTNode* newOr = dtArena.newNode(DT_NodeType::kDTOr);
+			newOr->choiceVar = (unsigned) i;
+			decStack.top().getDTNode()->addChild(newOr);
+			newOr->addChild(dtArena.newLit(i));
+			newOr->addChild(dtArena.newLit((-1 * i)));
+			
+		} else if ((literals.find(i) == literals.end()) && theConf().ensureAllLits) {
+			
+			DTNode* newOr = dtArena.newNode(DT_NodeType::kDTOr);
+			DTNode* newAnd = dtArena.newNode(DT_NodeType::kDTAnd);
+			
+			substituteLit(litParents, get_lit_node_full(-1 * i), newOr);
+			
+			newOr->addChild(get_lit_node_full(-1 * i));
+			newOr->addChild(newAnd);
+			newOr->choiceVar = (unsigned) i;
+			
+			newAnd->addChild(dtArena.newLit(i));
+			newAnd->addChild(botNode);
+			
+		} else if ((literals.find(-1 * i) == literals.end()) && theConf().ensureAllLits) {
+			
+			DTNode* newOr = dtArena.newNode(DT_NodeType::kDTOr);
+			DTNode* newAnd = dtArena.newNode(DT_NodeType::kDTAnd);
+			
+			substituteLit(litParents, get_lit_node_full(i), newOr);
+			
+			newOr->addChild(get_lit_node_full(i));
+			newOr->addChild(newAnd);
+			newOr->choiceVar = (unsigned) i;
+			
+			newAnd->addChild(dtArena.newLit((-1 * i)));
+			newAnd->addChild(botNode);
+			
+		}
+	}
+}
+
+// Records for every literal node of the d-DNNF the nodes it is a child of
+void CMainSolver::collectLitParents(map<DTNode *, vector<DTNode *> > &litParents)
+{
+	vector<bool> seen(dtArena.countNodes(), false);
+	vector<DTNode *> openList(1, decStack.top().getDTNode());
+
+	while (!openList.empty())
+	{
+		DTNode *node = openList.back();
+		openList.pop_back();
+
+		if (seen[node->getID()])
+			continue;
+		seen[node->getID()] = true;
+
+		for (DTNode::ChildIterator it = node->getChildrenBegin(); it
+				!= node->getChildrenEnd(); it++)
+		{
+			if (DT_NodeType::kDTLit == (*it)->getType())
+				litParents[*it].push_back(node);
+			openList.push_back(*it);
 		}
 	}
+}
 
+// Makes newChild the child of every parent of litNode instead of it
+void CMainSolver::substituteLit(map<DTNode *, vector<DTNode *> > &litParents,
+		DTNode *litNode, DTNode *newChild)
+{
+	vector<DTNode *> &parents = litParents[litNode];
+	for (vector<DTNode *>::iterator it = parents.begin(); it != parents.end(); it++)
+	{
+		(*it)->childDeleted(litNode);
+		(*it)->addChild(newChild);
+	}
+	parents.clear();
 }
 
 SOLVER_StateT CMainSolver::countSAT()
@@ -228,6 +525,8 @@ SOLVER_StateT CMainSolver::countSAT()
 		{
 			if (stopWatch.timeBoundBroken())
 				return TIMEOUT;
+			if (theTask != NULL && theTask->aborted())
+				return ABORTED;
 
 			while (!bcp())
 			{
@@ -252,6 +551,126 @@ SOLVER_StateT CMainSolver::countSAT()
 	}
 }
 
+// smallest component offered to another thread, in variables
+#define TASK_MIN_VARS 32
+
+SOLVER_StateT CMainSolver::countTask(CRealNum &rCount, CRealNum &rWeighted,
+		DTNode *&rNode)
+{
+	lastTimeCClDeleted = theStepTime.getTime();
+	lastCClCleanUp = theStepTime.getTime();
+
+	SOLVER_StateT exSt = countSAT();
+
+	abandonOfferedTasks();
+
+	rCount = decStack.top().getOverallSols();
+	rWeighted = decStack.top().getOverallWeightedSols();
+
+	rNode = NULL;
+	if (enable_DT_recording)
+	{
+		rNode = decStack.top().getCurrentDTNode();
+		if (1 == rNode->numChildren())
+			rNode = rNode->onlyChild();
+	}
+
+	return exSt;
+}
+
+void CMainSolver::offerComponents()
+{
+	int nFree = thePool->availableWorkers();
+	if (nFree <= 0 || decStack.TOS_countRemComps() < 2)
+		return;
+
+	unsigned int minVars = std::max((unsigned int) TASK_MIN_VARS, countAllVars() / 64);
+
+	// the components are sorted by size and processed from the back, the
+	//  smallest large one is left to this thread, which reaches it first
+	vector<CComponentId *>::iterator first = decStack.TOSRemComps_begin();
+	vector<CComponentId *> large;
+
+	for (vector<CComponentId *>::iterator it = first; it != first
+			+ decStack.TOS_countRemComps(); it++)
+		if ((*it)->countVars() >= minVars && (*it)->getClauseCount() > 0
+				&& (*it)->theTask == NULL && !(theConf().allowComponentCaching
+				&& xFormulaCache.contains(**it)))
+			large.push_back(*it);
+
+	for (unsigned int i = 0; i + 1 < large.size() && nFree > 0; i++, nFree--)
+	{
+		CMainSolver *solver = new CMainSolver(*this, *large[i]);
+		CComponentTask *task = new CComponentTask(solver, theTask);
+
+		solver->theTask = task;
+		large[i]->theTask = task;
+		thePool->offer(task);
+	}
+}
+
+bool CMainSolver::joinTask(CComponentTask *task)
+{
+	if (!thePool->wait(task, theTask))
+	{
+		abandonTask(task);
+		return false;
+	}
+
+	// the search of this solver stops as well
+	if (task->exitState != SUCCESS)
+	{
+		task->release();
+		return false;
+	}
+
+	CComponentId &comp = decStack.TOS_NextComp();
+	DTNode *node = NULL;
+
+	if (task->dtNode != NULL)
+	{
+		node = dtArena.copyGraph(task->theSolver->dtArena, task->dtNode);
+		node->addParent(decStack.top().getCurrentDTNode());
+	}
+
+	if (isWeighted())
+		decStack.top().includeSol(task->count, task->weightedCount);
+	else
+		decStack.top().includeSol(task->count);
+	theRunAn().addValue(SOLUTION, decStack.getDL());
+
+	if (theConf().allowComponentCaching)
+		xFormulaCache.include(comp, task->count, node,
+				isWeighted() ? &task->weightedCount : NULL);
+
+	task->release();
+	decStack.TOS_popRemComp();
+	return true;
+}
+
+bool CMainSolver::extractFromAncestors(CComponentId &rComp)
+{
+	for (vector<CFormulaCache *>::reverse_iterator it =
+			ancestorCaches.rbegin(); it != ancestorCaches.rend(); it++)
+		if ((*it)->extractShared(rComp, cacheVal,
+				decStack.top().getCurrentDTNode(),
+				isWeighted() ? &weightedCacheVal : NULL))
+			return true;
+	return false;
+}
+
+void CMainSolver::abandonOfferedTasks()
+{
+	for (vector<CComponentId *>::const_iterator it =
+			decStack.getAllCompStack().begin(); it
+			!= decStack.getAllCompStack().end(); it++)
+		if ((*it)->theTask != NULL)
+		{
+			abandonTask((*it)->theTask);
+			(*it)->theTask = NULL;
+		}
+}
+
 bool CMainSolver::findVSADSDecVar(LiteralIdT &theLit,
 		const CComponentId & superComp)
 {
@@ -266,7 +685,7 @@ bool CMainSolver::findVSADSDecVar(LiteralIdT &theLit,
 	for (it = superComp.varsBegin(); *it != varsSENTINEL; it++)
 		if (getVar(*it).isActive())
 		{
-			bo = (int) getVar(*it).getVSIDSScore() + getVar(*it).getDLCSScore();
+			bo = vsadsScore(getVar(*it));
 
 			if (bo > score)
 			{
@@ -305,14 +724,14 @@ bool CMainSolver::decide()
 {
 	LiteralIdT theLit(NOT_A_LIT);
 
-	CStepTime::stepTime(); // Solver-Zeit
+	theStepTime.stepTime(); // Solver-Zeit
 
 
-	if (CStepTime::getTime() - xFormulaCache.getLastDivTime()
+	if (theStepTime.getTime() - xFormulaCache.getLastDivTime()
 			> xFormulaCache.getScoresDivTime())
 	{
 		xFormulaCache.divCacheScores();
-		xFormulaCache.setLastDivTime(CStepTime::getTime());
+		xFormulaCache.setLastDivTime(theStepTime.getTime());
 	}
 
 	if (!bcpImplQueue.empty())
@@ -326,6 +745,23 @@ bool CMainSolver::decide()
 			handleSolution();
 			return false;
 		}
+
+		if (thePool != NULL)
+			offerComponents();
+	}
+
+	// another thread counts the next component unless it is taken back
+	if (decStack.TOS_NextComp().theTask != NULL)
+	{
+		CComponentTask *task = decStack.TOS_NextComp().theTask;
+		decStack.TOS_NextComp().theTask = NULL;
+
+		// returning true stops the search at the checks of countSAT()
+		if (!task->takeBack())
+			return !joinTask(task);
+
+		thePool->addTakenBack();
+		task->release();
 	}
 
 	if (!findVSADSDecVar(theLit, decStack.TOS_NextComp())
@@ -337,44 +773,52 @@ bool CMainSolver::decide()
 	}
 
 	//checkCachedCompVal:
-	static CRealNum cacheVal;
-
 	//decStack.TOS_NextComp();
 
-	if (CSolverConf::allowComponentCaching && xFormulaCache.extract(
+	if (theConf().allowComponentCaching && (xFormulaCache.extract(
 			decStack.TOS_NextComp(), cacheVal,
-			decStack.top().getCurrentDTNode()))
+			decStack.top().getCurrentDTNode(),
+			isWeighted() ? &weightedCacheVal : NULL)
+			|| extractFromAncestors(decStack.TOS_NextComp())))
 	{
-		decStack.top().includeSol(cacheVal);
-		theRunAn.addValue(SOLUTION, decStack.getDL());
+		if (isWeighted())
+			decStack.top().includeSol(cacheVal, weightedCacheVal);
+		else
+			decStack.top().includeSol(cacheVal);
+		theRunAn().addValue(SOLUTION, decStack.getDL());
 		decStack.TOS_popRemComp();
 		return false;
 	}
 	/////////////////////////////
 
-	// Create the nodes
-	DTNode * newNode = new DTNode(DT_NodeType::kDTOr, num_Nodes++);
-	DTNode * left = new DTNode(DT_NodeType::kDTAnd, num_Nodes++);
-	DTNode * right = new DTNode(DT_NodeType::kDTAnd, num_Nodes++);
-	DTNode * leftLit = get_lit_node(theLit.toSignedInt());
-	DTNode * rightLit = get_lit_node(-1 * theLit.toSignedInt());
-
-	newNode->choiceVar = theLit.toVarIdx();
-
-	// Set the parents
-	left->addParent(newNode, true);
-	leftLit->addParent(left, true);
-	right->addParent(newNode, true);
-	rightLit->addParent(right, true);
-	newNode->addParent(decStack.top().getCurrentDTNode(), true);
-
-	decStack.push(newNode);
+	if (enable_DT_recording)
+	{
+		// Create the nodes
+		DTNode * newNode = dtArena.newNode(DT_NodeType::kDTOr);
+		DTNode * left = dtArena.newNode(DT_NodeType::kDTAnd);
+		DTNode * right = dtArena.newNode(DT_NodeType::kDTAnd);
+		DTNode * leftLit = get_lit_node(theLit.toSignedInt());
+		DTNode * rightLit = get_lit_node(-1 * theLit.toSignedInt());
+
+		newNode->choiceVar = theLit.toVarIdx();
+
+		// Set the parents
+		left->addParent(newNode);
+		leftLit->addParent(left);
+		right->addParent(newNode);
+		rightLit->addParent(right);
+		newNode->addParent(decStack.top().getCurrentDTNode());
+
+		decStack.push(newNode);
+	}
+	else
+		decStack.push(NULL);
 	bcpImplQueue.clear();
 	bcpImplQueue.push_back(AntAndLit(NOT_A_CLAUSE, theLit));
 
-	theRunAn.addValue(DECISION, decStack.getDL());
+	theRunAn().addValue(DECISION, decStack.getDL());
 
-	if (theRunAn.getData().nDecisions % 255 == 0)
+	if (theRunAn().getData().nDecisions % 255 == 0)
 	{
 		doVSIDSScoreDiv();
 	}
@@ -382,6 +826,86 @@ bool CMainSolver::decide()
 	return true;
 }
 
+void CMainSolver::mapLitWeights()
+{
+	solverLitWeights.clear();
+	solverVarWeights.clear();
+
+	if (!isWeighted())
+		return;
+
+	vector<unsigned int> origVar;
+	makeOrigVarMap(origVar);
+
+	solverLitWeights.resize(2 * (countAllVars() + 1));
+	solverVarWeights.resize(countAllVars() + 1);
+
+	for (VarIdT v = 1; v <= countAllVars(); v++)
+	{
+		const CRealNum &wPos = getLitWeights()[LiteralIdT(origVar[v], true).toUInt()];
+		const CRealNum &wNeg = getLitWeights()[LiteralIdT(origVar[v], false).toUInt()];
+
+		solverLitWeights[LiteralIdT(v, true).toUInt()] = wPos;
+		solverLitWeights[LiteralIdT(v, false).toUInt()] = wNeg;
+		solverVarWeights[v] = wPos + wNeg;
+	}
+}
+
+CRealNum CMainSolver::freeVarsWeight()
+{
+	CRealNum res = 1;
+
+	if (decStack.TOS_countRemComps() == 0)
+		return res;
+
+	// an assigned variable of the component was implied at this decision
+	//  level, its weight is included by weighBranch()
+	const CComponentId &comp = decStack.TOS_NextComp();
+	for (vector<VarIdT>::const_iterator vt = comp.varsBegin(); *vt
+			!= varsSENTINEL; vt++)
+		if (getVar(*vt).isActive())
+			res *= solverVarWeights[*vt];
+
+	return res;
+}
+
+void CMainSolver::weighBranch()
+{
+	if (!isWeighted())
+		return;
+
+	// the same literals the d-DNNF records below the branch
+	for (vector<LiteralIdT>::const_iterator it =
+			decStack.TOS_ImpliedLits_begin(); it
+			!= decStack.TOS_ImpliedLits_end(); it++)
+		if (recordImpliedLit(*it))
+			decStack.top().includeLitWeight(solverLitWeights[it->toUInt()]);
+}
+
+CRealNum CMainSolver::finalWeightedCount()
+{
+	CRealNum res = decStack.top().getOverallWeightedSols();
+
+	// the backbones are literals before prep_CleanUpPool renumbered the
+	//  variables
+	vector<LiteralIdT>::iterator bbit;
+	for (bbit = backbones.begin(); bbit != backbones.end(); bbit++)
+		res *= getLitWeights()[LiteralIdT(getOrigTranslation()[bbit->toVarIdx()],
+				bbit->polarity()).toUInt()];
+
+	vector<bool> inClause(originalVarCount + 1, false);
+	for (unsigned int v = 1; v < getOrigTranslation().size(); v++)
+		if (getOrigTranslation()[v] <= originalVarCount)
+			inClause[getOrigTranslation()[v]] = true;
+
+	for (unsigned int v = 1; v <= originalVarCount; v++)
+		if (!inClause[v])
+			res *= getLitWeights()[LiteralIdT(v, true).toUInt()]
+					+ getLitWeights()[LiteralIdT(v, false).toUInt()];
+
+	return res;
+}
+
 void CMainSolver::removeAllCachePollutions()
 {
 	// We are removing the pollutions because a conflict was found, so the
@@ -406,7 +930,7 @@ void CMainSolver::removeAllCachePollutions()
 		// thus we have to delete them
 		else if (!(*it)->cachedChildren.empty())
 		{
-			for (vector<unsigned int>::iterator ct =
+			for (vector<CacheRefT>::iterator ct =
 					(*it)->cachedChildren.begin(); ct
 					!= (*it)->cachedChildren.end(); ct++)
 			{
@@ -419,7 +943,7 @@ void CMainSolver::removeAllCachePollutions()
 
 retStateT CMainSolver::backTrack()
 {
-	unsigned int refTime = theRunAn.getData().nAddedClauses;
+	unsigned int refTime = theRunAn().getData().nAddedClauses;
 	LiteralIdT aLit;
 
 	if (refTime - lastTimeCClDeleted > 1000 && countCCls() > 3000)
@@ -437,8 +961,8 @@ retStateT CMainSolver::backTrack()
 	}
 
 	//component cache delete old entries
-	if (CSolverConf::allowComponentCaching)
-		xFormulaCache.deleteEntries(decStack);
+	if (theConf().allowComponentCaching)
+		xFormulaCache.deleteEntries();
 
 	do
 	{
@@ -454,6 +978,7 @@ retStateT CMainSolver::backTrack()
 
 		if (!decStack.top().isFlipped())
 		{
+			weighBranch();
 			aLit = decStack.TOS_decLit();
 			decStack.flipTOS();
 			bcpImplQueue.push_back(AntAndLit(NOT_A_CLAUSE, aLit.oppositeLit()));
@@ -461,8 +986,17 @@ retStateT CMainSolver::backTrack()
 			return RESOLVED;
 		}
 
+		weighBranch();
+
 		//include the component value of the current component into the Cache
-		if (CSolverConf::allowComponentCaching)
+		if (theConf().allowComponentCaching && isWeighted())
+		{
+			CRealNum weightedSols = decStack.top().getOverallWeightedSols();
+			xFormulaCache.include(decStack.TOSRefComp(),
+					decStack.top().getOverallSols(),
+					decStack.top().getOrDTNode(), &weightedSols);
+		}
+		else if (theConf().allowComponentCaching)
 		{
 			xFormulaCache.include(decStack.TOSRefComp(),
 					decStack.top().getOverallSols(),
@@ -498,12 +1032,12 @@ bool CMainSolver::bcp()
 	bSucceeded = BCP(bcpImplQueue);
 	bcpImplQueue.clear();
 
-	if (CSolverConf::allowImplicitBCP && bSucceeded)
+	if (theConf().allowImplicitBCP && bSucceeded)
 	{
 		bSucceeded = implicitBCP();
 	}
 
-	theRunAn.addValue(IMPLICATION, decStack.getDL(),
+	theRunAn().addValue(IMPLICATION, decStack.getDL(),
 			decStack.TOS_countImplLits());
 
 	return bSucceeded;
@@ -514,8 +1048,12 @@ retStateT CMainSolver::resolveConflict()
 	int backtrackDecLev;
 
 	// Since we have a conflict, we should add a bottom to the current DTNode
-	DTNode * newBot = new DTNode(DT_NodeType::kDTBottom, num_Nodes++);
-	newBot->addParent(decStack.top().getCurrentDTNode(), true);
+	DTNode * newBot;
+	if (enable_DT_recording)
+	{
+		newBot = dtArena.newNode(DT_NodeType::kDTBottom);
+		newBot->addParent(decStack.top().getCurrentDTNode());
+	}
 
 	for (vector<LiteralIdT>::iterator it = theUnitClauses.begin(); it
 			!= theUnitClauses.end(); it++)
@@ -527,13 +1065,13 @@ retStateT CMainSolver::resolveConflict()
 		}
 	}
 
-	theRunAn.addValue(CONFLICT, decStack.getDL(), 1);
+	theRunAn().addValue(CONFLICT, decStack.getDL(), 1);
 
 #ifdef DEBUG
 	assert(!getConflicted().empty());
 #endif
 
-	if (!CSolverConf::analyzeConflicts || getConflicted().empty())
+	if (!theConf().analyzeConflicts || getConflicted().empty())
 		return backTrack();
 
 	caGetCauses_firstUIP(getConflicted());
@@ -545,16 +1083,19 @@ retStateT CMainSolver::resolveConflict()
 
 	if (backtrackDecLev < decStack.getDL())
 	{
-		if (CSolverConf::doNonChronBackTracking)
+		if (theConf().doNonChronBackTracking)
 			while (decStack.getDL() > backtrackDecLev)
 			{
 				/// check for polluted cache Entries
 				removeAllCachePollutions();
+				weighBranch();
 				decStack.pop();
 
-				newBot = new DTNode(DT_NodeType::kDTBottom, num_Nodes++);
-				newBot->addParent(decStack.top().getCurrentDTNode(), true);
-
+				if (enable_DT_recording)
+				{
+					newBot = dtArena.newNode(DT_NodeType::kDTBottom);
+					newBot->addParent(decStack.top().getCurrentDTNode());
+				}
 			}
 		return backTrack();
 
@@ -572,6 +1113,7 @@ retStateT CMainSolver::resolveConflict()
 
 	LiteralIdT aLit = decStack.TOS_decLit();
 	AntecedentT ant = getVar(aLit).getAntecedent();
+	weighBranch();
 	decStack.flipTOS();
 
 	bcpImplQueue.push_back(AntAndLit(ant, aLit.oppositeLit()));
@@ -620,7 +1162,7 @@ bool CMainSolver::recordRemainingComps()
 	
 	componentSearchStack.clear();
 	
-	if (CSolverConf::disableDynamicDecomp)
+	if (theConf().disableDynamicDecomp)
 	{
 	
 	    decStack.TOS_addRemComp();
@@ -847,10 +1389,10 @@ bool CMainSolver::BCP(vector<AntAndLit> &thePairsOfImpl)
 			decStack.TOS_addImpliedLit(satLit);
 
 #ifdef FULL_DDNNF
-			if (enable_DT_recording)
+			if (enable_DT_recording && recordImpliedLit(satLit))
 			{
 				DTNode * satLitDTNode = get_lit_node(satLit.toSignedInt());
-				satLitDTNode->addParent(decStack.top().getCurrentDTNode(), true);
+				satLitDTNode->addParent(decStack.top().getCurrentDTNode());
 				dirtyLitNodes.push_back(pair<DTNode *, DTNode *> (
 						decStack.top().getCurrentDTNode(), satLitDTNode));
 			}
@@ -868,10 +1410,10 @@ bool CMainSolver::BCP(vector<AntAndLit> &thePairsOfImpl)
 					thePairsOfImpl.push_back(AntAndLit(unLit, *bt));
 
 #ifdef FULL_DDNNF
-					if (enable_DT_recording)
+					if (enable_DT_recording && recordImpliedLit(*bt))
 					{
 						DTNode * ccLit = get_lit_node((*bt).toSignedInt());
-						ccLit->addParent(decStack.top().getCurrentDTNode(), true);
+						ccLit->addParent(decStack.top().getCurrentDTNode());
 						dirtyLitNodes.push_back(pair<DTNode *, DTNode*> (
 								decStack.top().getCurrentDTNode(), ccLit));
 					}
@@ -891,11 +1433,11 @@ bool CMainSolver::BCP(vector<AntAndLit> &thePairsOfImpl)
 				{
 					thePairsOfImpl.push_back(AntAndLit(unLit, *bt));
 
-					if (enable_DT_recording)
+					if (enable_DT_recording && recordImpliedLit(*bt))
 					{
 						// Add the implied literal due to a conflict clause
 						DTNode * ccLit = get_lit_node((*bt).toSignedInt());
-						ccLit->addParent(decStack.top().getCurrentDTNode(), true);
+						ccLit->addParent(decStack.top().getCurrentDTNode());
 						dirtyLitNodes.push_back(pair<DTNode *, DTNode*> (
 								decStack.top().getCurrentDTNode(), ccLit));
 					}
@@ -947,19 +1489,19 @@ bool CMainSolver::BCP(vector<AntAndLit> &thePairsOfImpl)
 					{
 						thePairsOfImpl.push_back(
 								AntAndLit(actCl, pCl->idLitA()));
-						pCl->setTouched();
+						pCl->setTouched(theStepTime.getTime());
 
 						// Add the implied literal due to a conflict clause
 #ifndef FULL_DDNNF
 						if (pCl->isCC())
 						{
 #endif
-						if (enable_DT_recording)
+						if (enable_DT_recording
+								&& recordImpliedLit(pCl->idLitA()))
 						{
 							DTNode * ccLit = get_lit_node(
 									pCl->idLitA().toSignedInt());
-							ccLit->addParent(decStack.top().getCurrentDTNode(),
-									true);
+							ccLit->addParent(decStack.top().getCurrentDTNode());
 							dirtyLitNodes.push_back(pair<DTNode *, DTNode*> (
 									decStack.top().getCurrentDTNode(), ccLit));
 						}
@@ -970,7 +1512,7 @@ bool CMainSolver::BCP(vector<AntAndLit> &thePairsOfImpl)
 				}
 				else
 				{
-					pCl->setTouched();
+					pCl->setTouched(theStepTime.getTime());
 					if (getVar(pCl->idLitB()).isActive())
 					{ //IMPLIES_LITB;
 						thePairsOfImpl.push_back(
@@ -981,12 +1523,12 @@ bool CMainSolver::BCP(vector<AntAndLit> &thePairsOfImpl)
 						if (pCl->isCC())
 						{
 #endif
-						if (enable_DT_recording)
+						if (enable_DT_recording
+								&& recordImpliedLit(pCl->idLitB()))
 						{
 							DTNode * ccLit = get_lit_node(
 									pCl->idLitB().toSignedInt());
-							ccLit->addParent(decStack.top().getCurrentDTNode(),
-									true);
+							ccLit->addParent(decStack.top().getCurrentDTNode());
 							dirtyLitNodes.push_back(pair<DTNode *, DTNode*> (
 									decStack.top().getCurrentDTNode(), ccLit));
 						}
@@ -1044,7 +1586,6 @@ bool CMainSolver::implicitBCP()
 	vector<LiteralIdT>::const_iterator it, lt;
 	vector<ClauseIdT>::const_iterator ct;
 
-	static vector<AntAndLit> implPairs;
 	implPairs.clear();
 	vector<LiteralIdT> nextStep;
 	bool viewedLits[(countAllVars() + 1) * 2 + 1];
@@ -1120,15 +1661,13 @@ bool CMainSolver::implicitBCP()
 				{
 					dirtyLitNodes[i].first->childDeleted(
 							dirtyLitNodes[i].second);
-					dirtyLitNodes[i].second->parentDeleted(
-							dirtyLitNodes[i].first);
 				}
 
 				decStack.shrinkImplLitsTo(sz);
 				theAnt = NOT_A_CLAUSE;
 				theLit = implPairs[0].getLit();
 
-				if (!bSucceeded && CSolverConf::analyzeConflicts
+				if (!bSucceeded && theConf().analyzeConflicts
 						&& !getConflicted().empty())
 				{
 
@@ -1137,7 +1676,7 @@ bool CMainSolver::implicitBCP()
 					createAntClauseFor(theLit.oppositeLit());
 					//createLastUIPCCl();
 
-					theRunAn.addValue(IBCPIMPL, decStack.getDL(), 1);
+					theRunAn().addValue(IBCPIMPL, decStack.getDL(), 1);
 					theAnt = getVar(theLit).getAntecedent();
 
 				}
@@ -1167,17 +1706,18 @@ bool CMainSolver::implicitBCP()
 						{
 							dirtyLitNodes[i].first->childDeleted(
 									dirtyLitNodes[i].second);
-							dirtyLitNodes[i].second->parentDeleted(
-									dirtyLitNodes[i].first);
 						}
 
 						return false;
 					}
 
 					// Add the successful ibcp lit to the graph
-					DTNode * ibcpLit = get_lit_node(
-							theLit.oppositeLit().toSignedInt());
-					ibcpLit->addParent(decStack.top().getCurrentDTNode(), true);
+					if (enable_DT_recording)
+					{
+						DTNode * ibcpLit = get_lit_node(
+								theLit.oppositeLit().toSignedInt());
+						ibcpLit->addParent(decStack.top().getCurrentDTNode());
+					}
 
 					implPairs.clear();
 				}
@@ -1323,7 +1863,7 @@ bool CMainSolver::caGetCauses_lastUIP(vector<AntecedentT> & theConflicted)
 	}
 
 	// analyzer data
-	theRunAn.addValue(CCL_lastUIP, decStack.getDL(), ca_lastUIPClause.size());
+	theRunAn().addValue(CCL_lastUIP, decStack.getDL(), ca_lastUIPClause.size());
 	return true;
 }
 
@@ -1354,8 +1894,8 @@ bool CMainSolver::caGetCauses_firstUIP(vector<AntecedentT> & theConflicted)
 		caIncludeCauses(theQueue[i], viewedVars);
 	}
 	// analyzer data
-	theRunAn.addValue(CCL_1stUIP, decStack.getDL(), ca_1UIPClause.size());
-	theRunAn.addValue(CCL_lastUIP, decStack.getDL(), ca_lastUIPClause.size());
+	theRunAn().addValue(CCL_1stUIP, decStack.getDL(), ca_1UIPClause.size());
+	theRunAn().addValue(CCL_lastUIP, decStack.getDL(), ca_lastUIPClause.size());
 
 	return true;
 }
@@ -1379,9 +1919,10 @@ bool CMainSolver::prep_IBCP(vector<AntAndLit> &impls)
 
 	unsigned int sz = decStack.countAllImplLits();
 
+	bool recording = enable_DT_recording;
 	enable_DT_recording = false;
 	bSucceeded = BCP(impls);
-	enable_DT_recording = true;
+	enable_DT_recording = recording;
 
 	decStack.shrinkImplLitsTo(sz);
 
@@ -1599,3 +2140,372 @@ bool CMainSolver::printUnitClauses()
 
 	return true;
 }
+
+/////////////////////////////////////////////////////
+// BEGIN persistent component cache
+/////////////////////////////////////////////////////
+
+void CMainSolver::makeOrigVarMap(vector<unsigned int> &origVar)
+{
+	origVar.assign(countAllVars() + 1, 0);
+	for (VarIdT v = 1; v <= countAllVars(); v++)
+		origVar[v] = getOrigTranslation()[getVarTranslation()[v]];
+}
+
+uint64_t CMainSolver::binClauseHash(const vector<VarIdT> &vars,
+		const vector<unsigned int> &origVar, vector<bool> &inComp)
+{
+	vector<VarIdT>::const_iterator vt;
+	vector<LiteralIdT>::const_iterator itL;
+	uint64_t h = 0;
+
+	for (vt = vars.begin(); vt != vars.end(); vt++)
+		inComp[*vt] = true;
+
+	for (vt = vars.begin(); vt != vars.end(); vt++)
+		for (int pol = 0; pol < 2; pol++)
+		{
+			int litA = pol ? (int) origVar[*vt] : -(int) origVar[*vt];
+
+			for (itL = getVar(*vt).getBinLinks(pol).begin(); *itL != SENTINEL_LIT; itL++)
+				if (inComp[itL->toVarIdx()])
+				{
+					int litB = itL->polarity() ? (int) origVar[itL->toVarIdx()]
+							: -(int) origVar[itL->toVarIdx()];
+
+					// every clause is met from both of its literals, the sum
+					//  makes the hash independent of the order
+					h += compHashStep(compHashStep(0, std::min(litA, litB)), std::max(litA, litB));
+				}
+		}
+
+	for (vt = vars.begin(); vt != vars.end(); vt++)
+		inComp[*vt] = false;
+
+	return h;
+}
+
+// Appends the nodes below root that are not stored yet, children first.
+uint32_t CMainSolver::storeDTNode(DTNode *root, const vector<unsigned int> &origVar,
+		map<DTNode *, uint32_t> &nodeIdx, CacheFileContents &contents)
+{
+	vector<DTNode *> openList(1, root);
+	DTNode::ChildIterator it;
+
+	while (!openList.empty())
+	{
+		DTNode *node = openList.back();
+
+		if (nodeIdx.find(node) != nodeIdx.end())
+		{
+			openList.pop_back();
+			continue;
+		}
+
+		bool ready = true;
+		for (it = node->getChildrenBegin(); it != node->getChildrenEnd(); it++)
+			if (nodeIdx.find(*it) == nodeIdx.end())
+			{
+				openList.push_back(*it);
+				ready = false;
+			}
+		if (!ready)
+			continue;
+		openList.pop_back();
+
+		CacheFileNode fn;
+		fn.type = node->getType();
+		fn.val = 0;
+		if (DT_NodeType::kDTLit == node->getType())
+			fn.val = (node->getVal() < 0) ? -(int) origVar[-node->getVal()]
+					: (int) origVar[node->getVal()];
+		else if (DT_NodeType::kDTOr == node->getType() && node->choiceVar)
+			fn.val = origVar[node->choiceVar];
+
+		fn.childOfs = contents.children.size();
+		fn.nChildren = node->numChildren();
+		for (it = node->getChildrenBegin(); it != node->getChildrenEnd(); it++)
+			contents.children.push_back(nodeIdx[*it]);
+
+		nodeIdx[node] = contents.nodes.size();
+		contents.nodes.push_back(fn);
+	}
+
+	return nodeIdx[root];
+}
+
+// Creates the nodes below root, NULL if one of them refers to a variable
+//  that is not part of this formula (any more).
+DTNode * CMainSolver::loadDTNode(const CCacheFileReader &file, uint32_t root,
+		const vector<VarIdT> &varOf, vector<DTNode *> &nodes, vector<bool> &failed)
+{
+	vector<uint32_t> openList(1, root);
+
+	while (!openList.empty())
+	{
+		uint32_t i = openList.back();
+
+		if (nodes[i] != NULL || failed[i])
+		{
+			openList.pop_back();
+			continue;
+		}
+
+		const CacheFileNode &fn = file.node(i);
+		const uint32_t *children = file.children(fn);
+
+		bool ready = true, bad = false;
+		for (uint32_t c = 0; c < fn.nChildren; c++)
+			bad |= failed[children[c]];
+		for (uint32_t c = 0; c < fn.nChildren && !bad; c++)
+			if (nodes[children[c]] == NULL)
+			{
+				openList.push_back(children[c]);
+				ready = false;
+			}
+		if (!ready)
+			continue;
+		openList.pop_back();
+
+		unsigned int var = abs(fn.val);
+		if (bad || var > originalVarCount || (var != 0 && varOf[var] == 0))
+		{
+			failed[i] = true;
+			continue;
+		}
+
+		DTNode *node = NULL;
+		switch (fn.type)
+		{
+		case DT_NodeType::kDTLit:
+			if (var != 0 && fn.nChildren == 0)
+				node = get_lit_node((fn.val < 0) ? -(int) varOf[var] : (int) varOf[var]);
+			break;
+		case DT_NodeType::kDTOr:
+			node = dtArena.newNode(DT_NodeType::kDTOr);
+			node->choiceVar = varOf[var];
+			break;
+		case DT_NodeType::kDTAnd:
+		case DT_NodeType::kDTTop:
+		case DT_NodeType::kDTBottom:
+			node = dtArena.newNode((DT_NodeType) fn.type);
+			break;
+		default:
+			break;
+		}
+
+		if (node == NULL)
+		{
+			failed[i] = true;
+			continue;
+		}
+
+		if (DT_NodeType::kDTLit != node->getType())
+		{
+			for (uint32_t c = 0; c < fn.nChildren; c++)
+				nodes[children[c]]->addParent(node);
+		}
+		nodes[i] = node;
+	}
+
+	return nodes[root];
+}
+
+void CMainSolver::loadCacheFile()
+{
+	CCacheFileReader file;
+	string err;
+
+	if (isWeighted())
+	{
+		toSTDOUT("cache file " << cacheFileName
+				<< " not loaded, it holds no weighted counts" << endl);
+		return;
+	}
+
+	if (!file.open(cacheFileName.c_str(), getFormulaFingerprint(), err))
+	{
+		toSTDOUT("cache file " << cacheFileName << " " << err
+				<< ", starting with an empty cache" << endl);
+		return;
+	}
+
+	vector<unsigned int> origVar;
+	makeOrigVarMap(origVar);
+
+	// the solver variable and clause of every cnf variable and clause,
+	//  0 if it was removed by preprocessing
+	vector<VarIdT> varOf(originalVarCount + 1, 0);
+	for (VarIdT v = 1; v <= countAllVars(); v++)
+		varOf[origVar[v]] = v;
+
+	vector<ClauseIdT> clauseOf(countNonUnitClauses() + 1, 0);
+	for (ClauseIdT c = 1; c < getMaxOriginalClIdx(); c++)
+		clauseOf[getClauseOrigin(c)] = c;
+
+	vector<bool> inComp(countAllVars() + 1, false);
+	vector<DTNode *> nodes(file.countNodes(), NULL);
+	vector<bool> failed(file.countNodes(), false);
+
+	vector<VarIdT> vars;
+	vector<ClauseIdT> cls;
+	CComponentId comp;
+	CRealNum val;
+	unsigned int nLoaded = 0;
+
+	for (uint64_t i = 0; i < file.countEntries(); i++)
+	{
+		const CacheFileEntry &fe = file.entry(i);
+		const uint32_t *fVars = file.vars(fe);
+		const uint32_t *fCls = file.clauses(fe);
+		bool valid = true;
+
+		comp.clear();
+		vars.clear();
+		cls.clear();
+
+		for (uint32_t k = 0; k < fe.nVars; k++)
+		{
+			comp.addVar(fVars[k]);
+			if (fVars[k] == 0 || fVars[k] > originalVarCount || varOf[fVars[k]] == 0)
+				valid = false;
+			else
+				vars.push_back(varOf[fVars[k]]);
+		}
+		comp.addVar(varsSENTINEL);
+
+		for (uint32_t k = 0; k < fe.nCls; k++)
+		{
+			comp.addCl(fCls[k]);
+			if (fCls[k] == 0 || fCls[k] > countNonUnitClauses() || clauseOf[fCls[k]] == 0)
+				valid = false;
+			else
+				cls.push_back(clauseOf[fCls[k]]);
+		}
+		comp.addCl(clsSENTINEL);
+
+		// the entry must be intact and its component still complete
+		if (!valid || comp.getHashKey() != fe.hashKey || vars.empty())
+			continue;
+		if (binClauseHash(vars, origVar, inComp) != fe.binHash)
+			continue;
+		if (!from_stringT(val, file.value(fe).c_str()))
+			continue;
+
+		// a counting only run just needs the values
+		DTNode *dtNode = NULL;
+		if (enable_DT_recording)
+		{
+			dtNode = loadDTNode(file, fe.dtNode, varOf, nodes, failed);
+			if (dtNode == NULL)
+				continue;
+		}
+
+		// components list their variables and clauses in the solver's order
+		sort(vars.begin(), vars.end());
+		sort(cls.begin(), cls.end());
+
+		comp.clear();
+		for (vector<VarIdT>::iterator vt = vars.begin(); vt != vars.end(); vt++)
+			comp.addVar(*vt);
+		comp.addVar(varsSENTINEL);
+		for (vector<ClauseIdT>::iterator ct = cls.begin(); ct != cls.end(); ct++)
+			comp.addCl(*ct);
+		comp.addCl(clsSENTINEL);
+
+		// the cache is full
+		if (!xFormulaCache.include(comp, val, dtNode))
+			break;
+		nLoaded++;
+	}
+
+	toSTDOUT("cache file " << cacheFileName << ": loaded " << nLoaded
+			<< " of " << file.countEntries() << " components" << endl);
+}
+
+void CMainSolver::saveCacheFile()
+{
+	// the entries of a counting only run have no d-DNNF fragments, and a
+	//  file without them would be useless for compiling
+	if (!enable_DT_recording)
+	{
+		toSTDOUT("cache file " << cacheFileName
+				<< " not saved, -count builds no d-DNNF" << endl);
+		return;
+	}
+
+	if (isWeighted())
+	{
+		toSTDOUT("cache file " << cacheFileName
+				<< " not saved, it can not hold weighted counts" << endl);
+		return;
+	}
+
+	CacheFileContents contents;
+	map<DTNode *, uint32_t> nodeIdx;
+
+	vector<unsigned int> origVar;
+	makeOrigVarMap(origVar);
+	vector<bool> inComp(countAllVars() + 1, false);
+
+	vector<VarIdT> vars;
+	vector<ClauseIdT> cls;
+	CComponentId key;
+	CRealNum val;
+	DTNode *dtNode;
+
+	for (CacheEntryId eId = 1; eId < xFormulaCache.endEntryId(); eId++)
+	{
+		if (!xFormulaCache.getEntry(eId, vars, cls, val, dtNode))
+			continue;
+
+		CacheFileEntry fe;
+		fe.binHash = binClauseHash(vars, origVar, inComp);
+		fe.dtNode = storeDTNode(dtNode, origVar, nodeIdx, contents);
+
+		for (vector<VarIdT>::iterator vt = vars.begin(); vt != vars.end(); vt++)
+			*vt = origVar[*vt];
+		for (vector<ClauseIdT>::iterator ct = cls.begin(); ct != cls.end(); ct++)
+			*ct = getClauseOrigin(*ct);
+		sort(vars.begin(), vars.end());
+		sort(cls.begin(), cls.end());
+
+		key.clear();
+		fe.idOfs = contents.ids.size();
+		fe.nVars = vars.size();
+		fe.nCls = cls.size();
+		for (vector<VarIdT>::iterator vt = vars.begin(); vt != vars.end(); vt++)
+		{
+			key.addVar(*vt);
+			contents.ids.push_back(*vt);
+		}
+		key.addVar(varsSENTINEL);
+		for (vector<ClauseIdT>::iterator ct = cls.begin(); ct != cls.end(); ct++)
+		{
+			key.addCl(*ct);
+			contents.ids.push_back(*ct);
+		}
+		key.addCl(clsSENTINEL);
+		fe.hashKey = key.getHashKey();
+
+		string sVal = to_stringT(val);
+		fe.valOfs = contents.values.size();
+		fe.valLen = sVal.size();
+		contents.values += sVal;
+
+		contents.entries.push_back(fe);
+	}
+
+	if (!writeCacheFile(cacheFileName.c_str(), getFormulaFingerprint(), contents))
+	{
+		toERROUT(" Error writing cache file " << cacheFileName << endl);
+		return;
+	}
+
+	toSTDOUT("cache file " << cacheFileName << ": saved " << contents.entries.size()
+			<< " components, " << contents.nodes.size() << " nodes" << endl);
+}
+
+/////////////////////////////////////////////////////
+// END persistent component cache
+/////////////////////////////////////////////////////
@@ -2,17 +2,24 @@
 #define MAINSOLVER_H
 
 #include <set>
+#include <map>
 #include <queue>
 #include <utility>
+#include <string>
 
 //shared files
 #include <Interface/AnalyzerData.h>
+#include <OutputFile.h>
+#include <NNFBinFile.h>
 
 #include "../Basics.h"
 #include "InstanceGraph/InstanceGraph.h"
 
 #include "FormulaCache.h"
 #include "DecisionTree.h"
+#include "CacheFile.h"
+#include "DAGEvaluator.h"
+#include "ComponentTasks.h"
 
 /** \addtogroup Interna Solver Interna
  * Dies sind alle Klassen, die ausschlie�ich vom Solver selbst verwendet werden
@@ -22,6 +29,8 @@
 using std::pair;
 using std::vector;
 using std::queue;
+using std::map;
+using std::string;
 
 /*@{*/
 
@@ -55,12 +64,18 @@ class CMainSolver: public CInstanceGraph
 
 	unsigned int remPoll;
 
+	// scratch values of handleSolution(), decide() and implicitBCP()
+	CRealNum rnCodedSols;
+	CRealNum cacheVal;
+	CRealNum weightedCacheVal;
+	vector<AntAndLit> implPairs;
+
 	///////////////////
 	// Decision Tree //
 	///////////////////
 	//DTNode * DT_current;
 	DTNode * DT_original;
-	int num_Nodes;
+	CDTNodeArena dtArena;
 	bool enable_DT_recording;
 	vector<DTNode *> litNodes;
 	vector<pair<DTNode *, DTNode *> > dirtyLitNodes;
@@ -68,6 +83,33 @@ class CMainSolver: public CInstanceGraph
 
 	vector<LiteralIdT> backbones;
 
+	// frees the d-DNNF of the previous call to solve(), so that the
+	//  solver can be reused for another instance
+	void releaseDecisionTree();
+
+	///////////////////////////////
+	// Persistent component cache //
+	///////////////////////////////
+	string cacheFileName;
+
+	// the cnf variable of every solver variable
+	void makeOrigVarMap(vector<unsigned int> &origVar);
+
+	// hash of the binary clauses between the variables of a component,
+	//  in cnf variables. inComp has to be all false.
+	uint64_t binClauseHash(const vector<VarIdT> &vars,
+			const vector<unsigned int> &origVar, vector<bool> &inComp);
+
+	uint32_t storeDTNode(DTNode *root, const vector<unsigned int> &origVar,
+			map<DTNode *, uint32_t> &nodeIdx, CacheFileContents &contents);
+	DTNode * loadDTNode(const CCacheFileReader &file, uint32_t root,
+			const vector<VarIdT> &varOf, vector<DTNode *> &nodes,
+			vector<bool> &failed);
+
+	void loadCacheFile();
+	void saveCacheFile();
+	////-----------////
+
 	retStateT backTrack();
 
 	// removes all cachePollutions that might be present in decedants of comnponents from the
@@ -76,6 +118,15 @@ class CMainSolver: public CInstanceGraph
 
 	bool findVSADSDecVar(LiteralIdT &theLit, const CComponentId & superComp);
 
+	// the score of a variable in findVSADSDecVar
+	int vsadsScore(CVariableVertex &rVar)
+	{
+		return (int) rVar.getVSIDSScore() + rVar.getDLCSScore();
+	}
+
+	// everything of solve() after reading the formula
+	void compileFormula();
+
 	bool decide();
 
 	bool bcp();
@@ -83,27 +134,96 @@ class CMainSolver: public CInstanceGraph
 	void handleSolution()
 	{
 		int actCompVars = 0;
-		static CRealNum rnCodedSols;
 
 		// in fact the active component should only contain active vars
 		if (decStack.TOS_countRemComps() != 0)
 			actCompVars = decStack.TOS_NextComp().countVars();
 
 		pow2(rnCodedSols, actCompVars);
-		decStack.top().includeSol(rnCodedSols);
-		theRunAn.addValue(SOLUTION, decStack.getDL());
+		if (isWeighted())
+			decStack.top().includeSol(rnCodedSols, freeVarsWeight());
+		else
+			decStack.top().includeSol(rnCodedSols);
+		theRunAn().addValue(SOLUTION, decStack.getDL());
+	}
 
-		DTNode * newTop = new DTNode(DT_NodeType::kDTTop, num_Nodes++);
-		newTop->addParent(decStack.top().getCurrentDTNode());
+	/////////////////////////////
+	// Weighted model counting //
+	/////////////////////////////
 
-	}
+	// the weight of every literal and w(x) + w(-x) of every variable, over
+	//  the variables of the search
+	void mapLitWeights();
+
+	// the weighted count of the next component without clauses
+	CRealNum freeVarsWeight();
+
+	// multiplies the weights of the literals implied in the branch of the
+	//  top decision into its weighted count, once the branch is finished
+	void weighBranch();
+
+	// the weighted count of the search with the literals of preprocessing
+	//  and the variables in no clause
+	CRealNum finalWeightedCount();
+	////-----------////
 
 	retStateT resolveConflict();
 
 	SOLVER_StateT countSAT();
 
+	////////////////////////////////////
+	// Parallel counting of components //
+	////////////////////////////////////
+
+	// the pool of the search, shared by the solvers of the tasks; NULL
+	//  if the search runs on one thread
+	CComponentTaskPool *thePool;
+
+	// the task this solver counts, NULL for the solver of the formula
+	CComponentTask *theTask;
+
+	// the caches of the solvers that offered the tasks up to this one,
+	//  the nearest last. Their entries were computed below decisions this
+	//  solver is below as well, so a polluted one can only be used in a
+	//  branch that fails anyway. The entries of this solver stay its own.
+	vector<CFormulaCache *> ancestorCaches;
+
+	// the solver of a task: a copy of parent that counts comp on its own,
+	//  the assignment of parent is kept at decision level 0
+	CMainSolver(CMainSolver &parent, const CComponentId &comp);
+
+	// counts the component of the task, rNode is the root of its d-DNNF
+	//  in dtArena
+	SOLVER_StateT countTask(CRealNum &rCount, CRealNum &rWeighted,
+			DTNode *&rNode);
+
+	// offers the large components of the top decision to the pool
+	void offerComponents();
+
+	// includes the result of task, the task of the next component, like
+	//  a cache hit. Returns false if the search has to stop.
+	bool joinTask(CComponentTask *task);
+
+	// abandons the tasks of all components on the decision stack
+	void abandonOfferedTasks();
+
+	// looks the next component up in the caches of the ancestors
+	bool extractFromAncestors(CComponentId &rComp);
+
+	friend class CComponentTask;
+	////-----------////
+
 	bool performPreProcessing();
 
+	// merges structurally identical nodes of the d-DNNF
+	void mergeDecisionTree();
+
+	// post processing of the d-DNNF into a smooth one
+	void smoothDecisionTree();
+	void collectLitParents(map<DTNode *, vector<DTNode *> > &litParents);
+	void substituteLit(map<DTNode *, vector<DTNode *> > &litParents,
+			DTNode *litNode, DTNode *newChild);
+
 	/**
 	 *  passes a componentId to rComp that is made of all
 	 *  active variables and clauses
@@ -128,6 +248,25 @@ class CMainSolver: public CInstanceGraph
 
 	bool BCP(vector<AntAndLit> &thePairsOfImpl);
 
+	// Whether an implied literal goes into the d-DNNF below the current
+	//  decision. A conflict clause can imply a literal of a sibling
+	//  component, which is entailed there and recorded by that component.
+	//  A second copy here would break decomposability: the count of the
+	//  search is right, but the d-DNNF would count fewer models.
+	bool recordImpliedLit(const LiteralIdT &lit)
+	{
+		const CComponentId &comp = decStack.TOSRefComp();
+
+		// no component before the search, during preprocessing; without
+		//  dynamic decomposition every active variable is in the component
+		if (comp.empty() || theConf().disableDynamicDecomp)
+			return true;
+
+		// the variables of a component are sorted
+		return binary_search(comp.varsBegin(), comp.varsBegin()
+				+ comp.countVars(), lit.toVarIdx());
+	}
+
 	/////////////////////////////////////////////
 	//  BEGIN conflict analysis
 	/////////////////////////////////////////////
@@ -250,7 +389,7 @@ public:
 				return litNodes[i];
 			}
 		}
-		litNodes.push_back(new DTNode(lit, true, num_Nodes++));
+		litNodes.push_back(dtArena.newLit(lit));
 		return litNodes[litNodes.size() - 1];
 	}
 
@@ -260,6 +399,17 @@ public:
 	// Variables for the nnf generation
 	int bdg_edge_count;
 	int bdg_var_count;
+
+	// nodes of the nnf output, -1 until they are numbered
+	int nnf_node_count;
+
+	// the final d-DNNF flattened for counting, see dagEvaluator()
+	CDAGEvaluator dagEval;
+
+	// the literal weights at LiteralIdT::toUInt() and the sums
+	//  w(x) + w(-x), over the solver variables, see mapLitWeights()
+	vector<CRealNum> solverLitWeights;
+	vector<CRealNum> solverVarWeights;
 	
 	// Variables that should be decided on first
 	set<int> priorityVars;
@@ -270,13 +420,31 @@ public:
 	// class destructor
 	~CMainSolver();
 
-	void solve(const char *lpstrFileName);
+	// Reads the formula and compiles it, false if the file can not be read
+	bool solve(const char *lpstrFileName);
+
+	// Compiles the formula read with createfromFile or createfromClauses
+	void compile();
+
+	// Reads and preprocesses the formula like solve() and returns up to k
+	//  of its variables, numbered as in the file, in the order
+	//  findVSADSDecVar would decide on them at the root: the priority
+	//  variables first, then by score. None if the formula is unsat.
+	bool pickCubeVars(const char *lpstrFileName, unsigned int k,
+			vector<int> &vars);
 
 	void setTimeBound(long int i)
 	{
 		stopWatch.setTimeBound(i);
 	}
 
+	// the cache is loaded from this file before counting and written
+	//  back after a successful run
+	void setCacheFile(const char *fileName)
+	{
+		cacheFileName = fileName;
+	}
+
 	void writeBDG(const char *fileName, bool falsify=false)
 	{
 		set<int> nodesSeen;
@@ -320,7 +488,7 @@ public:
 				nodesSeen.insert(node_id);
 
 				// Add the children to the open list
-				set<DTNode *>::iterator it;
+				DTNode::ChildIterator it;
 				for (it = node->getChildrenBegin(); it
 						!= node->getChildrenEnd(); it++)
 				{
@@ -381,7 +549,7 @@ public:
 				nodesSeen.insert(node->getID());
 
 				// Add the children to the open list, and make the edges
-				set<DTNode *>::iterator it;
+				DTNode::ChildIterator it;
 				litsSeen.clear();
 
 				for (it = node->getChildrenBegin(); it
@@ -419,34 +587,90 @@ public:
 
 	}
 	
-	void writeNNF(const char *fileName, bool falsify=false)
+	// The root of the nnf output. Its nodes are numbered on the first call,
+	//  the text and the binary output share the numbers.
+	DTNode * nnfRoot()
 	{
-		ofstream out(fileName);
+		DTNode* root;
+
+		if (1 == decStack.top().getDTNode()->numChildren())
+			root = decStack.top().getDTNode()->onlyChild();
+		else
+			root = decStack.top().getDTNode();
+
+		// the nodes are numbered first, so the header can go before them
+		if (-1 == nnf_node_count)
+			nnf_node_count = root->numberNNF();
+
+		return root;
+	}
+
+	// The d-DNNF of the last call to solve() flattened for counting,
+	//  built on the first call. Only valid if the d-DNNF was recorded.
+	CDAGEvaluator & dagEvaluator();
+
+	// returns false if the file could not be written
+	bool writeNNF(const char *fileName, bool falsify=false)
+	{
+		COutputFile out;
+		if (!out.open(fileName))
+			return false;
+		return writeNNF(out, falsify);
+	}
 
+	// the same text appended to rBuffer
+	bool writeNNF(string &rBuffer, bool falsify=false)
+	{
+		COutputFile out;
+		if (!out.openMemory(rBuffer))
+			return false;
+		return writeNNF(out, falsify);
+	}
+
+	bool writeNNF(COutputFile &out, bool falsify)
+	{
 		if (falsify) {
-			out << "nnf 1 0 " << bdg_var_count << endl;
-			out << "O 0 0" << endl;
-			return;
+			out.put("nnf 1 0 ");
+			out.putInt(bdg_var_count);
+			out.put("\nO 0 0\n");
+			return out.close();
 		}
 
-		vector<DTNode*> *nodeList = new vector<DTNode*> ();
+		DTNode* root = nnfRoot();
 
-		DTNode* root;
+		out.put("nnf ");
+		out.putInt(nnf_node_count);
+		out.put(' ');
+		out.putInt(bdg_edge_count);
+		out.put(' ');
+		out.putInt(bdg_var_count);
+		out.put('\n');
 
-		if (1 == decStack.top().getDTNode()->numChildren())
-			root = decStack.top().getDTNode()->onlyChild();
-		else
-                        root = decStack.top().getDTNode();
+		root->writeNNF(out);
 
-                root->prepNNF(nodeList);
-                
-		out << "nnf " << nodeList->size() << " " << bdg_edge_count << " "
-				<< bdg_var_count << endl;
+		return out.close();
+	}
 
-		for (int i = 0; i < nodeList->size(); i++)
-		{
-			nodeList->at(i)->genNNF(out);
-                }
+	// the same d-DNNF in the binary nnf format (see NNFBinFile.h)
+	bool writeNNFBin(const char *fileName, bool falsify=false)
+	{
+		CNNFBinWriter out;
+
+		if (falsify) {
+			if (!out.open(fileName, 1, 0, bdg_var_count))
+				return false;
+			out.beginOr(0, 0);
+			return out.close();
+		}
+
+		DTNode* root = nnfRoot();
+
+		if (!out.open(fileName, nnf_node_count, bdg_edge_count, bdg_var_count))
+			return false;
+
+		root->writeNNF(out);
+
+		return out.close();
 	}
 
 	void print_translation(const vector<unsigned> trans)
@@ -479,7 +703,7 @@ public:
 				nodesSeen.insert(node_id);
 
 				// Add the children to the open list
-				set<DTNode *>::iterator it;
+				DTNode::ChildIterator it;
 				for (it = node->getChildrenBegin(); it
 						!= node->getChildrenEnd(); it++)
 				{
@@ -0,0 +1,11 @@
+#include "SolverContext.h"
+
+thread_local CSolverContext *CSolverContext::pCurrent = NULL;
+
+void CSolverConf::bindDefault()
+{
+    static thread_local CSolverContext theDefault;
+
+    CSolverContext::pCurrent = &theDefault;
+    pBound = &theDefault.conf;
+}
@@ -0,0 +1,81 @@
+#ifndef SOLVERCONTEXT_H
+#define SOLVERCONTEXT_H
+
+#include <Interface/AnalyzerData.h>
+
+#include "Basics.h"
+
+/** The state of a compilation that is not part of a solver object
+ *
+ *  The options, the run statistics and the count of d-DNNF nodes. A
+ *  thread works with the context it has bound, theConf() and theRunAn()
+ *  are its options and statistics. A thread that never binds one gets a
+ *  default context of its own, which is what the dsharp binary uses.
+ *
+ *  Two compilations in one process need a context each, and each one
+ *  has to be bound by the thread that works on it, see CDSharp.
+ */
+class CSolverContext
+{
+    static thread_local CSolverContext *pCurrent;
+
+    CSolverContext(const CSolverContext &);
+    CSolverContext &operator=(const CSolverContext &);
+
+public:
+
+    CSolverConf conf;
+    CRunAnalyzer runAn;
+
+    // nodes of the d-DNNF currently in use
+    int nodeCount;
+
+    CSolverContext() : nodeCount(0)
+    {
+    }
+
+    explicit CSolverContext(const CSolverConf &rConf) : conf(rConf), nodeCount(0)
+    {
+    }
+
+    static CSolverContext &current()
+    {
+        if (pCurrent == NULL)
+            CSolverConf::bindDefault();
+        return *pCurrent;
+    }
+
+    /// binds a context to the calling thread for the lifetime of the object,
+    /// the one bound before is restored afterwards
+    class CBinding
+    {
+        CSolverContext *pPrevious;
+
+        CBinding(const CBinding &);
+        CBinding &operator=(const CBinding &);
+
+    public:
+
+        explicit CBinding(CSolverContext &rContext)
+        {
+            pPrevious = pCurrent;
+            pCurrent = &rContext;
+            CSolverConf::pBound = &rContext.conf;
+        }
+
+        ~CBinding()
+        {
+            pCurrent = pPrevious;
+            CSolverConf::pBound = (pPrevious != NULL) ? &pPrevious->conf : NULL;
+        }
+    };
+
+    friend class CSolverConf;
+};
+
+inline CRunAnalyzer &theRunAn()
+{
+    return CSolverContext::current().runAn;
+}
+
+#endif
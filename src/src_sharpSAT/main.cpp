@@ -2,22 +2,30 @@
 
 #include <ctime> // To seed random generator
 #include <sys/time.h> // To seed random generator
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fstream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <map>
 //include shared files
 #include <SomeTime.h>
 #include <Interface/AnalyzerData.h>
 
 #include "MainSolver/MainSolver.h"
+#include "MainSolver/BatchEvaluator.h"
+#include "MainSolver/DAGSampler.h"
+#include "MainSolver/CubeConquer.h"
+#include "MainSolver/InstanceGraph/BinaryCnf.h"
 #include "Basics.h"
 
 using namespace std;
 
-CMainSolver theSolver;
-
 // No description
 void finalcSATEvaluation()
 {
-	const AnalyzerData &rAda = theRunAn.getData();
+	const AnalyzerData &rAda = theRunAn().getData();
 
 	if (rAda.theExitState == TIMEOUT)
 	{
@@ -41,10 +49,13 @@ void finalcSATEvaluation()
 
 	toSTDOUT("# of solutions:\t\t" << rAda.getNumSatAssignments() <<endl);
 	toSTDOUT("#SAT (full):   \t\t");
-	if (!CSolverConf::quietMode)
+	if (!theConf().quietMode)
 		rAda.printNumSatAss_whole();
 	toSTDOUT(endl);
 
+	if (rAda.weighted)
+		toSTDOUT("weighted count:\t\t" << to_stringT(rAda.rnWeightedCount) <<endl);
+
 	toDEBUGOUT(".. found in:\t\t" << rAda.nReceivedSatAssignments << " units"<<endl);
 
 	toSTDOUT(endl);
@@ -66,9 +77,50 @@ void finalcSATEvaluation()
 	toSTDOUT("FormulaCache stats:"<<endl);
 	toSTDOUT("memUse:\t\t\t"<<rAda.get(FCACHE_MEMUSE) <<endl);
 	toSTDOUT("cached:\t\t\t"<<rAda.get(FCACHE_CACHEDCOMPS)<<endl);
-	toSTDOUT("used Buckets:\t\t"<<rAda.get(FCACHE_USEDBUCKETS)<<endl);
+	toSTDOUT("used slots:\t\t"<<rAda.get(FCACHE_USEDBUCKETS)
+			<<" of "<<rAda.get(FCACHE_TABLESLOTS)<<endl);
 	toSTDOUT("cache retrievals:\t"<<rAda.get(FCACHE_RETRIEVALS)<<endl);
 	toSTDOUT("cache tries:\t\t"<<rAda.get(FCACHE_INCLUDETRIES)<<endl);
+	toSTDOUT("probe length - max:\t"<<rAda.get(FCACHE_MAXPROBELEN));
+	toSTDOUT("\t avg:\t"<<rAda.get(FCACHE_AVGPROBELEN)<<endl);
+	toSTDOUT("hash collisions:\t"<<rAda.get(FCACHE_HASHCOLLISIONS)<<endl);
+	toSTDOUT("evicted:\t\t"<<rAda.get(FCACHE_EVICTED)<<endl);
+	toSTDOUT("eviction pauses:\t<0.1ms: "<<rAda.get(FCACHE_PAUSES_100US)
+			<<"  <1ms: "<<rAda.get(FCACHE_PAUSES_1MS)
+			<<"  <10ms: "<<rAda.get(FCACHE_PAUSES_10MS)
+			<<"  <100ms: "<<rAda.get(FCACHE_PAUSES_100MS)
+			<<"  >=100ms: "<<rAda.get(FCACHE_PAUSES_SLOW)<<endl);
+	toSTDOUT("max pause:\t\t"<<rAda.get(FCACHE_MAXPAUSE)<<" ms"<<endl);
+	if (theConf().nThreads > 1)
+	{
+		toSTDOUT("shared hits:\t\t"<<rAda.get(FCACHE_SHAREDHITS)
+				<<" of "<<rAda.get(FCACHE_SHAREDLOOKUPS)<<endl);
+		toSTDOUT("contention:\t\tturned away: "<<rAda.get(FCACHE_CONTENDED)
+				<<"  lock waits: "<<rAda.get(FCACHE_LOCKWAITS)<<endl);
+	}
+
+	if (!theConf().countOnly)
+	{
+		toSTDOUT(endl);
+		toSTDOUT("d-DNNF stats:"<<endl);
+		toSTDOUT("nodes:\t\t\t"<<rAda.get(DT_NODES)<<endl);
+		toSTDOUT("memUse:\t\t\t"<<rAda.get(DT_MEMUSE)<<endl);
+		toSTDOUT("bytes per node:\t\t"<<rAda.get(DT_BYTESPERNODE)<<endl);
+		toSTDOUT("merged nodes:\t\t"<<rAda.get(DT_MERGEDNODES)<<endl);
+		toSTDOUT("merge time:\t\t"<<rAda.get(DT_MERGETIME)<<"s"<<endl);
+		toSTDOUT("compress time:\t\t"<<rAda.get(DT_COMPRESSTIME)<<"s"<<endl);
+	}
+
+	toSTDOUT(endl);
+	toSTDOUT("Parser stats:"<<endl);
+	toSTDOUT("text size:\t\t"<<rAda.get(PARSE_MBYTES)<<" MB"<<endl);
+	toSTDOUT("parse time:\t\t"<<rAda.get(PARSE_TIME)<<"s"<<endl);
+	toSTDOUT("throughput:\t\t"<<rAda.get(PARSE_MBPERSEC)<<" MB/s"<<endl);
+	if (rAda.get(PARSE_COMPRESSED_MBYTES) > 0.0)
+	{
+		toSTDOUT("compressed size:\t"<<rAda.get(PARSE_COMPRESSED_MBYTES)<<" MB"<<endl);
+		toSTDOUT("compressed throughput:\t"<<rAda.get(PARSE_COMPRESSED_MBPERSEC)<<" MB/s"<<endl);
+	}
 
 	toSTDOUT("\n\nTime: "<<rAda.elapsedTime<<"s\n\n");
 
@@ -76,8 +128,591 @@ void finalcSATEvaluation()
 
 }
 
+// true if a and b differ by more than the rounding of a count
+bool countsDiffer(const CRealNum &a, const CRealNum &b)
+{
+	CRealNum diff = a - b;
+	CRealNum scale = (a < 0) ? -a : a;
+
+	if (diff < 0)
+		diff = -diff;
+	if (b > scale)
+		scale = b;
+	else if (-b > scale)
+		scale = -b;
+
+	return diff > scale * 1e-9;
+}
+
+// Counts the models again on the compiled d-DNNF: all of them if
+//  checkCount is set, compared with the count of the search, and the ones
+//  under the assumption literals if there are any. A weighted theory also
+//  gets its weighted counts. Returns false on a mismatch, an assumption
+//  that is no variable of the theory or weights the d-DNNF can not count.
+bool countOnDAG(CMainSolver &theSolver, bool checkCount, const vector<int> &assumptions)
+{
+	const AnalyzerData &rAda = theRunAn().getData();
+
+	if (rAda.theExitState != SUCCESS)
+		return true;
+
+	CDAGEvaluator &eval = theSolver.dagEvaluator();
+	CRealNum count;
+
+	const vector<CRealNum> &litWeights = theSolver.getLitWeights();
+	CRealNum weightedCount;
+
+	if (checkCount)
+	{
+		eval.countModels(vector<int>(), count);
+		toSTDOUT("# of solutions (d-DNNF):\t" << count <<endl);
+
+		if (countsDiffer(count, rAda.getNumSatAssignments()))
+		{
+			toERROUT(" The d-DNNF has "<< count <<" models, the search counted "
+					<< rAda.getNumSatAssignments()<<endl);
+			return false;
+		}
+	}
+
+	if (checkCount && rAda.weighted)
+	{
+		if (!eval.weightedCount(litWeights, vector<int>(), weightedCount))
+		{
+			toERROUT(" The d-DNNF can not be counted with a variable of weight"
+					<< " w(x) + w(-x) = 0"<<endl);
+			return false;
+		}
+		toSTDOUT("weighted count (d-DNNF):\t" << weightedCount <<endl);
+
+		if (countsDiffer(weightedCount, rAda.rnWeightedCount))
+		{
+			toERROUT(" The d-DNNF has the weighted count "<< weightedCount
+					<<", the search counted "<< rAda.rnWeightedCount<<endl);
+			return false;
+		}
+	}
+
+	if (!assumptions.empty())
+	{
+		CStopWatch watch;
+		watch.markStartTime();
+
+		if (!eval.countModels(assumptions, count))
+		{
+			toERROUT(" An assumption is no literal of the "
+					<< eval.countVars() <<" variables"<<endl);
+			return false;
+		}
+
+		watch.markStopTime();
+		toSTDOUT("# of solutions under the assumptions:\t" << to_intStringT(count)
+				<< " (" << watch.getElapsedTime() << "s)" <<endl);
+
+		if (rAda.weighted)
+		{
+			watch.markStartTime();
+			if (!eval.weightedCount(litWeights, assumptions, weightedCount))
+			{
+				toERROUT(" The d-DNNF can not be counted with a variable of weight"
+						<< " w(x) + w(-x) = 0"<<endl);
+				return false;
+			}
+			watch.markStopTime();
+			toSTDOUT("weighted count under the assumptions:\t" << to_stringT(weightedCount)
+					<< " (" << watch.getElapsedTime() << "s)" <<endl);
+		}
+	}
+
+	return true;
+}
+
+// Writes the count under every literal of the d-DNNF to fileName, a
+//  line "<lit> <marginal> <count>" for lit and -lit of every variable. The
+//  counts are weighted if litWeights is not empty and hold the
+//  assumptions as well.
+bool writeMarginals(CDAGEvaluator &eval, const vector<CRealNum> &litWeights,
+		const vector<int> &assumptions, const char *fileName)
+{
+	CRealNum count;
+	vector<CRealNum> litCounts;
+	CStopWatch watch;
+
+	watch.markStartTime();
+	if (!eval.marginals(litWeights, assumptions, count, litCounts))
+	{
+		toERROUT(" The marginals need literals over the "<< eval.countVars()
+				<<" variables and no variable of weight w(x) + w(-x) = 0"<<endl);
+		return false;
+	}
+	watch.markStopTime();
+
+	ofstream out(fileName);
+
+	for (unsigned int var = 1; var <= eval.countVars(); var++)
+		for (int sign = 1; sign >= -1; sign -= 2)
+		{
+			const CRealNum &litCount = litCounts[LiteralIdT(var, sign > 0).toUInt()];
+			CRealNum marginal = 0;
+			if (count != 0)
+				marginal = litCount / count;
+
+			out << sign * (int) var << " " << to_stringT(marginal) << " "
+					<< to_stringT(litCount) << "\n";
+		}
+
+	out.close();
+	if (!out)
+	{
+		toERROUT(" Error writing file "<< fileName<<endl);
+		return false;
+	}
+
+	toSTDOUT("marginals:\t\t"<< eval.countVars()<<" variables in "
+			<< watch.getElapsedTime()<<"s, written to "<< fileName<<endl);
+	return true;
+}
+
+// the models to draw with -sample, to stdout without a file
+struct SampleOptions
+{
+	uint64_t nSamples;
+	uint64_t seed;
+	unsigned int nThreads;
+	const char *file;
+};
+
+// Draws the models of -sample from the d-DNNF, in which the assumptions
+//  hold, weighted if litWeights is not empty.
+bool writeSamples(CDAGEvaluator &eval, const vector<CRealNum> &litWeights,
+		const vector<int> &assumptions, const SampleOptions &opts)
+{
+	CDAGSampler sampler;
+
+	if (!sampler.build(eval, litWeights, assumptions))
+	{
+		toERROUT(" No model to sample: the d-DNNF has none under the assumptions,"
+				<<" an assumption is no literal of the "<< eval.countVars()
+				<<" variables or a weight is negative"<<endl);
+		return false;
+	}
+
+	FILE *out = stdout;
+	if (opts.file != NULL && (out = fopen(opts.file, "w")) == NULL)
+	{
+		toERROUT(" Error writing file "<< opts.file<<endl);
+		return false;
+	}
+
+	CStopWatch watch;
+	watch.markStartTime();
+	bool ok = sampler.writeSamples(out, opts.nSamples, opts.seed, opts.nThreads);
+	watch.markStopTime();
+
+	if (opts.file != NULL)
+		ok = (fclose(out) == 0) && ok;
+
+	if (!ok)
+	{
+		toERROUT(" Error writing the samples"<<endl);
+		return false;
+	}
+
+	toSTDOUT("samples:\t\t"<< opts.nSamples<<" models in "<< watch.getElapsedTime()
+			<<"s, seed "<< opts.seed<<", "<< opts.nThreads<<" threads"<<endl);
+	return true;
+}
+
+// Answers nQueries random queries of up to 8 literals with the batch
+//  evaluator and prints the queries per second of its passes. The first
+//  queries are also answered one by one with the CDAGEvaluator, to compare
+//  the speed and the results. The weighted pass uses random weights if
+//  litWeights is empty.
+bool benchQueries(CDAGEvaluator &eval, vector<CRealNum> litWeights,
+		unsigned int nQueries)
+{
+	unsigned int nVars = eval.countVars();
+
+	// the same queries in every run
+	srand(1);
+
+	vector<vector<int> > queries(nQueries);
+	for (unsigned int q = 0; q < nQueries && nVars > 0; q++)
+	{
+		unsigned int nLits = 1 + rand() % 8;
+		for (unsigned int i = 0; i < nLits; i++)
+		{
+			int var = 1 + rand() % nVars;
+			queries[q].push_back((rand() % 2) ? var : -var);
+		}
+	}
+
+	if (litWeights.empty())
+	{
+		litWeights.resize(2 * (nVars + 1));
+		for (unsigned int i = 0; i < litWeights.size(); i++)
+			litWeights[i] = CRealNum(1 + rand() % 1000) / 1000;
+	}
+
+	CBatchEvaluator batch;
+	CStopWatch watch;
+
+	watch.markStartTime();
+	batch.build(eval);
+	watch.markStopTime();
+
+	toSTDOUT(endl<<"batch evaluator:\t"<< batch.instructionSet()<<", "
+			<< batch.countRows()<<" rows, built in "<< watch.getElapsedTime()<<"s"<<endl);
+
+	vector<bool> sat;
+	vector<CRealNum> counts, weightedCounts;
+	double secs[3];
+	bool ok = true;
+
+	watch.markStartTime();
+	ok = ok && batch.satisfiable(queries, sat);
+	watch.markStopTime();
+	secs[0] = watch.getElapsedTime();
+
+	watch.markStartTime();
+	ok = ok && batch.countModels(queries, counts);
+	watch.markStopTime();
+	secs[1] = watch.getElapsedTime();
+
+	watch.markStartTime();
+	ok = ok && batch.weightedCount(litWeights, queries, weightedCounts);
+	watch.markStopTime();
+	secs[2] = watch.getElapsedTime();
+
+	if (!ok)
+	{
+		toERROUT(" The batch evaluator can not count with a variable of weight"
+				<< " w(x) + w(-x) = 0"<<endl);
+		return false;
+	}
+
+	// the same for the first queries with the CDAGEvaluator
+	unsigned int nChecked = min(nQueries, 1000u);
+	CRealNum count, weightedCount;
+	double secsOne[2];
+
+	watch.markStartTime();
+	for (unsigned int q = 0; q < nChecked; q++)
+	{
+		eval.countModels(queries[q], count);
+		if ((count > 0) != sat[q] || countsDiffer(count, counts[q]))
+		{
+			toERROUT(" Query "<< q <<" has "<< count <<" models, the batch evaluator counted "
+					<< counts[q]<<(sat[q] ? " (satisfiable)" : " (unsatisfiable)")<<endl);
+			return false;
+		}
+	}
+	watch.markStopTime();
+	secsOne[0] = watch.getElapsedTime();
+
+	watch.markStartTime();
+	for (unsigned int q = 0; q < nChecked; q++)
+	{
+		eval.weightedCount(litWeights, queries[q], weightedCount);
+		if (countsDiffer(weightedCount, weightedCounts[q]))
+		{
+			toERROUT(" Query "<< q <<" has the weighted count "<< weightedCount
+					<<", the batch evaluator counted "<< weightedCounts[q]<<endl);
+			return false;
+		}
+	}
+	watch.markStopTime();
+	secsOne[1] = watch.getElapsedTime();
+
+	const char *names[3] = { "satisfiable:\t\t", "count:\t\t\t", "weighted count:\t\t" };
+
+	for (int i = 0; i < 3; i++)
+	{
+		toSTDOUT(names[i]<< nQueries <<" queries in "<< secs[i]<<"s, "
+				<< nQueries / max(secs[i], 1e-6)<<" queries/s");
+		if (i > 0)
+			toSTDOUT(" (one by one: "<< nChecked / max(secsOne[i - 1], 1e-6)<<" queries/s)");
+		toSTDOUT(endl);
+	}
+
+	return true;
+}
+
+// Reads a d-DNNF written with -Fnnf or -Fnnfbin and answers the queries
+//  of -assume, -benchQueries, -marginals and -sample on it.
+int queryNNFFile(const char *nnfFile, const vector<int> &assumptions,
+		unsigned int nBenchQueries, const char *marginalsFile,
+		const SampleOptions &sampling)
+{
+	CDAGEvaluator eval;
+	string err;
+
+	if (!eval.loadNNF(nnfFile, err))
+	{
+		toERROUT(" Error reading "<< nnfFile<<": "<< err<<endl);
+		return 3;
+	}
+
+	toSTDOUT("nnf:\t\t\t"<< eval.countNodes()<<" nodes, "<< eval.countVars()<<" variables"<<endl);
+
+	if (!assumptions.empty())
+	{
+		CRealNum count;
+		if (!eval.countModels(assumptions, count))
+		{
+			toERROUT(" An assumption is no literal of the "
+					<< eval.countVars() <<" variables"<<endl);
+			return 3;
+		}
+		toSTDOUT("# of solutions under the assumptions:\t" << to_intStringT(count) <<endl);
+	}
+
+	if (nBenchQueries > 0 && !benchQueries(eval, vector<CRealNum>(), nBenchQueries))
+		return 3;
+
+	if (marginalsFile != NULL
+			&& !writeMarginals(eval, vector<CRealNum>(), assumptions, marginalsFile))
+		return 3;
+
+	if (sampling.nSamples > 0
+			&& !writeSamples(eval, vector<CRealNum>(), assumptions, sampling))
+		return 3;
+
+	return 0;
+}
+
+// Collects the instances of a batch: either every regular file in the
+//  directory batchSource (sorted by name), or the paths listed in the
+//  file batchSource, one per line ('#' starts a comment).
+bool readBatchList(const char *batchSource, vector<string> &files)
+{
+	struct stat st;
+
+	if (stat(batchSource, &st) != 0)
+		return false;
+
+	if (S_ISDIR(st.st_mode))
+	{
+		DIR *dir = opendir(batchSource);
+		if (dir == NULL)
+			return false;
+
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL)
+		{
+			if (entry->d_name[0] == '.')
+				continue;
+
+			string path = string(batchSource) + "/" + entry->d_name;
+			if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+				files.push_back(path);
+		}
+		closedir(dir);
+		sort(files.begin(), files.end());
+		return true;
+	}
+
+	ifstream in(batchSource);
+	string line;
+
+	while (getline(in, line))
+	{
+		size_t first = line.find_first_not_of(" \t\r");
+		if (first == string::npos || line[first] == '#')
+			continue;
+		size_t last = line.find_last_not_of(" \t\r");
+		files.push_back(line.substr(first, last - first + 1));
+	}
+	return true;
+}
+
+// The name of the output files of an instance: the file name
+//  without directory, compression suffix and cnf extension.
+string batchBaseName(const string &path)
+{
+	string base = path.substr(path.find_last_of('/') + 1);
+	const char *exts[] = { ".gz", ".xz", ".zst", ".cnf", ".bcnf" };
+
+	for (int i = 0; i < 5; i++)
+	{
+		size_t len = strlen(exts[i]);
+		if (base.size() > len && base.compare(base.size() - len, len, exts[i]) == 0)
+			base.erase(base.size() - len);
+	}
+	return base;
+}
+
+// Compiles every instance of the batch with the same solver. Writes
+//  <base>.nnf and <base>.stats for each of them into outDir. An instance
+//  that can not be read or compiled is reported and skipped, the exit
+//  code is 3 if there was one.
+int runBatch(CMainSolver &theSolver, const char *batchSource, const char *outDir)
+{
+	vector<string> files;
+
+	if (!readBatchList(batchSource, files))
+	{
+		toERROUT(" Error reading batch "<< batchSource<<endl);
+		return 3;
+	}
+
+	// instances of the same name write <base>.<position in the batch>.nnf
+	//  instead of overwriting each other's output
+	map<string, int> nBaseNames;
+	for (unsigned i = 0; i < files.size(); i++)
+		nBaseNames[batchBaseName(files[i])]++;
+
+	int nSolved = 0, nSkipped = 0, nFailed = 0;
+
+	for (unsigned i = 0; i < files.size(); i++)
+	{
+		FILE *check = fopen(files[i].c_str(), "rb");
+		if (check == NULL)
+		{
+			toERROUT(" Skipping unreadable file "<< files[i]<<endl);
+			nSkipped++;
+			continue;
+		}
+		fclose(check);
+
+		string base = string(outDir) + "/" + batchBaseName(files[i]);
+		if (nBaseNames[batchBaseName(files[i])] > 1)
+			base += "." + to_string(i + 1);
+		string statsFile = base + ".stats";
+		string nnfFile = base + ".nnf";
+
+		toSTDOUT(endl<<"BEGIN batch instance "<< (i + 1) <<"/"<< files.size()
+				<<": "<< files[i]<<endl);
+
+		theRunAn() = CRunAnalyzer();
+
+		if (!theSolver.solve(files[i].c_str()))
+		{
+			toERROUT(" Failed to compile "<< files[i]<<", nothing written for it"<<endl);
+			nFailed++;
+			continue;
+		}
+
+		theRunAn().finishcountSATAnalysis();
+		finalcSATEvaluation();
+		theRunAn().getData().writeToFile(statsFile.c_str());
+
+		if (theConf().countOnly)
+		{
+			toSTDOUT("END batch instance "<< files[i]<<" -> "<< statsFile<<endl);
+		}
+		else
+		{
+			bool falsify = (0 == theRunAn().getData().getNumSatAssignments());
+			if (!theSolver.writeNNF(nnfFile.c_str(), falsify))
+			{
+				toERROUT(" Error writing file "<< nnfFile<<endl);
+				return 3;
+			}
+
+			toSTDOUT("END batch instance "<< files[i]<<" -> "<< nnfFile<<endl);
+		}
+		nSolved++;
+	}
+
+	cout << "Batch: " << nSolved << " compiled, " << nSkipped << " skipped, "
+			<< nFailed << " failed" << endl;
+
+	return (nSkipped + nFailed > 0) ? 3 : 0;
+}
+
+// Compiles the formula as 2^k cubes in worker processes. Writes the
+//  joined d-DNNF to nnfFile if it is not NULL; checkCount counts the
+//  models, and the weighted models of a weighted cnf, again on it,
+//  written to the work directory if need be.
+int runCubes(CMainSolver &theSolver, const char *cnfFile, unsigned int k,
+		unsigned int nWorkers, const char *nnfFile, bool checkCount)
+{
+	CCubeConquer cubes(nWorkers);
+	CStopWatch watch;
+	watch.markStartTime();
+
+	if (!cubes.run(theSolver, cnfFile, k))
+		return 3;
+
+	watch.markStopTime();
+	double secs = watch.getElapsedTime();
+
+	if (cubes.exitState() != SUCCESS)
+	{
+		toSTDOUT(endl << (cubes.exitState() == TIMEOUT ? " TIMEOUT !" : " ABORTED !")<<endl);
+		cout << "Runtime:" << secs << endl;
+		return 0;
+	}
+
+	toSTDOUT(endl<<endl);
+	toSTDOUT("# of solutions:\t\t" << cubes.count() <<endl);
+	if (cubes.isWeighted())
+		toSTDOUT("weighted count:\t\t" << to_stringT(cubes.weightedCount()) <<endl);
+	toSTDOUT(endl);
+	cout << "Runtime:" << secs << endl;
+
+	if (theConf().countOnly)
+		return 0;
+
+	string dagFile = (nnfFile != NULL) ? string(nnfFile) : cubes.workFile("cubes.nnf");
+	string err;
+
+	if ((nnfFile != NULL || checkCount) && !cubes.writeNNF(dagFile.c_str(), err))
+	{
+		toERROUT(" Error writing file "<< dagFile<<": "<< err<<endl);
+		return 3;
+	}
+
+	if (!checkCount)
+		return 0;
+
+	CDAGEvaluator eval;
+	CRealNum count;
+
+	if (!eval.loadNNF(dagFile.c_str(), err))
+	{
+		toERROUT(" Error reading "<< dagFile<<": "<< err<<endl);
+		return 3;
+	}
+
+	eval.countModels(vector<int>(), count);
+	toSTDOUT("# of solutions (d-DNNF):\t" << count <<endl);
+
+	if (countsDiffer(count, cubes.count()))
+	{
+		toERROUT(" The d-DNNF has "<< count <<" models, the cubes counted "
+				<< cubes.count()<<endl);
+		return 3;
+	}
+
+	if (cubes.isWeighted())
+	{
+		CRealNum weightedCount;
+
+		if (!eval.weightedCount(theSolver.getLitWeights(), vector<int>(), weightedCount))
+		{
+			toERROUT(" The d-DNNF can not be counted with a variable of weight"
+					<< " w(x) + w(-x) = 0"<<endl);
+			return 3;
+		}
+		toSTDOUT("weighted count (d-DNNF):\t" << weightedCount <<endl);
+
+		if (countsDiffer(weightedCount, cubes.weightedCount()))
+		{
+			toERROUT(" The d-DNNF has the weighted count "<< weightedCount
+					<<", the cubes counted "<< cubes.weightedCount()<<endl);
+			return 3;
+		}
+	}
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
+	CMainSolver theSolver;
+
 	char *s;
 	char dataFile[1024];
 	memset(dataFile, 0, 1024);
@@ -94,12 +729,52 @@ int main(int argc, char *argv[])
 	strcpy(nnfFile, "nnf.txt");
 	bool nnfFileout = false;
 
+	char nnfBinFile[1024];
+	memset(nnfBinFile, 0, 1024);
+	bool nnfBinFileout = false;
+
+	char binCnfFile[1024];
+	memset(binCnfFile, 0, 1024);
+	bool binCnfOut = false;
+
+	char batchSource[1024];
+	memset(batchSource, 0, 1024);
+	bool batchMode = false;
+
+	char batchOutDir[1024];
+	memset(batchOutDir, 0, 1024);
+	strcpy(batchOutDir, ".");
+
+	unsigned int nCubeVars = 0;
+	unsigned int nCubeWorkers = 0;
+	bool cacheFileIn = false;
+
+	bool checkCount = false;
+	vector<int> assumptions;
+	unsigned int nBenchQueries = 0;
+
+	char nnfInFile[1024];
+	memset(nnfInFile, 0, 1024);
+	bool nnfIn = false;
+
+	char marginalsFile[1024];
+	memset(marginalsFile, 0, 1024);
+	bool marginalsOut = false;
+
+	char samplesFile[1024];
+	memset(samplesFile, 0, 1024);
+	SampleOptions sampling;
+	sampling.nSamples = 0;
+	sampling.seed = time(NULL);
+	sampling.nThreads = 1;
+	sampling.file = NULL;
+
         //Dimitar Shterionov:
         bool smoothNNF = false;
         
-	CSolverConf::analyzeConflicts = true;
-	CSolverConf::doNonChronBackTracking = true;
-	CSolverConf::nodeCount = 0;
+	theConf().analyzeConflicts = true;
+	theConf().doNonChronBackTracking = true;
+	CSolverContext::current().nodeCount = 0;
 
 	if (argc <= 1)
 	{
@@ -107,18 +782,38 @@ int main(int argc, char *argv[])
 		cout << "Usage: dsharp [options] [CNF_File]" << endl;
 		cout << "Options: " << endl;
 		cout << "\t -priority [v1,v2,..] \t\t use the priority variables as the first decision nodes" << endl;
+		cout << "\t -checkCount \t\t count the models again on the d-DNNF and compare" << endl;
+		cout << "\t -assume [l1,l2,..] \t count the models of the d-DNNF in which the literals hold" << endl;
+		cout << "\t -benchQueries [n] \t answer n random queries on the d-DNNF with the batch evaluator" << endl;
+		cout << "\t -evalNNF [file] \t answer -assume, -benchQueries, -marginals and -sample on an nnf file instead of a CNF" << endl;
+		cout << "\t -marginals [file] \t write the (weighted) count and marginal of every literal under -assume" << endl;
+		cout << "\t -sample [K] \t\t draw K random models of the d-DNNF under -assume (weighted if the CNF is)" << endl;
+		cout << "\t -Fsamples [file] \t write the models of -sample to file instead of stdout" << endl;
+		cout << "\t -seed [n] \t\t seed of -sample (default: the time)" << endl;
+		cout << "\t -threads [n] \t\t threads of the search (at most 256)" << endl;
+		cout << "\t -sampleThreads [n] \t threads of -sample (at most 256)" << endl;
 		cout << "\t -noPP  \t\t turn off preprocessing" << endl;
 		cout << "\t -noCA  \t\t turn off conflict analysis" << endl;
 		cout << "\t -noCC  \t\t turn off component caching" << endl;
 		cout << "\t -noNCB \t\t turn off nonchronological backtracking" << endl;
 		cout << "\t -noIBCP\t\t turn off implicit BCP" << endl;
 		cout << "\t -noDynDecomp\t\t turn off dynamic decomposition" << endl;
+		cout << "\t -noMerge\t\t do not merge identical nodes of the d-DNNF" << endl;
 		cout << "\t -q     \t\t quiet mode" << endl;
+		cout << "\t -count \t\t only count the models, without building the d-DNNF" << endl;
 		cout << "\t -t [s] \t\t set time bound to s seconds" << endl;
 		cout << "\t -cs [n]\t\t set max cache size to n MB" << endl;
 		cout << "\t -FrA [file] \t\t file to output the run statistics" << endl;
 		cout << "\t -Fgraph [file] \t file to output the backdoor or d-DNNF graph" << endl;
 		cout << "\t -Fnnf [file] \t\t file to output the nnf graph to" << endl;
+		cout << "\t -Fnnfbin [file] \t file to output the nnf graph to in the binary nnf format" << endl;
+		cout << "\t -Fcache [file] \t persistent component cache, loaded before and saved after compiling" << endl;
+		cout << "\t -toBinCNF [file] \t convert the CNF to the binary cnf format and exit" << endl;
+		cout << "\t -batch [list|dir] \t compile every CNF listed in the file (or found in the directory)" << endl;
+		cout << "\t -batchOut [dir] \t directory for the .nnf and .stats files of a batch" << endl;
+		cout << "\t -cubes [k] \t\t split the formula into 2^k cubes (k <= 20) compiled by worker processes," << endl;
+		cout << "\t \t\t\t -t bounds the whole run, no cube is started after one timed out" << endl;
+		cout << "\t -workers [n] \t\t worker processes of -cubes (default: one per cpu)" << endl;
 
         //Dimitar Shterionov:
         cout << "\t -smoothNNF \t\t post processing to smoothed d-DNNF" << endl;
@@ -131,30 +826,35 @@ int main(int argc, char *argv[])
 	for (int i = 1; i < argc; i++)
 	{
 		if (strcmp(argv[i], "-noNCB") == 0)
-			CSolverConf::doNonChronBackTracking = false;
+			theConf().doNonChronBackTracking = false;
 		if (strcmp(argv[i], "-noCC") == 0)
-			CSolverConf::allowComponentCaching = false;
+			theConf().allowComponentCaching = false;
 		if (strcmp(argv[i], "-noIBCP") == 0)
-			CSolverConf::allowImplicitBCP = false;
+			theConf().allowImplicitBCP = false;
 
 		//Dimitar Shterionov:
 		if (strcmp(argv[i], "-smoothNNF") == 0)
-			CSolverConf::smoothNNF = true;
+			theConf().smoothNNF = true;
 		
 		if (strcmp(argv[i], "-disableAllLits") == 0)
-			CSolverConf::ensureAllLits = false;
+			theConf().ensureAllLits = false;
 		
 		if (strcmp(argv[i], "-noDynDecomp") == 0)
-		    CSolverConf::disableDynamicDecomp = true;
+		    theConf().disableDynamicDecomp = true;
+
+		if (strcmp(argv[i], "-noMerge") == 0)
+			theConf().mergeNodes = false;
               
 		if (strcmp(argv[i], "-noPP") == 0)
-			CSolverConf::allowPreProcessing = false;
+			theConf().allowPreProcessing = false;
 		else if (strcmp(argv[i], "-noCA") == 0)
 		{
-			CSolverConf::analyzeConflicts = false;
+			theConf().analyzeConflicts = false;
 		}
 		else if (strcmp(argv[i], "-q") == 0)
-			CSolverConf::quietMode = true;
+			theConf().quietMode = true;
+		else if (strcmp(argv[i], "-count") == 0)
+			theConf().countOnly = true;
 		else if (strcmp(argv[i], "-FrA") == 0)
 		{
 			memset(dataFile, 0, 1024);
@@ -188,6 +888,80 @@ int main(int argc, char *argv[])
 			}
 			strcpy(nnfFile, argv[i + 1]);
 		}
+		else if (strcmp(argv[i], "-Fnnfbin") == 0)
+		{
+			memset(nnfBinFile, 0, 1024);
+			nnfBinFileout = true;
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			strcpy(nnfBinFile, argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-Fcache") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			theSolver.setCacheFile(argv[i + 1]);
+			cacheFileIn = true;
+		}
+		else if (strcmp(argv[i], "-toBinCNF") == 0)
+		{
+			binCnfOut = true;
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			strcpy(binCnfFile, argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-batch") == 0)
+		{
+			batchMode = true;
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			strcpy(batchSource, argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-batchOut") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			strcpy(batchOutDir, argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-cubes") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			nCubeVars = max(atoi(argv[i + 1]), 0);
+			if (nCubeVars > CCubeConquer::MAX_CUBE_VARS)
+			{
+				toERROUT(" -cubes splits on at most "<< CCubeConquer::MAX_CUBE_VARS
+						<<" variables"<<endl);
+				return 3;
+			}
+		}
+		else if (strcmp(argv[i], "-workers") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			nCubeWorkers = max(atoi(argv[i + 1]), 0);
+		}
 		else if (strcmp(argv[i], "-t") == 0)
 		{
 			if (argc <= i + 1)
@@ -195,9 +969,9 @@ int main(int argc, char *argv[])
 				toSTDOUT("wrong parameters"<<endl);
 				return -1;
 			}
-			CSolverConf::secsTimeBound = atoi(argv[i + 1]);
-			toSTDOUT("time bound:" <<CSolverConf::secsTimeBound<<"s\n");
-			theSolver.setTimeBound(CSolverConf::secsTimeBound);
+			theConf().secsTimeBound = atoi(argv[i + 1]);
+			toSTDOUT("time bound:" <<theConf().secsTimeBound<<"s\n");
+			theSolver.setTimeBound(theConf().secsTimeBound);
 		}
 		else if (strcmp(argv[i], "-priority") == 0)
 		{
@@ -218,6 +992,111 @@ int main(int argc, char *argv[])
             theSolver.priorityVars.insert(atoi(s.c_str()));
 			toSTDOUT("Using " << theSolver.priorityVars.size() << " priority variables.\n");
 		}
+		else if (strcmp(argv[i], "-checkCount") == 0)
+			checkCount = true;
+		else if (strcmp(argv[i], "-assume") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+
+			size_t pos = 0;
+			string s = string(argv[i+1]);
+			while ((pos = s.find(",")) != string::npos) {
+				assumptions.push_back(atoi(s.substr(0, pos).c_str()));
+				s.erase(0, pos + 1);
+			}
+			assumptions.push_back(atoi(s.c_str()));
+		}
+		else if (strcmp(argv[i], "-benchQueries") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			nBenchQueries = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-evalNNF") == 0)
+		{
+			nnfIn = true;
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			strcpy(nnfInFile, argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-marginals") == 0)
+		{
+			marginalsOut = true;
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			strcpy(marginalsFile, argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-sample") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			sampling.nSamples = strtoull(argv[i + 1], NULL, 10);
+		}
+		else if (strcmp(argv[i], "-seed") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			sampling.seed = strtoull(argv[i + 1], NULL, 10);
+		}
+		else if (strcmp(argv[i], "-threads") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			theConf().nThreads = max(atoi(argv[i + 1]), 1);
+			if (theConf().nThreads > CComponentTaskPool::MAX_THREADS)
+			{
+				toERROUT(" -threads runs at most "<< CComponentTaskPool::MAX_THREADS
+						<<" threads"<<endl);
+				return 3;
+			}
+		}
+		else if (strcmp(argv[i], "-sampleThreads") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			sampling.nThreads = max(atoi(argv[i + 1]), 1);
+			if (sampling.nThreads > CDAGSampler::MAX_THREADS)
+			{
+				toERROUT(" -sampleThreads runs at most "<< CDAGSampler::MAX_THREADS
+						<<" threads"<<endl);
+				return 3;
+			}
+		}
+		else if (strcmp(argv[i], "-Fsamples") == 0)
+		{
+			if (argc <= i + 1)
+			{
+				toSTDOUT("wrong parameters"<<endl);
+				return -1;
+			}
+			strcpy(samplesFile, argv[i + 1]);
+			sampling.file = samplesFile;
+		}
 		else if (strcmp(argv[i], "-cs") == 0)
 		{
 			if (argc <= i + 1)
@@ -225,30 +1104,119 @@ int main(int argc, char *argv[])
 				toSTDOUT("wrong parameters"<<endl);
 				return -1;
 			}
-			CSolverConf::maxCacheSize = ((size_t) atoi(argv[i + 1])) * 1024 * 1024;
-			//cout <<"maxCacheSize:" <<CSolverConf::maxCacheSize<<"bytes\n";
+			theConf().maxCacheSize = ((size_t) atoi(argv[i + 1])) * 1024 * 1024;
+			//cout <<"maxCacheSize:" <<theConf().maxCacheSize<<"bytes\n";
 		}
 		else
 			s = argv[i];
 	}
 
-	toSTDOUT("cachesize Max:\t"<<CSolverConf::maxCacheSize/1024 << " kbytes"<<endl);
+	if (nnfIn)
+		return queryNNFFile(nnfInFile, assumptions, nBenchQueries,
+				marginalsOut ? marginalsFile : NULL, sampling);
+
+	if (binCnfOut)
+	{
+		unsigned int nVars, nCls;
+		vector<int> litVec;
+		vector<CRealNum> litWeights;
+		CnfParseInfo info;
+		string err;
+
+		if (!CInstanceGraph::readCNF(s, nVars, nCls, litVec, litWeights, info, err))
+		{
+			toERROUT(" "<< err<<endl);
+			return 3;
+		}
+		if (!litWeights.empty())
+		{
+			toERROUT(" The binary cnf holds no literal weights, "<< s
+					<<" can not be converted without losing its weighted count"<<endl);
+			return 3;
+		}
+		if (!writeBinaryCnf(binCnfFile, nVars, nCls, litVec))
+		{
+			toERROUT(" Error writing file "<< binCnfFile<<endl);
+			return 3;
+		}
+		toSTDOUT("wrote " << binCnfFile << ": " << nVars << " variables, "
+				<< litVec.size() << " literals"<<endl);
+		return 0;
+	}
+
+	if (theConf().countOnly && (nnfFileout || nnfBinFileout || graphFileout))
+	{
+		toERROUT(" -count builds no d-DNNF, it can not be written with -Fnnf, -Fnnfbin or -Fgraph"<<endl);
+		return 3;
+	}
+
+	if (theConf().countOnly && (checkCount || !assumptions.empty() || nBenchQueries > 0
+			|| marginalsOut || sampling.nSamples > 0))
+	{
+		toERROUT(" -count builds no d-DNNF to count on with -checkCount, -assume, -benchQueries,"
+				<<" -marginals or -sample"<<endl);
+		return 3;
+	}
+
+	if (batchMode && (nCubeVars > 0 || nnfFileout || nnfBinFileout || graphFileout || fileout
+			|| checkCount || !assumptions.empty() || nBenchQueries > 0 || marginalsOut
+			|| sampling.nSamples > 0))
+	{
+		toERROUT(" -batch writes only the .nnf and .stats files of every instance, it can not be"
+				<<" combined with -cubes, -Fnnf, -Fnnfbin, -Fgraph, -FrA, -checkCount, -assume,"
+				<<" -benchQueries, -marginals or -sample"<<endl);
+		return 3;
+	}
+
+	toSTDOUT("cachesize Max:\t"<<theConf().maxCacheSize/1024 << " kbytes"<<endl);
+
+	if (batchMode)
+		return runBatch(theSolver, batchSource, batchOutDir);
+
+	if (nCubeVars > 0 && (nnfBinFileout || graphFileout || cacheFileIn || !assumptions.empty()
+			|| nBenchQueries > 0 || marginalsOut || sampling.nSamples > 0))
+	{
+		toERROUT(" -cubes writes no -Fnnfbin, -Fgraph or -Fcache and answers no -assume,"
+				<<" -benchQueries, -marginals or -sample, use -evalNNF on its -Fnnf"<<endl);
+		return 3;
+	}
+
+	if (nCubeVars > 0)
+		return runCubes(theSolver, s, nCubeVars, nCubeWorkers, nnfFileout ? nnfFile : NULL, checkCount);
 
 	// first: delete all data in the output
 	if (fileout)
-		theRunAn.getData().writeToFile(dataFile);
+		theRunAn().getData().writeToFile(dataFile);
 
-	theRunAn = CRunAnalyzer();
+	theRunAn() = CRunAnalyzer();
 
-	theSolver.solve(s);
+	if (!theSolver.solve(s))
+		return 3;
 
-	theRunAn.finishcountSATAnalysis();
+	theRunAn().finishcountSATAnalysis();
 	finalcSATEvaluation();
 	if (fileout)
-		theRunAn.getData().writeToFile(dataFile);
+		theRunAn().getData().writeToFile(dataFile);
+
+	if (!countOnDAG(theSolver, checkCount, assumptions))
+		return 3;
+
+	if (nBenchQueries > 0 && theRunAn().getData().theExitState == SUCCESS
+			&& !benchQueries(theSolver.dagEvaluator(), theSolver.getLitWeights(), nBenchQueries))
+		return 3;
+
+	if (marginalsOut && theRunAn().getData().theExitState == SUCCESS
+			&& !writeMarginals(theSolver.dagEvaluator(), theSolver.getLitWeights(),
+					assumptions, marginalsFile))
+		return 3;
+
+	if (sampling.nSamples > 0 && theRunAn().getData().theExitState == SUCCESS
+			&& !writeSamples(theSolver.dagEvaluator(), theSolver.getLitWeights(),
+					assumptions, sampling))
+		return 3;
 
 		bool falsify = false;
-        if (0 == theRunAn.getData().getNumSatAssignments()) {
+        if (0 == theRunAn().getData().getNumSatAssignments()) {
             cout << "\nTheory is unsat. Resetting d-DNNF to empty Or.\n" << endl;
 			falsify = true;
         }
@@ -256,8 +1224,17 @@ int main(int argc, char *argv[])
 	if (graphFileout)
 		theSolver.writeBDG(graphFile, falsify);
 
-	if (nnfFileout)
-		theSolver.writeNNF(nnfFile, falsify);
+	if (nnfFileout && !theSolver.writeNNF(nnfFile, falsify))
+	{
+		toERROUT(" Error writing file "<< nnfFile<<endl);
+		return 3;
+	}
+
+	if (nnfBinFileout && !theSolver.writeNNFBin(nnfBinFile, falsify))
+	{
+		toERROUT(" Error writing file "<< nnfBinFile<<endl);
+		return 3;
+	}
 
 	return 0;
 }